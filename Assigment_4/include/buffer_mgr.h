@@ -17,7 +17,9 @@
  *-----------------------------------------------------------*/
 #include "dberror.h"
 #include "storage_mgr.h"
+#include "storage_mgr_async.h"
 #include "dt.h"
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -29,13 +31,23 @@ typedef enum ReplacementStrategy {
     RS_LRU = 1,
     RS_CLOCK = 2,
     RS_LFU = 3,
-    RS_LRU_K = 4
+    RS_LRU_K = 4,
+    RS_ARC = 5,
+    RS_2Q = 6
 } ReplacementStrategy;
 
+/*------------------------------------------------------------
+ * Page Latch Modes
+ *-----------------------------------------------------------*/
+typedef enum BM_LatchMode {
+    BM_LATCH_SHARED = 0,     // Readers of the page content
+    BM_LATCH_EXCLUSIVE = 1   // A writer of the page content
+} BM_LatchMode;
+
 /*------------------------------------------------------------
  * Basic Data Types and Constants
  *-----------------------------------------------------------*/
-typedef int PageNumber;
+// PageNumber (64-bit) is defined in storage_mgr.h
 #define NO_PAGE -1
 
 /*------------------------------------------------------------
@@ -56,17 +68,39 @@ typedef struct BM_PageHandle {
     char *data;          // Pointer to the memory storing the page content
 } BM_PageHandle;
 
+/*------------------------------------------------------------
+ * Per-Frame Replacement Policy State (Internal)
+ *-----------------------------------------------------------*/
+// Owned by the pool's replacement policy (buffer_mgr_policy.h); the pool
+// only initializes it when the frame is created.
+typedef struct PolicyMeta {
+    long long key;           // Rank in the policy's order, e.g. accesses for LFU
+    long long lastAccess;    // PageCache.accessClock at the page's latest access
+    int count;               // Accesses since the page was loaded
+    int useBit;              // For CLOCK: set on access, cleared as the hand passes
+    int slot;                // Position in the policy's heap, -1 when not in it
+    int list;                // Which of the policy's lists holds the page, 0 if none
+    int prev;                // Neighbours in that list by frame index, -1 at either end
+    int next;
+} PolicyMeta;
+
 /*------------------------------------------------------------
  * Frame Structure (Internal)
  *-----------------------------------------------------------*/
 typedef struct Frame {
     PageNumber pageNum;      // The page number stored in this frame
-    char *data;              // Pointer to page data (size = PAGE_SIZE)
+    char *data;              // Pointer to page data (size = the file's page size)
     bool dirty;              // True if page has been modified in memory
     int fixCount;            // Number of clients that have pinned this page
-    int lastTwo[2];          // For FIFO/LRU: stores load time or recent access times
-    int accessCount;         // For LFU: counts the number of accesses
-    int useBit;              // For CLOCK: 0 or 1
+    bool ioPending;          // True while an asynchronous read-ahead fills data
+    bool loading;            // True while the thread that missed on the page reads it in
+    bool cleaning;           // True while the page cleaner writes a copy of the page it holds
+    bool cleaned;            // Written back by the page cleaner and not dirtied since
+    int index;               // Position of this frame in PageCache.arr
+    pthread_rwlock_t latch;  // Shared/exclusive latch on the page content (latchPage)
+    struct Frame *lruPrev;   // Next older unpinned frame (NULL at the head or while pinned)
+    struct Frame *lruNext;   // Next newer unpinned frame (NULL at the tail or while pinned)
+    PolicyMeta meta;         // Replacement policy state of the page in this frame
 } Frame;
 
 /*------------------------------------------------------------
@@ -96,15 +130,35 @@ typedef struct Hash {
  * Page Cache Structure (Internal)
  *-----------------------------------------------------------*/
 typedef struct PageCache {
-    int front;          // Index of the front element in the page cache (queue)
-    int rear;           // Index of the rear element in the page cache (queue)
     int frameCnt;       // Number of used frames in the cache
     int capacity;       // Total capacity of the cache
     Frame **arr;        // Array of pointers to frames
     int numRead;        // Number of pages read into the cache
     int numWrite;       // Number of pages written from the cache
+    int numWriteSaved;  // Page writes merged into a neighbour's vectored write by forceFlushPool
+    int numDirty;       // Number of frames whose page is dirty
+    int numCleaned;     // Pages written back by the page cleaner
+    int numStallsAvoided; // Victims that were clean only because the page cleaner wrote them
     SM_FileHandle *fHandle; // File handle to the associated page file
-    int *hash;          // Auxiliary array for quick look-up in LRU implementation
+    Frame *lruHead;     // Unpinned frame released longest ago; empty frames come first
+    Frame *lruTail;     // Unpinned frame released most recently
+    const struct BM_ReplacementPolicy *policy; // Replacement policy of the pool (buffer_mgr_policy.h)
+    void *policyState;  // The policy's own state
+    long long accessClock; // Number of page accesses so far, used as a timestamp
+    int *pageTable;     // Open-addressing table of frame indexes keyed by page number, -1 if empty
+    int tableMask;      // Number of pageTable slots minus one (a power of two minus one)
+    bool zeroCopy;      // Frames borrow page pointers from a mapped or in-memory file
+    char *arena;        // SM_IO_ALIGNMENT-aligned storage for all frame data
+    Frame **pending;    // Frames claimed by prefetchPages whose reads are deferred
+    int numPending;     // Number of entries in pending
+    SM_AsyncQueue *aio; // Queue for read-ahead and flush runs, created on first use
+    bool aioUnavailable; // True when no queue can be used for this pool
+    pthread_mutex_t latch; // Latch on the page table, frame lists, policy state and counters
+    pthread_cond_t ioDone; // Broadcast when a page read or a page write in flight finishes
+    PageNumber *writing; // Pages being written without the latch; none may be read back meanwhile
+    int numWriting;     // Number of entries in writing
+    int writingCap;     // Number of entries writing has room for
+    struct PageCleaner *cleaner; // Background page cleaner, NULL unless one was started
 } PageCache;
 
 /*------------------------------------------------------------
@@ -116,13 +170,11 @@ typedef struct PageCache {
 /*------------------------------------------------------------
  * Helper Interface (Internal)
  *-----------------------------------------------------------*/
-extern Frame* createFrameNode();
+extern Frame* createFrameNode(char *data);
 extern RC resetFrameNode(Frame* frame);
-extern int* createHash(int capacity);
-extern PageCache* createPageCache(BM_BufferPool *const bm, int numPages);
+extern RC createPageCache(BM_BufferPool *const bm, int numPages, PageCache** result);
 extern void freeFrame(PageCache* pageCache);
 extern void freeFileHandle(PageCache* pageCache);
-extern void freeHash(PageCache* pageCache);
 extern void freePageCache(PageCache* pageCache);
 
 /*------------------------------------------------------------
@@ -131,12 +183,16 @@ extern void freePageCache(PageCache* pageCache);
 extern int isFull(PageCache* pageCache);
 extern int isEmpty(PageCache* pageCache);
 extern Frame* isHitPageCache(PageCache* pageCache, const PageNumber pageNum);
-extern RC addPageToPageCacheWithFIFO(BM_BufferPool *const bm, BM_PageHandle *const page, int pageNum);
-extern RC addPageToPageCacheWithLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
-extern RC updateLRUOrder(PageCache* pageCache, int pageNum);
-extern RC removePageWithFIFO(BM_BufferPool *const bm, BM_PageHandle *const page);
-extern Frame* removePageWithLRU(BM_BufferPool *const bm, BM_PageHandle *const page, int leastUsedPage);
-extern Frame* searchPageFromCache(PageCache *const pageCache, int pageNum);
+extern RC addPageToPageCache(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+extern RC removePageFromCache(BM_BufferPool *const bm, Frame* frame);
+extern Frame* searchPageFromCache(PageCache *const pageCache, const PageNumber pageNum);
+
+/*------------------------------------------------------------
+ * Page Writes in Flight and Page Cleaner Hooks (Internal, pool latch held)
+ *-----------------------------------------------------------*/
+extern RC beginPageWrite(PageCache* pageCache, PageNumber pageNum);
+extern void endPageWrite(PageCache* pageCache, PageNumber pageNum);
+extern void wakePageCleaner(PageCache* pageCache);
 
 /*------------------------------------------------------------
  * Buffer Manager Interface: Pool Handling
@@ -145,6 +201,8 @@ extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName
                          const int numPages, ReplacementStrategy strategy, void *stratData);
 extern RC shutdownBufferPool(BM_BufferPool *const bm);
 extern RC forceFlushPool(BM_BufferPool *const bm);
+extern RC startPageCleaner(BM_BufferPool *const bm, int highWatermark, int lowWatermark);
+extern RC stopPageCleaner(BM_BufferPool *const bm);
 
 /*------------------------------------------------------------
  * Buffer Manager Interface: Access Pages
@@ -153,6 +211,12 @@ extern RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page);
 extern RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page);
 extern RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page);
 extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+extern RC prefetchPages(BM_BufferPool *const bm, const PageNumber startPage, const int numPages);
+extern RC adviseAccess(BM_BufferPool *const bm, const PageNumber startPage, const PageNumber numPages, SM_Advice advice);
+extern RC allocatePoolPage(BM_BufferPool *const bm, PageNumber *pageNum);
+extern RC freePoolPage(BM_BufferPool *const bm, const PageNumber pageNum);
+extern RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, BM_LatchMode mode);
+extern RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page);
 
 /*------------------------------------------------------------
  * Buffer Manager Statistics Interface
@@ -162,5 +226,10 @@ extern bool *getDirtyFlags(BM_BufferPool *const bm);
 extern int *getFixCounts(BM_BufferPool *const bm);
 extern int getNumReadIO(BM_BufferPool *const bm);
 extern int getNumWriteIO(BM_BufferPool *const bm);
+extern int getNumWriteIOSaved(BM_BufferPool *const bm);
+extern int getNumPagesCleaned(BM_BufferPool *const bm);
+extern int getNumStallsAvoided(BM_BufferPool *const bm);
+extern int getPoolPageSize(BM_BufferPool *const bm);
+extern RC getPoolStorageStats(BM_BufferPool *const bm, SM_IOStats *stats);
 
 #endif /* BUFFER_MANAGER_H */
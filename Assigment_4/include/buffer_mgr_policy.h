@@ -0,0 +1,103 @@
+/************************************************************
+ * File name:      buffer_mgr_policy.h
+ * CS 525 Advanced Database Organization (Spring 2025)
+ * Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ * Description:
+ *   This header file defines the interface between the buffer
+ *   pool and its page replacement policies: the callbacks a
+ *   policy implements, and the configuration initBufferPool
+ *   takes through its stratData parameter.
+ ************************************************************/
+#ifndef BUFFER_MGR_POLICY_H
+#define BUFFER_MGR_POLICY_H
+
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*------------------------------------------------------------
+ * Strategy Configuration
+ *-----------------------------------------------------------*/
+
+/*
+ * Configuration for initBufferPool, passed as its stratData. A NULL
+ * stratData, or a field left 0, keeps the default; negative values
+ * are rejected.
+ */
+typedef struct BM_StrategyConfig {
+    int k;              // RS_LRU_K: how many of a page's latest accesses rank it (default 2)
+    int arcTarget;      // RS_ARC: initial target size of T1 in frames, at most the pool size (default 0)
+    int a1inFrames;     // RS_2Q: frames the probation queue A1in holds (default a quarter of the pool)
+    int a1outPages;     // RS_2Q: evicted pages A1out remembers (default half the pool)
+    const struct BM_ReplacementPolicy *policy; // used instead of the strategy's own policy when set
+} BM_StrategyConfig;
+
+/*------------------------------------------------------------
+ * Replacement Policy Interface
+ *-----------------------------------------------------------*/
+
+/*
+ * A page replacement policy. The pool keeps the frames, the page
+ * table and the list of unpinned frames (PageCache.lruHead, empty
+ * frames first, then in the order their last pin was released), and
+ * tells the policy about every access through these callbacks. A
+ * policy keeps its own state in PageCache.policyState and per-frame
+ * state in Frame.meta. Callbacks other than pick_victim may be NULL.
+ *
+ * PageCache.accessClock has already been advanced when on_hit and
+ * on_load run.
+ */
+typedef struct BM_ReplacementPolicy {
+    const char *name;
+
+    /*
+     * Sets up the policy's state for a new pool. config is never NULL;
+     * fields left 0 take their defaults.
+     */
+    RC (*init)(PageCache *pageCache, const BM_StrategyConfig *config);
+
+    /* Releases the policy's state when the pool shuts down. */
+    void (*shutdown)(PageCache *pageCache);
+
+    /*
+     * A page already in the pool was pinned again; frame->fixCount
+     * includes the new pin, so 1 means the frame was unpinned.
+     */
+    void (*on_hit)(PageCache *pageCache, Frame *frame);
+
+    /* A page was loaded into frame, which holds one pin. */
+    void (*on_load)(PageCache *pageCache, Frame *frame);
+
+    /* The last pin of frame, which holds a page, was released. */
+    void (*on_unpin)(PageCache *pageCache, Frame *frame);
+
+    /*
+     * Picks the page to replace for a miss on pageNum. Runs only when no
+     * frame is empty and some frame is unpinned, and must return an
+     * unpinned frame.
+     */
+    Frame *(*pick_victim)(PageCache *pageCache, PageNumber pageNum);
+
+    /*
+     * The page of frame leaves the pool: it was picked as a victim, or,
+     * while frame is still pinned, the read that was to fill it, or the
+     * write back of the page it replaced, failed.
+     */
+    void (*on_evict)(PageCache *pageCache, Frame *frame);
+} BM_ReplacementPolicy;
+
+/*
+ * Returns the built-in policy implementing strategy, or NULL if there
+ * is none.
+ */
+const BM_ReplacementPolicy *getReplacementPolicy(ReplacementStrategy strategy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUFFER_MGR_POLICY_H
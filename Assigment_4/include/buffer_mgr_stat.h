@@ -24,9 +24,10 @@ void printPoolContent(BM_BufferPool *const bm);
  * Prints the content of a page to standard output.
  * Used for debugging to inspect the data within a specific page.
  *
+ * @param bm: The buffer pool the page is pinned in; its file's page size is printed.
  * @param page: The page handle representing the page to print.
  */
-void printPageContent(BM_PageHandle *const page);
+void printPageContent(BM_BufferPool *const bm, BM_PageHandle *const page);
 
 /*
  * Returns a string representation of the contents of the buffer pool.
@@ -41,10 +42,11 @@ char *sprintPoolContent(BM_BufferPool *const bm);
  * Returns a string representation of the content of a page.
  * The caller is responsible for freeing the allocated memory.
  *
+ * @param bm: The buffer pool the page is pinned in; its file's page size is printed.
  * @param page: The page handle representing the page.
  * @return: A dynamically allocated string representing the page's content.
  */
-char *sprintPageContent(BM_PageHandle *const page);
+char *sprintPageContent(BM_BufferPool *const bm, BM_PageHandle *const page);
 
 /* Statistics Functions */
 
@@ -77,6 +79,32 @@ int getNumReadIO(BM_BufferPool *const bm);
  */
 int getNumWriteIO(BM_BufferPool *const bm);
 
+/*
+ * Returns how many page writes forceFlushPool saved by merging pages with
+ * consecutive page numbers into one vectored write: pages written by the
+ * flushes minus the writes issued for them.
+ */
+int getNumWriteIOSaved(BM_BufferPool *const bm);
+
+/*
+ * Returns how many dirty pages the pool's page cleaner (startPageCleaner)
+ * wrote back.
+ */
+int getNumPagesCleaned(BM_BufferPool *const bm);
+
+/*
+ * Returns how many evictions found their victim already written back by the
+ * page cleaner: misses that would otherwise have written a dirty page before
+ * reading their own.
+ */
+int getNumStallsAvoided(BM_BufferPool *const bm);
+
+/*
+ * Copies the storage manager's I/O counters and latency histograms for the
+ * pool's page file, the physical I/O beneath getNumReadIO / getNumWriteIO.
+ */
+RC getPoolStorageStats(BM_BufferPool *const bm, SM_IOStats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,7 +11,7 @@
 /* ------------------------------- */
 /*         Module Constants        */
 /* ------------------------------- */
-#define PAGE_SIZE 4096  /* Page size in bytes */
+#define PAGE_SIZE 4096  /* Default page size in bytes; files record their own */
 
 /* RC (Return Code) is defined as an integer */
 typedef int RC;
@@ -25,6 +25,8 @@ typedef int RC;
 #define RC_FILE_HANDLE_NOT_INIT         -2    /* File handle not initialized */
 #define RC_WRITE_FAILED                 -3    /* Write failed */
 #define RC_READ_NON_EXISTING_PAGE       -4    /* Attempt to read a non-existent page */
+#define RC_PAGE_ALREADY_FREE            -5    /* freePage on a page that is already free */
+#define RC_PAGE_CORRUPT                 -6    /* Stored page could not be decoded */
 
 /* ------------------------------- */
 /*       Buffer Manager Errors     */
@@ -0,0 +1,34 @@
+/************************************************************
+ *     File name:                lz_codec.h
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ *  Small LZ77-style block codec used by the compressed page
+ *  file mode. The stream is a sequence of
+ *      token | literal length ext | literals | offset | match length ext
+ *  in the spirit of LZ4, with no outside dependencies.
+ ************************************************************/
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compresses srcLen bytes of src into dst. Returns the compressed length,
+ * or -1 if the result would not fit in dstCapacity bytes.
+ */
+extern int lzCompress(const char *src, int srcLen, char *dst, int dstCapacity);
+
+/*
+ * Decompresses srcLen bytes of src into dst. Returns the number of bytes
+ * produced, or -1 if the input is malformed or exceeds dstCapacity.
+ */
+extern int lzDecompress(const char *src, int srcLen, char *dst, int dstCapacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LZ_CODEC_H
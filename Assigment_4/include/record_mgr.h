@@ -63,7 +63,7 @@ extern RC getAttr(Record *record, Schema *schema, int attrNum, Value **value);
 extern RC setAttr(Record *record, Schema *schema, int attrNum, Value *value);
 
 /* Helper Function */
-extern PageDirectory *createPageDirectoryNode(int pageNum);
+extern PageDirectory *createPageDirectoryNode(PageNumber pageNum);
 
 #ifdef __cplusplus
 }
@@ -115,7 +115,7 @@ typedef struct VarString {
 #define ENSURE_SIZE(var, newsize)                             \
 if ((size_t)(var)->bufsize < (size_t)(newsize)) {         \
 int newbufsize = (var)->bufsize;                      \
-while ((size_t)(newbufsize * 2) < (size_t)(newsize))  \
+while ((size_t)newbufsize < (size_t)(newsize))        \
 newbufsize *= 2;                                  \
 (var)->buf = realloc((var)->buf, newbufsize);         \
 (var)->bufsize = newbufsize;                          \
@@ -225,6 +225,9 @@ extern PageDirectory * parsePageDirectory(char *t);
 /* Parses a record from a tokenized string representation based on the schema. */
 extern void parseRecord(Schema *schema, Record *record, char *token);
 
+/* Digits a page number takes in a serialized page directory: any 64-bit PageNumber fits. */
+#define PAGE_NUMBER_DIGITS 19
+
 /* Converts page information to a string representation.
  * Parameters:
  *   j    - Page index.
@@ -10,35 +10,178 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include "dberror.h"
 
 /* --- Handle Data Structures --- */
 
+/*
+ * Page numbers are 64-bit so page files are not limited to 2^31 pages.
+ * File offsets are always computed in off_t from the page number.
+ */
+typedef int64_t PageNumber;
+
 /* File handle for a page file */
 typedef struct SM_FileHandle {
     char *fileName;       /* Name of the file */
-    int totalNumPages;    /* Total number of pages in the file */
-    int curPagePos;       /* Current page position */
+    PageNumber totalNumPages; /* Total number of pages in the file */
+    PageNumber curPagePos;    /* Current page position */
+    int pageSize;         /* Bytes per page, read from the file header */
     void *mgmtInfo;       /* Management information (implementation-specific) */
 } SM_FileHandle;
 
 /* Page handle: pointer to a page's data in memory */
 typedef char *SM_PageHandle;
 
+/* I/O backend used to access a page file */
+typedef enum SM_IOMode {
+    SM_IO_STDIO = 0,       /* Buffered FILE* stream: fseek + fread/fwrite */
+    SM_IO_POSITIONAL = 1,  /* Raw descriptor: pread/pwrite, no stdio copy, thread-safe reads */
+    SM_IO_MMAP = 2,        /* Whole file mapped: zero-copy page pointers, msync on flush */
+    SM_IO_DIRECT = 3,      /* Raw descriptor opened with O_DIRECT: bypasses the kernel page cache */
+    SM_IO_COMPRESSED = 4,  /* Pages LZ-compressed into variable-size extents, read with pread */
+    SM_IO_MEMORY = 5       /* Pages kept in process memory only; the file never touches disk */
+} SM_IOMode;
+
+/*
+ * How far ahead disk space is reserved when a file grows. The file size
+ * always matches totalNumPages; only the reservation past end of file
+ * follows the policy, so most extensions reuse blocks already allocated.
+ */
+typedef enum SM_GrowthPolicy {
+    SM_GROW_EXACT = 0,     /* Reserve only the pages requested */
+    SM_GROW_PERCENT = 1,   /* Reserve amount percent beyond the new size */
+    SM_GROW_CHUNK = 2      /* Reserve up to the next multiple of amount pages */
+} SM_GrowthPolicy;
+
+/*
+ * What a force (flushBlocks, forcePage, forceFlushPool) waits for once
+ * the pages have been handed to the kernel.
+ */
+typedef enum SM_Durability {
+    SM_DURABILITY_NONE = 0,          /* Nothing: a crash may lose forced pages */
+    SM_DURABILITY_SYNC_ON_FORCE = 1, /* One fdatasync per force */
+    SM_DURABILITY_GROUP_COMMIT = 2   /* Concurrent forces share one fdatasync per interval */
+} SM_Durability;
+
+/*
+ * Shortest time between two group-commit syncs unless configured. With 0,
+ * forces arriving while a sync runs share the next one, which follows at once.
+ */
+#define SM_DEFAULT_GROUP_INTERVAL_US 0
+
+/*
+ * Descriptors the open-file cache keeps open unless configured. Files in
+ * use are never closed, so the cache may exceed it while they are open.
+ */
+#define SM_DEFAULT_FILE_CACHE_BUDGET 64
+
+/* Open-file cache counters (see getFileCacheStats) */
+typedef struct SM_FileCacheStats {
+    int64_t hits;         /* Opens served by a cached descriptor */
+    int64_t misses;       /* Opens that had to open and probe the file */
+    int64_t evictions;    /* Idle descriptors closed to stay within the budget */
+    int openFiles;        /* Descriptors currently cached, in use or idle */
+} SM_FileCacheStats;
+
+/*
+ * I/O statistics of an open file (see getStorageStats): what the storage
+ * manager itself read and wrote, beneath any buffer pool. Latencies are
+ * kept per read or write call in log2 buckets: bucket b counts calls that
+ * took [2^b, 2^(b+1)) nanoseconds, the last bucket also everything longer.
+ */
+#define SM_LATENCY_BUCKETS 32
+
+typedef struct SM_IOStats {
+    int64_t reads;        /* Pages read */
+    int64_t writes;       /* Pages written */
+    int64_t bytesRead;    /* Page bytes read */
+    int64_t bytesWritten; /* Page bytes written */
+    int64_t extensions;   /* Times the file grew */
+    int64_t syncs;        /* Syncs issued by forces */
+    int64_t readLatency[SM_LATENCY_BUCKETS];
+    int64_t writeLatency[SM_LATENCY_BUCKETS];
+} SM_IOStats;
+
+/* How a range of pages is about to be accessed (see adviseBlocks) */
+typedef enum SM_Advice {
+    SM_ADVICE_NORMAL = 0,      /* No particular pattern: default read-ahead */
+    SM_ADVICE_SEQUENTIAL = 1,  /* Read in page order: deep read-ahead */
+    SM_ADVICE_RANDOM = 2,      /* Point lookups: no read-ahead */
+    SM_ADVICE_WILLNEED = 3,    /* Needed soon: start reading the range now */
+    SM_ADVICE_DONTNEED = 4     /* Not needed again soon: drop it from the page cache */
+} SM_Advice;
+
+/* Buffer alignment required by SM_IO_DIRECT; unaligned pages are bounced */
+#define SM_IO_ALIGNMENT 4096
+
+/*
+ * Page sizes a file may be created with: powers of two in this range.
+ * PAGE_SIZE (dberror.h) is the default for new files.
+ */
+#define SM_MIN_PAGE_SIZE 4096
+#define SM_MAX_PAGE_SIZE 65536
+
 /* --- Interface Functions --- */
 
 /* Storage Manager Initialization */
 extern void initStorageManager(void);
 
-/* Page File Operations */
+/* I/O Backend Selection (default: SM_IO_POSITIONAL) */
+extern void setStorageIOMode(SM_IOMode mode);
+extern SM_IOMode getStorageIOMode(void);
+
+/* Page Size of New Files (default: PAGE_SIZE) */
+extern RC setStoragePageSize(int pageSize);
+extern int getStoragePageSize(void);
+
+/* File Growth (default: SM_GROW_PERCENT, 25) */
+extern void setStorageGrowthPolicy(SM_GrowthPolicy policy, int amount);
+extern RC setFileGrowthPolicy(SM_FileHandle *fHandle, SM_GrowthPolicy policy, int amount);
+extern PageNumber getReservedPages(SM_FileHandle *fHandle);
+
+/* Durability (default: SM_DURABILITY_NONE) */
+extern void setStorageDurability(SM_Durability mode, int groupIntervalUs);
+extern RC setFileDurability(SM_FileHandle *fHandle, SM_Durability mode, int groupIntervalUs);
+extern SM_Durability getFileDurability(SM_FileHandle *fHandle);
+extern int64_t getFileSyncCount(SM_FileHandle *fHandle);
+
+/*
+ * Open-File Cache: on-disk page files share one descriptor per file, and
+ * the header, page count, space reservation, free-page map and (for
+ * compressed files) extent table, across handles and after the last
+ * close. Any number of handles may be open on one file at once, and
+ * group-commit forces through all of them share their syncs.
+ * Cached files must only be changed through the storage manager; call
+ * flushFileCache first otherwise.
+ */
+extern void setFileCacheBudget(int maxOpenFiles);
+extern int getFileCacheBudget(void);
+extern void flushFileCache(void);
+extern void getFileCacheStats(SM_FileCacheStats *stats);
+
+/*
+ * Page File Operations. A page file starts with a header page recording
+ * its page size; openPageFile reads it back into fHandle->pageSize.
+ * Files without a header (written before page sizes were recorded) open
+ * with PAGE_SIZE pages. createPageFile makes a compressed file while the
+ * default mode is SM_IO_COMPRESSED; openPageFile recognises compressed
+ * files by their header and always opens them in that mode. Likewise,
+ * createPageFile makes an in-memory file while the default mode is
+ * SM_IO_MEMORY; it lives until destroyPageFile or exit, and openPageFile
+ * finds it by name in any mode.
+ */
 extern RC createPageFile(char *fileName);
+extern RC createPageFileWithPageSize(char *fileName, int pageSize);
 extern RC openPageFile(char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileWithMode(char *fileName, SM_FileHandle *fHandle, SM_IOMode mode);
 extern RC closePageFile(SM_FileHandle *fHandle);
 extern RC destroyPageFile(char *fileName);
+extern int pageFileExists(char *fileName);
 
 /* Reading Blocks from Disk */
-extern RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos(SM_FileHandle *fHandle);
+extern RC readBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern PageNumber getBlockPos(SM_FileHandle *fHandle);
 extern RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -46,10 +189,44 @@ extern RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
 
 /* Writing Blocks to Disk */
-extern RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock(SM_FileHandle *fHandle);
-extern RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity(PageNumber numberOfPages, SM_FileHandle *fHandle);
+
+/*
+ * Free-Page Map: freed pages are recorded in a bitmap kept in the
+ * "<fileName>.fsm" fork and reused by allocatePage before the file grows.
+ * Free pages at the end of the file are truncated away, unless the file
+ * is mapped (SM_IO_MMAP) or open through other handles: then they stay in
+ * the map, so no handle or page pointer is left past end of file. All
+ * handles on a file share one map, so a page freed through one is reused
+ * through any.
+ */
+extern RC allocatePage(SM_FileHandle *fHandle, PageNumber *pageNum);
+extern RC freePage(SM_FileHandle *fHandle, PageNumber pageNum);
+extern PageNumber getFreePageCount(SM_FileHandle *fHandle);
+
+/* Vectored Multi-Page I/O: page startPage + i moves to/from bufs[i] */
+extern RC readBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle bufs[]);
+extern RC writeBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle bufs[]);
+
+/* Memory-Mapped Access (SM_IO_MMAP, SM_IO_MEMORY) */
+extern SM_IOMode getFileIOMode(SM_FileHandle *fHandle);
+extern int getFileDescriptor(SM_FileHandle *fHandle);
+extern int64_t getPageOffset(SM_FileHandle *fHandle, PageNumber pageNum);
+extern RC getPagePointer(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle *pagePtr);
+extern RC flushBlocks(PageNumber startPage, PageNumber numPages, SM_FileHandle *fHandle);
+
+/* I/O Statistics: counted per open handle, from open or the last reset; latencies timed unless disabled */
+extern void setStorageIOTiming(int enabled);
+extern RC getStorageStats(SM_FileHandle *fHandle, SM_IOStats *stats);
+extern RC resetStorageStats(SM_FileHandle *fHandle);
+extern void printStorageStats(SM_FileHandle *fHandle);
+extern void recordStorageIO(SM_FileHandle *fHandle, int isWrite, int numPages, int64_t nanos);
+
+/* Access-Pattern Hints: numPages 0 covers the rest of the file */
+extern RC adviseBlocks(PageNumber startPage, PageNumber numPages, SM_FileHandle *fHandle, SM_Advice advice);
 
 #ifdef __cplusplus
 }
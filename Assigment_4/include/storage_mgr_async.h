@@ -0,0 +1,74 @@
+/************************************************************
+ *     File name:                storage_mgr_async.h
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ *  Asynchronous page I/O on top of the storage manager.
+ *  Requests are submitted to a queue, run concurrently, and
+ *  are collected later with pollAsync / waitAsync. Linux uses
+ *  io_uring (raw syscalls, no liburing); elsewhere, or when
+ *  io_uring is unavailable, a pool of worker threads issues
+ *  the blocking readBlocks / writeBlocks calls.
+ ************************************************************/
+#ifndef STORAGE_MGR_ASYNC_H
+#define STORAGE_MGR_ASYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dberror.h"
+#include "storage_mgr.h"
+
+/* Kind of transfer */
+typedef enum SM_AsyncOp {
+    SM_ASYNC_READ = 0,
+    SM_ASYNC_WRITE = 1
+} SM_AsyncOp;
+
+/* Mechanism used to run requests */
+typedef enum SM_AsyncBackend {
+    SM_ASYNC_AUTO = 0,       /* io_uring when available, worker threads otherwise */
+    SM_ASYNC_IO_URING = 1,   /* Linux io_uring only; creation fails if unavailable */
+    SM_ASYNC_THREADS = 2     /* Worker threads calling readBlocks / writeBlocks */
+} SM_AsyncBackend;
+
+/*
+ * One request: numPages consecutive pages starting at pageNum,
+ * page pageNum + i moving to/from bufs[i]. The request and bufs
+ * must stay alive until the request is returned as completed.
+ */
+typedef struct SM_AsyncRequest {
+    SM_AsyncOp op;                   /* Read or write */
+    PageNumber pageNum;              /* First page of the run */
+    int numPages;                    /* Number of consecutive pages */
+    SM_PageHandle *bufs;             /* One page-size buffer per page */
+    void *userData;                  /* Caller cookie, untouched by the queue */
+    RC result;                       /* Set when the request completes */
+    struct SM_AsyncRequest *next;    /* Internal: queue linkage */
+    void *iov;                       /* Internal: io_uring iovec array */
+    int64_t submitNanos;             /* Internal: io_uring submission time, for statistics */
+} SM_AsyncRequest;
+
+/* Opaque submission/completion queue bound to one open page file */
+typedef struct SM_AsyncQueue SM_AsyncQueue;
+
+/* Queue Lifetime */
+extern RC createAsyncQueue(SM_FileHandle *fHandle, int depth, SM_AsyncBackend backend,
+                           SM_AsyncQueue **queue);
+extern RC destroyAsyncQueue(SM_AsyncQueue *queue);
+extern SM_AsyncBackend getAsyncBackend(SM_AsyncQueue *queue);
+
+/* Submission: blocks only while depth requests are already in flight */
+extern RC submitAsync(SM_AsyncQueue *queue, SM_AsyncRequest *request);
+
+/* Completion: collect up to max finished requests */
+extern RC pollAsync(SM_AsyncQueue *queue, SM_AsyncRequest **done, int max, int *numDone);
+extern RC waitAsync(SM_AsyncQueue *queue, SM_AsyncRequest **done, int min, int max, int *numDone);
+extern int getAsyncInFlight(SM_AsyncQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORAGE_MGR_ASYNC_H
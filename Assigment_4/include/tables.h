@@ -10,6 +10,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include "dt.h"  // Defines bool and DataType
 
 /* --- Data Types, Records, and Schemas --- */
@@ -33,9 +34,9 @@ extern "C" {
         } v;
     } Value;
 
-/* Record Identifier (RID) */
+/* Record Identifier (RID); page is 64-bit like PageNumber in storage_mgr.h */
 typedef struct RID {
-    int page;
+    int64_t page;
     int slot;
 } RID;
 
@@ -66,7 +67,7 @@ typedef struct RM_TableData {
 
 /* PageDirectory: used to track free slots on a page */
 typedef struct PageDirectory {
-    int pageNum;
+    int64_t pageNum;
     int count;
     int firstFreeSlot;
     struct PageDirectory *pre;
@@ -83,7 +84,7 @@ typedef struct PageDirectoryCache {
 
 /* RecordNode: used for linking records in memory */
 typedef struct RecordNode {
-    int page;
+    int64_t page;
     int slot;
     char *data;
     struct RecordNode *pre;
@@ -0,0 +1,1126 @@
+/************************************************************
+ *     File name:                bench_storage_mgr.c
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ *  Micro-benchmarks for the storage manager. Each benchmark
+ *  builds its own page file, reports throughput, and removes
+ *  the file afterwards. Run without arguments for all of them,
+ *  or pass benchmark names to select a subset.
+ ************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "storage_mgr.h"
+#include "storage_mgr_async.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "dberror.h"
+
+#define BENCH_FILE       "bench_storage.bin"
+#define BENCH_NUM_PAGES  16384      /* 64 MB page file */
+#define BENCH_NUM_READS  200000     /* random reads per run */
+#define BENCH_ASYNC_READS 20000     /* direct random reads per queue-depth run */
+
+/* Aborts the benchmark on any storage error */
+#define BENCH_CHECK(code)                                               \
+    do {                                                                \
+        RC rc_internal = (code);                                        \
+        if (rc_internal != RC_OK) {                                     \
+            printf("[%s-L%i] benchmark failed: rc=%d\n",                \
+                   __FILE__, __LINE__, rc_internal);                    \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* xorshift PRNG so every thread has an independent, cheap stream */
+static unsigned int nextRandom(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* Creates BENCH_FILE with numPages pages, each stamped with its page number */
+static void buildPageFile(int numPages) {
+    SM_FileHandle fh;
+    char *page = (char *) calloc(PAGE_SIZE, sizeof(char));
+
+    BENCH_CHECK(createPageFile(BENCH_FILE));
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, SM_IO_POSITIONAL));
+    BENCH_CHECK(ensureCapacity(numPages, &fh));
+    for (int i = 0; i < numPages; i++) {
+        memcpy(page, &i, sizeof(int));
+        BENCH_CHECK(writeBlock(i, &fh, page));
+    }
+    BENCH_CHECK(closePageFile(&fh));
+    free(page);
+}
+
+/* ------------------------------------------------------------
+ * Random 4 KB reads: stdio vs. positional vs. memory, 1..8 threads
+ * ------------------------------------------------------------ */
+
+typedef struct ReadWorker {
+    SM_FileHandle *fh;
+    int numReads;
+    unsigned int seed;
+} ReadWorker;
+
+static void *randomReadWorker(void *arg) {
+    ReadWorker *w = (ReadWorker *) arg;
+    char *page = NULL;
+    if (posix_memalign((void **) &page, SM_IO_ALIGNMENT, PAGE_SIZE) != 0)
+        exit(1);
+    for (int i = 0; i < w->numReads; i++) {
+        int pageNum = (int) (nextRandom(&w->seed) % BENCH_NUM_PAGES);
+        BENCH_CHECK(readBlock(pageNum, w->fh, page));
+        int stamp;
+        memcpy(&stamp, page, sizeof(int));
+        if (stamp != pageNum) {
+            printf("page %d returned content of page %d\n", pageNum, stamp);
+            exit(1);
+        }
+    }
+    free(page);
+    return NULL;
+}
+
+static void runRandomRead(SM_IOMode mode, const char *label, int numThreads) {
+    SM_FileHandle fh;
+    pthread_t threads[8];
+    ReadWorker workers[8];
+
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, mode));
+    double start = nowSeconds();
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].fh = &fh;
+        workers[t].numReads = BENCH_NUM_READS / numThreads;
+        workers[t].seed = 2463534242u + (unsigned int) t * 7919u;
+        pthread_create(&threads[t], NULL, randomReadWorker, &workers[t]);
+    }
+    for (int t = 0; t < numThreads; t++)
+        pthread_join(threads[t], NULL);
+    double elapsed = nowSeconds() - start;
+    BENCH_CHECK(closePageFile(&fh));
+
+    printf("  %-11s threads=%d  %9.0f reads/s  %7.1f MB/s\n", label, numThreads,
+           BENCH_NUM_READS / elapsed,
+           (double) BENCH_NUM_READS * PAGE_SIZE / elapsed / (1024.0 * 1024.0));
+}
+
+static void benchRandomRead(void) {
+    printf("random 4 KB reads (%d pages, %d reads, warm page cache)\n",
+           BENCH_NUM_PAGES, BENCH_NUM_READS);
+    buildPageFile(BENCH_NUM_PAGES);
+
+    /* A FILE* has a single shared position, so stdio only runs single-threaded */
+    runRandomRead(SM_IO_STDIO, "stdio", 1);
+    for (int threads = 1; threads <= 8; threads *= 2)
+        runRandomRead(SM_IO_POSITIONAL, "positional", threads);
+    /* Bypasses the page cache, so every read reaches the device */
+    runRandomRead(SM_IO_DIRECT, "direct", 1);
+    destroyPageFile(BENCH_FILE);
+
+    /* The same file held in memory: the cost of the layer without any I/O */
+    setStorageIOMode(SM_IO_MEMORY);
+    buildPageFile(BENCH_NUM_PAGES);
+    for (int threads = 1; threads <= 8; threads *= 2)
+        runRandomRead(SM_IO_MEMORY, "memory", threads);
+    /* Without latency timing: what the two clock reads per call cost */
+    setStorageIOTiming(0);
+    runRandomRead(SM_IO_MEMORY, "mem-untimed", 1);
+    setStorageIOTiming(1);
+    destroyPageFile(BENCH_FILE);
+    setStorageIOMode(SM_IO_POSITIONAL);
+}
+
+/* ------------------------------------------------------------
+ * Sequential scan: one readBlock per page vs. vectored readBlocks
+ * ------------------------------------------------------------ */
+
+static void runSequentialScan(int pagesPerCall) {
+    SM_FileHandle fh;
+    char *arena = NULL;
+    SM_PageHandle bufs[256];
+
+    if (posix_memalign((void **) &arena, SM_IO_ALIGNMENT, (size_t) pagesPerCall * PAGE_SIZE) != 0)
+        exit(1);
+    for (int i = 0; i < pagesPerCall; i++)
+        bufs[i] = arena + (size_t) i * PAGE_SIZE;
+
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, SM_IO_POSITIONAL));
+    double start = nowSeconds();
+    for (int pass = 0; pass < 4; pass++) {
+        for (int page = 0; page < BENCH_NUM_PAGES; page += pagesPerCall) {
+            if (pagesPerCall == 1)
+                BENCH_CHECK(readBlock(page, &fh, bufs[0]));
+            else
+                BENCH_CHECK(readBlocks(page, pagesPerCall, &fh, bufs));
+        }
+    }
+    double elapsed = nowSeconds() - start;
+    BENCH_CHECK(closePageFile(&fh));
+    free(arena);
+
+    double pages = 4.0 * BENCH_NUM_PAGES;
+    printf("  pages/call=%-4d %9.0f pages/s  %7.1f MB/s  %8.0f calls\n", pagesPerCall,
+           pages / elapsed, pages * PAGE_SIZE / elapsed / (1024.0 * 1024.0),
+           pages / pagesPerCall);
+}
+
+static void benchVectoredScan(void) {
+    printf("sequential scan (%d pages x 4 passes, warm page cache)\n", BENCH_NUM_PAGES);
+    buildPageFile(BENCH_NUM_PAGES);
+    runSequentialScan(1);
+    runSequentialScan(16);
+    runSequentialScan(64);
+    runSequentialScan(256);
+    destroyPageFile(BENCH_FILE);
+}
+
+/* ------------------------------------------------------------
+ * Asynchronous random direct reads at queue depth 1..64
+ * ------------------------------------------------------------ */
+
+static void runQueueDepth(SM_AsyncBackend backend, int depth) {
+    SM_FileHandle fh;
+    SM_AsyncQueue *queue;
+    SM_AsyncRequest requests[64];
+    SM_AsyncRequest *done[64];
+    SM_PageHandle bufs[64];
+    char *arena = NULL;
+    unsigned int seed = 88172645u;
+
+    if (posix_memalign((void **) &arena, SM_IO_ALIGNMENT, (size_t) depth * PAGE_SIZE) != 0)
+        exit(1);
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, SM_IO_DIRECT));
+    if (createAsyncQueue(&fh, depth, backend, &queue) != RC_OK) {
+        printf("  %-9s unavailable\n", backend == SM_ASYNC_IO_URING ? "io_uring" : "threads");
+        closePageFile(&fh);
+        free(arena);
+        return;
+    }
+
+    /* Keep depth requests outstanding; each slot is resubmitted as it completes */
+    double start = nowSeconds();
+    int submitted = 0;
+    int completed = 0;
+    for (int i = 0; i < depth; i++) {
+        bufs[i] = arena + (size_t) i * PAGE_SIZE;
+        memset(&requests[i], 0, sizeof(SM_AsyncRequest));
+        requests[i].op = SM_ASYNC_READ;
+        requests[i].numPages = 1;
+        requests[i].bufs = &bufs[i];
+        requests[i].pageNum = (int) (nextRandom(&seed) % BENCH_NUM_PAGES);
+        BENCH_CHECK(submitAsync(queue, &requests[i]));
+        submitted++;
+    }
+    while (completed < BENCH_ASYNC_READS) {
+        int numDone;
+        BENCH_CHECK(waitAsync(queue, done, 1, depth, &numDone));
+        for (int i = 0; i < numDone; i++) {
+            SM_AsyncRequest *r = done[i];
+            int stamp;
+            BENCH_CHECK(r->result);
+            memcpy(&stamp, r->bufs[0], sizeof(int));
+            if (stamp != r->pageNum) {
+                printf("page %lld returned content of page %d\n", (long long) r->pageNum, stamp);
+                exit(1);
+            }
+            completed++;
+            if (submitted < BENCH_ASYNC_READS) {
+                r->pageNum = (int) (nextRandom(&seed) % BENCH_NUM_PAGES);
+                BENCH_CHECK(submitAsync(queue, r));
+                submitted++;
+            }
+        }
+    }
+    double elapsed = nowSeconds() - start;
+    BENCH_CHECK(destroyAsyncQueue(queue));
+    BENCH_CHECK(closePageFile(&fh));
+    free(arena);
+
+    printf("  %-9s QD=%-3d %9.0f IOPS  %7.1f MB/s\n",
+           backend == SM_ASYNC_IO_URING ? "io_uring" : "threads", depth,
+           BENCH_ASYNC_READS / elapsed,
+           (double) BENCH_ASYNC_READS * PAGE_SIZE / elapsed / (1024.0 * 1024.0));
+}
+
+static void benchQueueDepth(void) {
+    printf("random 4 KB direct reads through the async queue (%d pages, %d reads)\n",
+           BENCH_NUM_PAGES, BENCH_ASYNC_READS);
+    buildPageFile(BENCH_NUM_PAGES);
+    for (int depth = 1; depth <= 64; depth *= 2)
+        runQueueDepth(SM_ASYNC_IO_URING, depth);
+    for (int depth = 1; depth <= 64; depth *= 2)
+        runQueueDepth(SM_ASYNC_THREADS, depth);
+    destroyPageFile(BENCH_FILE);
+}
+
+/* ------------------------------------------------------------
+ * File extension: one page per appendEmptyBlock, per growth policy
+ * ------------------------------------------------------------ */
+
+static void runAppend(SM_IOMode mode, const char *label, SM_GrowthPolicy policy, int amount) {
+    SM_FileHandle fh;
+
+    BENCH_CHECK(createPageFile(BENCH_FILE));
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, mode));
+    BENCH_CHECK(setFileGrowthPolicy(&fh, policy, amount));
+    double start = nowSeconds();
+    for (int i = 1; i < BENCH_NUM_PAGES; i++)
+        BENCH_CHECK(appendEmptyBlock(&fh));
+    double elapsed = nowSeconds() - start;
+    BENCH_CHECK(closePageFile(&fh));
+    destroyPageFile(BENCH_FILE);
+
+    const char *names[] = { "exact", "percent", "chunk" };
+    printf("  %-11s %-7s %5d  %9.0f appends/s\n", label, names[policy], amount,
+           (BENCH_NUM_PAGES - 1) / elapsed);
+}
+
+static void benchAppend(void) {
+    printf("append %d pages one at a time\n", BENCH_NUM_PAGES);
+    SM_IOMode modes[] = { SM_IO_STDIO, SM_IO_POSITIONAL };
+    const char *labels[] = { "stdio", "positional" };
+    for (int m = 0; m < 2; m++) {
+        runAppend(modes[m], labels[m], SM_GROW_EXACT, 0);
+        runAppend(modes[m], labels[m], SM_GROW_PERCENT, 25);
+        runAppend(modes[m], labels[m], SM_GROW_CHUNK, 1024);
+    }
+}
+
+/* ------------------------------------------------------------
+ * Commits: write one page and force it, per durability mode
+ * ------------------------------------------------------------ */
+
+#define BENCH_COMMIT_SECONDS 0.5
+
+typedef struct CommitWorker {
+    SM_FileHandle *fh;
+    int pageNum;
+    double deadline;
+    long commits;
+} CommitWorker;
+
+static void *commitWorker(void *arg) {
+    CommitWorker *w = (CommitWorker *) arg;
+    char *page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    while (nowSeconds() < w->deadline) {
+        memcpy(page, &w->commits, sizeof(long));
+        BENCH_CHECK(writeBlock(w->pageNum, w->fh, page));
+        BENCH_CHECK(flushBlocks(w->pageNum, 1, w->fh));
+        w->commits++;
+    }
+    free(page);
+    return NULL;
+}
+
+static void runCommit(SM_Durability mode, int intervalUs, int numThreads) {
+    SM_FileHandle fh;
+    pthread_t threads[8];
+    CommitWorker workers[8];
+
+    BENCH_CHECK(createPageFile(BENCH_FILE));
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, SM_IO_POSITIONAL));
+    BENCH_CHECK(ensureCapacity(numThreads, &fh));
+    BENCH_CHECK(setFileDurability(&fh, mode, intervalUs));
+
+    double start = nowSeconds();
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].fh = &fh;
+        workers[t].pageNum = t;
+        workers[t].deadline = start + BENCH_COMMIT_SECONDS;
+        workers[t].commits = 0;
+        pthread_create(&threads[t], NULL, commitWorker, &workers[t]);
+    }
+    long commits = 0;
+    for (int t = 0; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+        commits += workers[t].commits;
+    }
+    double elapsed = nowSeconds() - start;
+    long long syncs = (long long) getFileSyncCount(&fh);
+    BENCH_CHECK(closePageFile(&fh));
+    destroyPageFile(BENCH_FILE);
+
+    const char *names[] = { "none", "sync-on-force", "group-commit" };
+    printf("  %-13s %5d us  threads=%d  %9.0f commits/s  %6.2f commits/sync\n", names[mode], intervalUs,
+           numThreads, commits / elapsed, syncs > 0 ? (double) commits / syncs : 0.0);
+}
+
+static void benchCommit(void) {
+    printf("commits: write one 4 KB page and force it (%.1f s per run)\n", BENCH_COMMIT_SECONDS);
+    for (int threads = 1; threads <= 8; threads *= 8) {
+        runCommit(SM_DURABILITY_NONE, 0, threads);
+        runCommit(SM_DURABILITY_SYNC_ON_FORCE, 0, threads);
+        /* Interval 0 batches the forces that arrive during a sync; longer ones trade latency for fewer syncs */
+        for (int interval = 0; interval <= 2000; interval = interval ? interval * 4 : 500)
+            runCommit(SM_DURABILITY_GROUP_COMMIT, interval, threads);
+    }
+}
+
+/* ------------------------------------------------------------
+ * Compression: stored size and scan throughput, plain vs. compressed
+ * ------------------------------------------------------------ */
+
+/* Fills a page with fixed-width records, as the record manager lays them out */
+static void fillRecordPage(char *page, int pageNum, unsigned int *seed) {
+    memset(page, 0, PAGE_SIZE);
+    for (int r = 0; r < PAGE_SIZE / 64; r++) {
+        unsigned int x = nextRandom(seed);
+        snprintf(page + r * 64, 64, "id=%08d|name=customer-%05u|bal=%7u.%02u|",
+                 pageNum * 64 + r, x % 50000, x % 1000000, x % 100);
+    }
+}
+
+/* Writes the record file through mode, returns its size on disk in bytes */
+static long long buildRecordFile(SM_IOMode mode) {
+    SM_FileHandle fh;
+    char *page = (char *) malloc(PAGE_SIZE);
+    unsigned int seed = 2463534242u;
+    struct stat st;
+
+    setStorageIOMode(mode);
+    BENCH_CHECK(createPageFile(BENCH_FILE));
+    setStorageIOMode(SM_IO_POSITIONAL);
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, mode));
+    BENCH_CHECK(ensureCapacity(BENCH_NUM_PAGES, &fh));
+    for (int i = 0; i < BENCH_NUM_PAGES; i++) {
+        fillRecordPage(page, i, &seed);
+        BENCH_CHECK(writeBlock(i, &fh, page));
+    }
+    BENCH_CHECK(closePageFile(&fh));
+    free(page);
+    return stat(BENCH_FILE, &st) == 0 ? (long long) st.st_size : -1;
+}
+
+/* Pushes the file to disk and drops it from the page cache */
+static void evictFile(void) {
+    int fd = open(BENCH_FILE, O_RDONLY);
+    if (fd < 0)
+        return;
+    fsync(fd);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+}
+
+/* Scans the whole file 64 pages per call and returns MB/s of logical pages */
+static double scanRecordFile(SM_IOMode mode, int cold) {
+    SM_FileHandle fh;
+    SM_PageHandle bufs[64];
+    char *arena = (char *) malloc((size_t) 64 * PAGE_SIZE);
+    for (int i = 0; i < 64; i++)
+        bufs[i] = arena + (size_t) i * PAGE_SIZE;
+
+    if (cold)
+        evictFile();
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, mode));
+    double start = nowSeconds();
+    for (int page = 0; page < BENCH_NUM_PAGES; page += 64)
+        BENCH_CHECK(readBlocks(page, 64, &fh, bufs));
+    double elapsed = nowSeconds() - start;
+    BENCH_CHECK(closePageFile(&fh));
+    free(arena);
+    return (double) BENCH_NUM_PAGES * PAGE_SIZE / elapsed / (1024.0 * 1024.0);
+}
+
+static void benchCompression(void) {
+    SM_IOMode modes[] = { SM_IO_POSITIONAL, SM_IO_COMPRESSED };
+    const char *labels[] = { "plain", "compressed" };
+    long long sizes[2];
+
+    printf("record file scan, %d pages, 64 pages/call (MB/s of 4 KB pages)\n", BENCH_NUM_PAGES);
+    for (int m = 0; m < 2; m++) {
+        sizes[m] = buildRecordFile(modes[m]);
+        double cold = scanRecordFile(modes[m], 1);
+        double warm = scanRecordFile(modes[m], 0);
+        printf("  %-11s %8.1f MB on disk  ratio %5.2f  cold %7.1f MB/s  warm %7.1f MB/s\n",
+               labels[m], sizes[m] / (1024.0 * 1024.0),
+               (double) BENCH_NUM_PAGES * PAGE_SIZE / (double) sizes[m], cold, warm);
+        destroyPageFile(BENCH_FILE);
+    }
+}
+
+/* ------------------------------------------------------------
+ * Access hints: cold reads with and without adviseBlocks
+ * ------------------------------------------------------------ */
+
+/* Bytes this process has read from storage so far, or -1 where unknown */
+static long long deviceReadBytes(void) {
+    long long bytes = -1;
+    FILE *fp = fopen("/proc/self/io", "r");
+    if (fp == NULL)
+        return -1;
+    char line[128];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "read_bytes: %lld", &bytes) == 1)
+            break;
+    }
+    fclose(fp);
+    return bytes;
+}
+
+/* Reads pages of a cold BENCH_FILE one readBlock at a time, randomly or in order */
+static void runAdvise(int sequential, SM_Advice advice, const char *label) {
+    SM_FileHandle fh;
+    char *page = (char *) malloc(PAGE_SIZE);
+    unsigned int seed = 2463534242u;
+    int numReads = sequential ? BENCH_NUM_PAGES : BENCH_ASYNC_READS;
+
+    evictFile();
+    BENCH_CHECK(openPageFileWithMode(BENCH_FILE, &fh, SM_IO_POSITIONAL));
+    BENCH_CHECK(adviseBlocks(0, 0, &fh, advice));
+    long long before = deviceReadBytes();
+    double start = nowSeconds();
+    for (int i = 0; i < numReads; i++) {
+        int pageNum = sequential ? i : (int) (nextRandom(&seed) % BENCH_NUM_PAGES);
+        BENCH_CHECK(readBlock(pageNum, &fh, page));
+    }
+    double elapsed = nowSeconds() - start;
+    long long bytes = deviceReadBytes() - before;
+    BENCH_CHECK(closePageFile(&fh));
+    free(page);
+
+    printf("  %-10s %-10s %9.0f reads/s", sequential ? "sequential" : "random", label, numReads / elapsed);
+    if (before >= 0)
+        printf("  %8.1f MB from storage (%.1f x the pages read)", bytes / (1024.0 * 1024.0),
+               (double) bytes / ((double) numReads * PAGE_SIZE));
+    printf("\n");
+}
+
+static void benchAdvise(void) {
+    printf("cold 4 KB reads, one readBlock per page (%d pages; %d random or all in order)\n",
+           BENCH_NUM_PAGES, BENCH_ASYNC_READS);
+    buildPageFile(BENCH_NUM_PAGES);
+    runAdvise(0, SM_ADVICE_NORMAL, "normal");
+    runAdvise(0, SM_ADVICE_RANDOM, "random");
+    runAdvise(1, SM_ADVICE_NORMAL, "normal");
+    runAdvise(1, SM_ADVICE_SEQUENTIAL, "sequential");
+    runAdvise(1, SM_ADVICE_WILLNEED, "willneed");
+    destroyPageFile(BENCH_FILE);
+}
+
+/* ------------------------------------------------------------
+ * Reopen: open, read one page and close many small files
+ * ------------------------------------------------------------ */
+
+#define BENCH_NUM_TABLES 1000
+#define BENCH_REOPENS    100000
+
+/* Cycles through the first numFiles files; returns opens per second */
+static double runReopen(int numFiles, int budget) {
+    SM_FileHandle fh;
+    char name[32];
+    char *page = (char *) malloc(PAGE_SIZE);
+
+    flushFileCache();
+    setFileCacheBudget(budget);
+    double start = nowSeconds();
+    for (int i = 0; i < BENCH_REOPENS; i++) {
+        snprintf(name, sizeof(name), "bench_table_%d.bin", i % numFiles);
+        BENCH_CHECK(openPageFile(name, &fh));
+        BENCH_CHECK(readBlock(0, &fh, page));
+        BENCH_CHECK(closePageFile(&fh));
+    }
+    double elapsed = nowSeconds() - start;
+    free(page);
+    return BENCH_REOPENS / elapsed;
+}
+
+static void benchReopen(void) {
+    int sizes[] = { 32, BENCH_NUM_TABLES };
+    char name[32];
+
+    printf("open + readBlock + close of small files (%d opens)\n", BENCH_REOPENS);
+    for (int i = 0; i < BENCH_NUM_TABLES; i++) {
+        snprintf(name, sizeof(name), "bench_table_%d.bin", i);
+        BENCH_CHECK(createPageFile(name));
+    }
+    for (int s = 0; s < 2; s++) {
+        double uncached = runReopen(sizes[s], 0);
+        double cached = runReopen(sizes[s], SM_DEFAULT_FILE_CACHE_BUDGET);
+        double large = runReopen(sizes[s], 2 * BENCH_NUM_TABLES);
+        printf("  %4d files   no cache %9.0f opens/s   budget %d %9.0f opens/s   budget %d %9.0f opens/s\n",
+               sizes[s], uncached, SM_DEFAULT_FILE_CACHE_BUDGET, cached, 2 * BENCH_NUM_TABLES, large);
+    }
+    setFileCacheBudget(SM_DEFAULT_FILE_CACHE_BUDGET);
+    for (int i = 0; i < BENCH_NUM_TABLES; i++) {
+        snprintf(name, sizeof(name), "bench_table_%d.bin", i);
+        destroyPageFile(name);
+    }
+}
+
+/* ------------------------------------------------------------
+ * Flush: forceFlushPool of a pool full of dirty pages vs. page-at-a-time
+ * ------------------------------------------------------------ */
+
+#define BENCH_POOL_FRAMES 4096
+
+/* Fills a pool with the given pages, in that order, and dirties them all */
+static void dirtyPool(BM_BufferPool *bm, const int pages[]) {
+    BM_PageHandle h;
+    for (int i = 0; i < BENCH_POOL_FRAMES; i++) {
+        BENCH_CHECK(pinPage(bm, &h, pages[i]));
+        h.data[1] ^= 1;
+        BENCH_CHECK(markDirty(bm, &h));
+        BENCH_CHECK(unpinPage(bm, &h));
+    }
+}
+
+/* Times one flush of BENCH_POOL_FRAMES dirty pages, sorted or in frame order */
+static void runFlush(const int pages[], const char *label) {
+    BM_BufferPool *bm = MAKE_POOL();
+    SM_FileHandle fh;
+    char *page = (char *) calloc(PAGE_SIZE, sizeof(char));
+
+    /* Page at a time in frame order: what the flush did before it sorted */
+    BENCH_CHECK(initBufferPool(bm, BENCH_FILE, BENCH_POOL_FRAMES, RS_FIFO, NULL));
+    dirtyPool(bm, pages);
+    BENCH_CHECK(openPageFile(BENCH_FILE, &fh));
+    PageNumber *frames = getFrameContents(bm);
+    double start = nowSeconds();
+    for (int i = 0; i < BENCH_POOL_FRAMES; i++)
+        BENCH_CHECK(writeBlock(frames[i], &fh, page));
+    BENCH_CHECK(flushBlocks(0, fh.totalNumPages, &fh));
+    double unsorted = nowSeconds() - start;
+    free(frames);
+    BENCH_CHECK(closePageFile(&fh));
+
+    start = nowSeconds();
+    BENCH_CHECK(forceFlushPool(bm));
+    double sorted = nowSeconds() - start;
+    int saved = getNumWriteIOSaved(bm);
+    BENCH_CHECK(shutdownBufferPool(bm));
+    free(page);
+
+    double mb = (double) BENCH_POOL_FRAMES * PAGE_SIZE / (1024.0 * 1024.0);
+    printf("  %-13s frame order %7.1f MB/s (%d writes)   sorted %7.1f MB/s (%d writes, %d saved)\n",
+           label, mb / unsorted, BENCH_POOL_FRAMES, mb / sorted, BENCH_POOL_FRAMES - saved, saved);
+}
+
+/* Fills pages[0..count) with a random permutation of 0..range-1's first count entries */
+static void shufflePages(int pages[], int count, int range, unsigned int *seed) {
+    int *all = (int *) malloc((size_t) range * sizeof(int));
+    for (int i = 0; i < range; i++)
+        all[i] = i;
+    for (int i = range - 1; i > 0; i--) {
+        int j = (int) (nextRandom(seed) % (unsigned int) (i + 1));
+        int t = all[i];
+        all[i] = all[j];
+        all[j] = t;
+    }
+    memcpy(pages, all, (size_t) count * sizeof(int));
+    free(all);
+}
+
+static void benchFlush(void) {
+    int sparse[BENCH_POOL_FRAMES], dense[BENCH_POOL_FRAMES];
+    unsigned int seed = 88172645u;
+
+    printf("flush of %d dirty pages with fdatasync, pinned in random order\n"
+           "(sparse: spread over %d pages; dense: pages 0..%d)\n",
+           BENCH_POOL_FRAMES, BENCH_NUM_PAGES, BENCH_POOL_FRAMES - 1);
+    shufflePages(sparse, BENCH_POOL_FRAMES, BENCH_NUM_PAGES, &seed);
+    shufflePages(dense, BENCH_POOL_FRAMES, BENCH_POOL_FRAMES, &seed);
+    buildPageFile(BENCH_NUM_PAGES);
+    setStorageDurability(SM_DURABILITY_SYNC_ON_FORCE, 0);
+
+    runFlush(sparse, "sparse");
+    runFlush(dense, "dense");
+    /* Direct I/O: every write reaches the device */
+    setStorageIOMode(SM_IO_DIRECT);
+    runFlush(sparse, "sparse/direct");
+    runFlush(dense, "dense/direct");
+    setStorageIOMode(SM_IO_POSITIONAL);
+
+    setStorageDurability(SM_DURABILITY_NONE, SM_DEFAULT_GROUP_INTERVAL_US);
+    destroyPageFile(BENCH_FILE);
+}
+
+/* ------------------------------------------------------------
+ * Pin: cost of a pinPage hit as the pool grows
+ * ------------------------------------------------------------ */
+
+#define BENCH_PINS       1000000    /* pin/unpin pairs per pool size */
+#define BENCH_SCAN_WORK  50000000   /* frames a linear-scan run may visit */
+
+/* Fills a pool of numFrames frames with pages 0..numFrames-1, then returns
+ * the nanoseconds per pin/unpin pair of random pages below numPages */
+static double timePins(int numFrames, ReplacementStrategy strategy, int numPages) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h;
+    unsigned int seed = 2463534242u;
+
+    BENCH_CHECK(initBufferPool(bm, BENCH_FILE, numFrames, strategy, NULL));
+    for (int p = 0; p < numFrames; p++) {
+        BENCH_CHECK(pinPage(bm, &h, p));
+        BENCH_CHECK(unpinPage(bm, &h));
+    }
+
+    double start = nowSeconds();
+    for (int i = 0; i < BENCH_PINS; i++) {
+        BENCH_CHECK(pinPage(bm, &h, (int) (nextRandom(&seed) % (unsigned int) numPages)));
+        BENCH_CHECK(unpinPage(bm, &h));
+    }
+    double elapsed = nowSeconds() - start;
+    BENCH_CHECK(shutdownBufferPool(bm));
+    return elapsed / BENCH_PINS * 1e9;
+}
+
+/* Nanoseconds per lookup of a random page by scanning numFrames frame
+ * contents: what every pinPage, unpinPage and markDirty did before the page table */
+static double timeScan(int numFrames) {
+    unsigned int seed = 2463534242u;
+    PageNumber *frames = (PageNumber *) malloc((size_t) numFrames * sizeof(PageNumber));
+    for (int f = 0; f < numFrames; f++)
+        frames[f] = f;
+    int scans = BENCH_SCAN_WORK / numFrames;
+    if (scans > BENCH_PINS)
+        scans = BENCH_PINS;
+    long found = 0;
+    double start = nowSeconds();
+    for (int i = 0; i < scans; i++) {
+        PageNumber pageNum = (PageNumber) (nextRandom(&seed) % (unsigned int) numFrames);
+        for (int f = 0; f < numFrames; f++) {
+            if (frames[f] == pageNum) {
+                found++;
+                break;
+            }
+        }
+    }
+    double elapsed = nowSeconds() - start;
+    free(frames);
+    if (found != scans)
+        fprintf(stderr, "scan missed %ld pages\n", (long) scans - found);
+    return elapsed / scans * 1e9;
+}
+
+#define BENCH_PIN_SIZES 6
+
+/* Pin hits and pins of which half miss for every strategy, and for
+ * reference one linear scan, on pools of 10 to 1M frames */
+static void benchPin(void) {
+    const char *names[] = { "fifo", "lru", "clock", "lfu", "lru-k", "arc", "2q" };
+    ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+    double hit[7][BENCH_PIN_SIZES], miss[7][BENCH_PIN_SIZES], scan[BENCH_PIN_SIZES];
+
+    printf("ns per pin/unpin pair on a full pool over an in-memory file (%d random pins;\n"
+           "miss: pages drawn from twice as many as the pool holds)\n", BENCH_PINS);
+    setStorageIOMode(SM_IO_MEMORY);
+    int numFrames = 10;
+    for (int n = 0; n < BENCH_PIN_SIZES; n++, numFrames *= 10) {
+        SM_FileHandle fh;
+        BENCH_CHECK(createPageFile(BENCH_FILE));
+        BENCH_CHECK(openPageFile(BENCH_FILE, &fh));
+        BENCH_CHECK(ensureCapacity(2 * numFrames, &fh));
+        BENCH_CHECK(closePageFile(&fh));
+        for (int s = 0; s < 7; s++) {
+            hit[s][n] = timePins(numFrames, strategies[s], numFrames);
+            miss[s][n] = timePins(numFrames, strategies[s], 2 * numFrames);
+        }
+        BENCH_CHECK(destroyPageFile(BENCH_FILE));
+        scan[n] = timeScan(numFrames);
+    }
+    setStorageIOMode(SM_IO_POSITIONAL);
+
+    printf("  %-12s", "frames");
+    for (int n = 0, f = 10; n < BENCH_PIN_SIZES; n++, f *= 10)
+        printf(" %9d", f);
+    printf("\n");
+    for (int s = 0; s < 7; s++) {
+        printf("  %-6s hit  ", names[s]);
+        for (int n = 0; n < BENCH_PIN_SIZES; n++)
+            printf(" %9.1f", hit[s][n]);
+        printf("\n  %-6s miss ", names[s]);
+        for (int n = 0; n < BENCH_PIN_SIZES; n++)
+            printf(" %9.1f", miss[s][n]);
+        printf("\n");
+    }
+    printf("  %-12s", "linear scan");
+    for (int n = 0; n < BENCH_PIN_SIZES; n++)
+        printf(" %9.1f", scan[n]);
+    printf("\n");
+}
+
+/* ------------------------------------------------------------
+ * Replay: hit ratio of each replacement strategy on page traces
+ * ------------------------------------------------------------ */
+
+#define BENCH_REPLAY_FRAMES  1000
+#define BENCH_REPLAY_LOOKUPS 300000
+
+/* Builds a trace of lookups over hotPages pages, skewed towards low page
+ * numbers when skewed is set, with a sequential scan of scanPages further
+ * pages after every scanEvery lookups; returns its length. With a fanout,
+ * the hot pages are a B+-tree of that fanout (page 0 the root, then the
+ * inner nodes, then the leaves) and each lookup reads a leaf through the
+ * root and its inner node. */
+static int buildTrace(int *trace, int hotPages, int skewed, int fanout,
+                      int scanPages, int scanEvery) {
+    unsigned int seed = 362436069u;
+    int numInner = fanout > 0 ? (hotPages - 1) / (fanout + 1) : 0;
+    int numLeaves = fanout > 0 ? hotPages - 1 - numInner : hotPages;
+    int n = 0;
+    for (int i = 0; i < BENCH_REPLAY_LOOKUPS; i++) {
+        double u = (nextRandom(&seed) % 1000000u) / 1000000.0;
+        int leaf = (int) (numLeaves * (skewed ? u * u * u : u));
+        if (fanout > 0) {
+            int inner = leaf / fanout < numInner ? leaf / fanout : numInner - 1;
+            trace[n++] = 0;
+            trace[n++] = 1 + inner;
+            trace[n++] = 1 + numInner + leaf;
+        } else {
+            trace[n++] = leaf;
+        }
+        if (scanPages > 0 && (i + 1) % scanEvery == 0) {
+            for (int p = 0; p < scanPages; p++)
+                trace[n++] = hotPages + p;
+        }
+    }
+    return n;
+}
+
+/* Replays a trace through a pool; returns the fraction of pins that hit,
+ * and in lookupHits the fraction of pins below hotPages (not scans) that hit */
+static double replayTrace(const int *trace, int length, int hotPages,
+                          ReplacementStrategy strategy, double *lookupHits) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h;
+    int lookups = 0, lookupMisses = 0;
+    BENCH_CHECK(initBufferPool(bm, BENCH_FILE, BENCH_REPLAY_FRAMES, strategy, NULL));
+    for (int i = 0; i < length; i++) {
+        int reads = getNumReadIO(bm);
+        BENCH_CHECK(pinPage(bm, &h, trace[i]));
+        BENCH_CHECK(unpinPage(bm, &h));
+        if (trace[i] < hotPages) {
+            lookups++;
+            lookupMisses += getNumReadIO(bm) - reads;
+        }
+    }
+    double hits = 1.0 - (double) getNumReadIO(bm) / length;
+    *lookupHits = 1.0 - (double) lookupMisses / lookups;
+    BENCH_CHECK(shutdownBufferPool(bm));
+    return hits;
+}
+
+static void benchReplay(void) {
+    const char *names[] = { "fifo", "lru", "clock", "lfu", "lru-k", "arc", "2q" };
+    ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+    struct {
+        const char *label;
+        int hotPages, skewed, fanout, scanPages, scanEvery;
+    } traces[] = {
+        { "skewed",      10000, 1,   0,    0,     0 },
+        { "skewed+scan", 10000, 1,   0, 5000, 20000 },
+        { "hot+scan",      800, 0,   0, 3000,  5000 },
+        { "btree+scan",   4041, 1, 100, 5000, 20000 },
+    };
+    int numTraces = (int) (sizeof(traces) / sizeof(traces[0]));
+    int *trace = (int *) malloc((size_t) 4 * BENCH_REPLAY_LOOKUPS * sizeof(int));
+
+    printf("hit ratio of a %d-frame pool replaying %d lookups, over all pins / lookups only\n"
+           "(skewed: over 10000 pages, most to the lowest; hot: uniform over 800 pages;\n"
+           " btree: skewed over the 4000 leaves of a B+-tree of fanout 100, read from the root;\n"
+           " +scan: a full scan of a 5000- or 3000-page table every 20000 or 5000 lookups)\n",
+           BENCH_REPLAY_FRAMES, BENCH_REPLAY_LOOKUPS);
+    printf("  %-12s", "");
+    for (int s = 0; s < 7; s++)
+        printf(" %13s", names[s]);
+    printf("\n");
+
+    setStorageIOMode(SM_IO_MEMORY);
+    for (int t = 0; t < numTraces; t++) {
+        int length = buildTrace(trace, traces[t].hotPages, traces[t].skewed, traces[t].fanout,
+                                traces[t].scanPages, traces[t].scanEvery);
+        SM_FileHandle fh;
+        BENCH_CHECK(createPageFile(BENCH_FILE));
+        BENCH_CHECK(openPageFile(BENCH_FILE, &fh));
+        BENCH_CHECK(ensureCapacity(traces[t].hotPages + traces[t].scanPages, &fh));
+        BENCH_CHECK(closePageFile(&fh));
+        printf("  %-12s", traces[t].label);
+        for (int s = 0; s < 7; s++) {
+            double lookupHits;
+            double hits = replayTrace(trace, length, traces[t].hotPages, strategies[s], &lookupHits);
+            printf("   %4.1f / %4.1f", 100.0 * hits, 100.0 * lookupHits);
+        }
+        printf("\n");
+        BENCH_CHECK(destroyPageFile(BENCH_FILE));
+    }
+    setStorageIOMode(SM_IO_POSITIONAL);
+    free(trace);
+}
+
+/* ------------------------------------------------------------
+ * Insert: record inserts per second loading a table
+ * ------------------------------------------------------------ */
+
+#define BENCH_INSERT_TABLE "bench_insert.tbl"
+/* The page directory of a table lives in one page, which describes at most
+ * about 290 data pages: this many rows stays within it */
+#define BENCH_INSERT_ROWS  25000
+
+/* Loads BENCH_INSERT_ROWS rows of (int, int, char(5)) through the record
+ * manager into a new table; the time includes closing the table, which
+ * writes back whatever the pool still holds. setAttr writes an int as five
+ * bytes, so the string comes last and the ints are set in column order. */
+static void runInsert(const char *label) {
+    char **names = (char **) malloc(3 * sizeof(char *));
+    DataType *types = (DataType *) malloc(3 * sizeof(DataType));
+    int *lengths = (int *) malloc(3 * sizeof(int));
+    int *keys = (int *) malloc(sizeof(int));
+    const char *attrs[] = { "a", "b", "c" };
+    for (int i = 0; i < 3; i++) {
+        names[i] = strdup(attrs[i]);
+        types[i] = (i == 2) ? DT_STRING : DT_INT;
+        lengths[i] = (i == 2) ? 5 : 0;
+    }
+    keys[0] = 0;
+    Schema *schema = createSchema(3, names, types, lengths, 1, keys);
+    RM_TableData table;
+    Record *record;
+
+    destroyPageFile(BENCH_INSERT_TABLE);
+    BENCH_CHECK(initRecordManager(NULL));
+    BENCH_CHECK(createTable(BENCH_INSERT_TABLE, schema));
+    BENCH_CHECK(openTable(&table, BENCH_INSERT_TABLE));
+    /* openTable does not parse the stored schema yet; the table takes over
+     * the one it was created with, and closeTable frees it */
+    free(table.schema);
+    table.schema = schema;
+    BENCH_CHECK(createRecord(&record, table.schema));
+
+    double start = nowSeconds();
+    for (int i = 0; i < BENCH_INSERT_ROWS; i++) {
+        Value *value;
+        char text[5];
+        MAKE_INT_VALUE(value, i % 1000);
+        BENCH_CHECK(setAttr(record, table.schema, 0, value));
+        freeVal(value);
+        MAKE_INT_VALUE(value, (i / 1000) % 1000);
+        BENCH_CHECK(setAttr(record, table.schema, 1, value));
+        freeVal(value);
+        snprintf(text, sizeof(text), "r%03d", i % 1000);
+        MAKE_STRING_VALUE(value, text);
+        BENCH_CHECK(setAttr(record, table.schema, 2, value));
+        freeVal(value);
+        BENCH_CHECK(insertRecord(&table, record));
+    }
+    int rows = getNumTuples(&table);
+    BENCH_CHECK(closeTable(&table));
+    double elapsed = nowSeconds() - start;
+
+    freeRecord(record);
+    BENCH_CHECK(shutdownRecordManager());
+    destroyPageFile(BENCH_INSERT_TABLE);
+    printf("  %-14s %d rows in %.2f s, %.0f inserts/s\n",
+           label, rows, elapsed, rows / elapsed);
+}
+
+static void benchInsert(void) {
+    printf("inserts through the record manager into a new table\n");
+    runInsert("no sync");
+    /* every force reaches the device */
+    setStorageDurability(SM_DURABILITY_SYNC_ON_FORCE, 0);
+    runInsert("sync on force");
+    setStorageDurability(SM_DURABILITY_NONE, SM_DEFAULT_GROUP_INTERVAL_US);
+}
+
+/* ------------------------------------------------------------
+ * Cleaner: pin miss latency with and without the page cleaner
+ * ------------------------------------------------------------ */
+
+#define BENCH_CLEANER_FRAMES 1024
+#define BENCH_CLEANER_PINS   50000
+
+static int compareDoubles(const void *a, const void *b) {
+    double da = *(const double *) a, db = *(const double *) b;
+    return (da > db) - (da < db);
+}
+
+/* Pins random pages of BENCH_FILE and dirties every one, timing each miss;
+ * highWatermark 0 runs without a cleaner */
+static void runCleaner(const char *label, int highWatermark, int lowWatermark) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h;
+    unsigned int seed = 88172645u;
+    double *misses = (double *) malloc(BENCH_CLEANER_PINS * sizeof(double));
+    int numMisses = 0;
+
+    BENCH_CHECK(initBufferPool(bm, BENCH_FILE, BENCH_CLEANER_FRAMES, RS_LRU, NULL));
+    if (highWatermark > 0)
+        BENCH_CHECK(startPageCleaner(bm, highWatermark, lowWatermark));
+
+    double start = nowSeconds();
+    for (int i = 0; i < BENCH_CLEANER_PINS; i++) {
+        int reads = getNumReadIO(bm);
+        double pinStart = nowSeconds();
+        BENCH_CHECK(pinPage(bm, &h, (int) (nextRandom(&seed) % BENCH_NUM_PAGES)));
+        double pinTime = nowSeconds() - pinStart;
+        if (getNumReadIO(bm) != reads)
+            misses[numMisses++] = pinTime;
+        h.data[1] ^= 1;
+        BENCH_CHECK(markDirty(bm, &h));
+        BENCH_CHECK(unpinPage(bm, &h));
+    }
+    double elapsed = nowSeconds() - start;
+    int stallsAvoided = getNumStallsAvoided(bm);
+    BENCH_CHECK(shutdownBufferPool(bm));
+
+    qsort(misses, numMisses, sizeof(double), compareDoubles);
+    double total = 0;
+    for (int i = 0; i < numMisses; i++)
+        total += misses[i];
+    printf("  %-16s %8.0f pins/s   miss mean %6.1f us  p99 %7.1f us  max %8.1f us   %d of %d victims already clean\n",
+           label, BENCH_CLEANER_PINS / elapsed, total / numMisses * 1e6,
+           misses[numMisses * 99 / 100] * 1e6, misses[numMisses - 1] * 1e6,
+           stallsAvoided, numMisses - BENCH_CLEANER_FRAMES);
+    free(misses);
+}
+
+static void benchCleaner(void) {
+    printf("random pins that dirty every page, %d-frame LRU pool over %d pages, direct I/O\n",
+           BENCH_CLEANER_FRAMES, BENCH_NUM_PAGES);
+    buildPageFile(BENCH_NUM_PAGES);
+    setStorageIOMode(SM_IO_DIRECT);
+    runCleaner("no cleaner", 0, 0);
+    runCleaner("cleaner 50%/25%", BENCH_CLEANER_FRAMES / 2, BENCH_CLEANER_FRAMES / 4);
+    runCleaner("cleaner 10%/5%", BENCH_CLEANER_FRAMES / 10, BENCH_CLEANER_FRAMES / 20);
+    setStorageIOMode(SM_IO_POSITIONAL);
+    destroyPageFile(BENCH_FILE);
+}
+
+/* ------------------------------------------------------------
+ * Threads: pin throughput of one shared pool, 1..8 threads
+ * ------------------------------------------------------------ */
+
+#define BENCH_THREAD_HOT_PAGES 512  /* pages of the hit-only workload; all fit */
+
+typedef struct PinWorker {
+    BM_BufferPool *bm;
+    int numPins;
+    int numPages;
+    unsigned int seed;
+} PinWorker;
+
+/* Pins random pages and checks each one's stamp under its shared latch */
+static void *pinWorker(void *arg) {
+    PinWorker *w = (PinWorker *) arg;
+    BM_PageHandle h;
+    for (int i = 0; i < w->numPins; i++) {
+        int pageNum = (int) (nextRandom(&w->seed) % (unsigned int) w->numPages);
+        BENCH_CHECK(pinPage(w->bm, &h, pageNum));
+        BENCH_CHECK(latchPage(w->bm, &h, BM_LATCH_SHARED));
+        int stamp;
+        memcpy(&stamp, h.data, sizeof(int));
+        BENCH_CHECK(unlatchPage(w->bm, &h));
+        if (stamp != pageNum) {
+            printf("page %d returned content of page %d\n", pageNum, stamp);
+            exit(1);
+        }
+        BENCH_CHECK(unpinPage(w->bm, &h));
+    }
+    return NULL;
+}
+
+static void runThreads(const char *label, int numFrames, int numPages, int numPins, int numThreads) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h;
+    pthread_t threads[8];
+    PinWorker workers[8];
+
+    BENCH_CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_LRU, NULL));
+    /* the hit-only workload starts with every page it touches cached */
+    for (int p = 0; p < numPages && p < numFrames; p++) {
+        BENCH_CHECK(pinPage(bm, &h, p));
+        BENCH_CHECK(unpinPage(bm, &h));
+    }
+    int reads = getNumReadIO(bm);
+
+    double start = nowSeconds();
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].bm = bm;
+        workers[t].numPins = numPins / numThreads;
+        workers[t].numPages = numPages;
+        workers[t].seed = 2463534242u + (unsigned int) t * 7919u;
+        pthread_create(&threads[t], NULL, pinWorker, &workers[t]);
+    }
+    for (int t = 0; t < numThreads; t++)
+        pthread_join(threads[t], NULL);
+    double elapsed = nowSeconds() - start;
+    reads = getNumReadIO(bm) - reads;
+    BENCH_CHECK(shutdownBufferPool(bm));
+
+    printf("  %-7s threads=%d  %9.0f pins/s  %5.1f%% misses\n", label, numThreads,
+           numPins / elapsed, 100.0 * reads / numPins);
+}
+
+static void benchThreads(void) {
+    int threadCounts[] = { 1, 2, 4, 8 };
+    printf("random pins of one shared LRU pool, direct I/O\n");
+    buildPageFile(BENCH_NUM_PAGES);
+    setStorageIOMode(SM_IO_DIRECT);
+    /* hits only cost the pool latch; misses read outside it, so they overlap */
+    for (int i = 0; i < 4; i++)
+        runThreads("hits", 1024, BENCH_THREAD_HOT_PAGES, 800000, threadCounts[i]);
+    for (int i = 0; i < 4; i++)
+        runThreads("misses", 256, BENCH_NUM_PAGES, 40000, threadCounts[i]);
+    setStorageIOMode(SM_IO_POSITIONAL);
+    destroyPageFile(BENCH_FILE);
+}
+
+/* ------------------------------------------------------------
+ * Driver
+ * ------------------------------------------------------------ */
+
+typedef struct Benchmark {
+    const char *name;
+    void (*run)(void);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    { "randread", benchRandomRead },
+    { "seqscan",  benchVectoredScan },
+    { "qdepth",   benchQueueDepth },
+    { "append",   benchAppend },
+    { "compress", benchCompression },
+    { "commit",   benchCommit },
+    { "advise",   benchAdvise },
+    { "reopen",   benchReopen },
+    { "flush",    benchFlush },
+    { "pin",      benchPin },
+    { "replay",   benchReplay },
+    { "insert",   benchInsert },
+    { "cleaner",  benchCleaner },
+    { "threads",  benchThreads },
+};
+
+int main(int argc, char **argv) {
+    int numBenchmarks = (int) (sizeof(benchmarks) / sizeof(benchmarks[0]));
+    for (int i = 0; i < numBenchmarks; i++) {
+        int selected = (argc < 2);
+        for (int a = 1; a < argc; a++) {
+            if (strcmp(argv[a], benchmarks[i].name) == 0)
+                selected = 1;
+        }
+        if (selected)
+            benchmarks[i].run();
+    }
+    return 0;
+}
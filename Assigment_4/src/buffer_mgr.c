@@ -10,12 +10,326 @@
 #include <stdlib.h>
 #include <string.h>
 #include "buffer_mgr.h"
+#include "buffer_mgr_policy.h"
 #include "storage_mgr.h"
+#include "storage_mgr_async.h"
+
+// number of read-ahead or flush runs a pool keeps in flight at once
+#define POOL_ASYNC_DEPTH 32
+
+// number of pages a pool flush copies and writes per release of the latch
+#define FLUSH_BATCH 256
+
+// a read-ahead request together with the frames it fills
+typedef struct PrefetchRun {
+    SM_AsyncRequest request;  // must stay first: completions hand back this pointer
+    PageCache *pageCache;     // the pool whose frames are filled
+    Frame **frames;           // frames[i] receives page request.pageNum + i
+} PrefetchRun;
+
+// qsort order for page numbers: ascending
+static int comparePageNumbers(const void* a, const void* b)
+{
+    PageNumber pa = *(const PageNumber*) a;
+    PageNumber pb = *(const PageNumber*) b;
+    return (pa > pb) - (pa < pb);
+}
+
+// size of the pool's file; a miss may grow it while the latch is released,
+// so the count is loaded atomically
+static PageNumber filePages(SM_FileHandle *fHandle)
+{
+    return __atomic_load_n(&fHandle->totalNumPages, __ATOMIC_ACQUIRE);
+}
+
+// slot of the page table where the search for pageNum starts
+static int pageSlot(const PageCache* pageCache, const PageNumber pageNum)
+{
+    unsigned int h = (unsigned int) pageNum * 0x9E3779B1u;
+    return (int) ((h ^ (h >> 16)) & (unsigned int) pageCache->tableMask);
+}
+
+// enter frame into the page table under the page it now holds
+static void mapFrame(PageCache* pageCache, Frame* frame)
+{
+    int slot = pageSlot(pageCache, frame->pageNum);
+    while(pageCache->pageTable[slot] != -1) {
+        slot = (slot + 1) & pageCache->tableMask;
+    }
+    pageCache->pageTable[slot] = frame->index;
+}
+
+// take frame out of the page table before its page number changes.
+// Later entries of the probe run move back into the gap, so the table
+// never needs tombstones and lookups stay short as pages come and go.
+static void unmapFrame(PageCache* pageCache, Frame* frame)
+{
+    if(frame->pageNum == NO_PAGE) {
+        return;
+    }
+    int* table = pageCache->pageTable;
+    int mask = pageCache->tableMask;
+    int slot = pageSlot(pageCache, frame->pageNum);
+    while(table[slot] != frame->index) {
+        if(table[slot] == -1) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    int next = slot;
+    while(true) {
+        next = (next + 1) & mask;
+        if(table[next] == -1) {
+            break;
+        }
+        // an entry may fill the gap only if the gap is not before its home slot
+        int home = pageSlot(pageCache, pageCache->arr[table[next]]->pageNum);
+        if(((next - home) & mask) >= ((next - slot) & mask)) {
+            table[slot] = table[next];
+            slot = next;
+        }
+    }
+    table[slot] = -1;
+}
+
+// take frame off the list of unpinned frames; it is being pinned
+static void unlinkFrame(PageCache* pageCache, Frame* frame)
+{
+    if(frame->lruPrev != NULL) {
+        frame->lruPrev->lruNext = frame->lruNext;
+    } else {
+        pageCache->lruHead = frame->lruNext;
+    }
+    if(frame->lruNext != NULL) {
+        frame->lruNext->lruPrev = frame->lruPrev;
+    } else {
+        pageCache->lruTail = frame->lruPrev;
+    }
+    frame->lruPrev = NULL;
+    frame->lruNext = NULL;
+}
+
+// put a frame that just became unpinned on the list: a frame holding a page
+// is the most recently used one, an empty frame is the first to be reused
+static void linkFrame(PageCache* pageCache, Frame* frame)
+{
+    if(frame->pageNum == NO_PAGE) {
+        frame->lruPrev = NULL;
+        frame->lruNext = pageCache->lruHead;
+        if(pageCache->lruHead != NULL) {
+            pageCache->lruHead->lruPrev = frame;
+        } else {
+            pageCache->lruTail = frame;
+        }
+        pageCache->lruHead = frame;
+    } else {
+        frame->lruNext = NULL;
+        frame->lruPrev = pageCache->lruTail;
+        if(pageCache->lruTail != NULL) {
+            pageCache->lruTail->lruNext = frame;
+        } else {
+            pageCache->lruHead = frame;
+        }
+        pageCache->lruTail = frame;
+    }
+}
+
+// record an access to the page in a pinned frame and tell the policy;
+// loaded means the page was just read into the frame
+static void touchFrame(PageCache* pageCache, Frame* frame, bool loaded)
+{
+    const BM_ReplacementPolicy* policy = pageCache->policy;
+    pageCache->accessClock++;
+    if(loaded) {
+        if(policy->on_load != NULL) {
+            policy->on_load(pageCache, frame);
+        }
+    } else if(policy->on_hit != NULL) {
+        policy->on_hit(pageCache, frame);
+    }
+}
+
+// tell the policy that the page of frame leaves the pool
+static void evictFrame(PageCache* pageCache, Frame* frame)
+{
+    if(pageCache->policy->on_evict != NULL) {
+        pageCache->policy->on_evict(pageCache, frame);
+    }
+}
+
+// pin a frame once more; an unpinned frame leaves the list
+static void fixFrame(PageCache* pageCache, Frame* frame)
+{
+    if(frame->fixCount == 0) {
+        unlinkFrame(pageCache, frame);
+    }
+    frame->fixCount++;
+}
+
+// drop one pin; the last one puts the frame back on the list
+static void releaseFrame(PageCache* pageCache, Frame* frame)
+{
+    // never let a fix count go negative
+    if(frame->fixCount <= 0) {
+        return;
+    }
+    frame->fixCount--;
+    if(frame->fixCount == 0) {
+        linkFrame(pageCache, frame);
+        if(frame->pageNum != NO_PAGE && pageCache->policy->on_unpin != NULL) {
+            pageCache->policy->on_unpin(pageCache, frame);
+        }
+    }
+}
+
+// a pinned frame failed to read its page: it must not claim the page
+static void forgetPage(PageCache* pageCache, Frame* frame)
+{
+    unmapFrame(pageCache, frame);
+    evictFrame(pageCache, frame);
+    frame->pageNum = NO_PAGE;
+}
+
+// empty an unpinned frame whose page leaves the pool; it moves to the head
+// of the list, to be reused first
+static void dropPage(PageCache* pageCache, Frame* frame)
+{
+    unmapFrame(pageCache, frame);
+    evictFrame(pageCache, frame);
+    unlinkFrame(pageCache, frame);
+    resetFrameNode(frame);
+    linkFrame(pageCache, frame);
+}
+
+// the frame a new page goes to: an empty frame if there is one, otherwise
+// the unpinned page the pool's policy replaces first; NULL if every frame is pinned
+static Frame* selectVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    // empty frames head the list, so an empty head means there is one
+    Frame* head = pageCache->lruHead;
+    if(head == NULL || head->pageNum == NO_PAGE) {
+        return head;
+    }
+    return pageCache->policy->pick_victim(pageCache, pageNum);
+}
+
+// get the pool's asynchronous queue, creating it the first time it is needed
+static SM_AsyncQueue* getPoolQueue(PageCache* pageCache)
+{
+    if(pageCache->aio == NULL && !pageCache->aioUnavailable) {
+        if(createAsyncQueue(pageCache->fHandle, POOL_ASYNC_DEPTH, SM_ASYNC_AUTO,
+                            &pageCache->aio) != RC_OK) {
+            pageCache->aio = NULL;
+            pageCache->aioUnavailable = true;
+        }
+    }
+    return pageCache->aio;
+}
+
+// a read-ahead finished: hand its frames back to the replacement strategy
+static void finishPrefetch(SM_AsyncRequest* request)
+{
+    PrefetchRun* run = (PrefetchRun*) request;
+    for(int i = 0; i < request->numPages; i++) {
+        Frame* frame = run->frames[i];
+        frame->ioPending = false;
+        if(request->result != RC_OK) {
+            // never leave a frame claiming a page it failed to read
+            forgetPage(run->pageCache, frame);
+        }
+        releaseFrame(run->pageCache, frame);
+    }
+    free(run);
+}
+
+// collect finished read-aheads. With waitAll, block until none is in flight.
+static void completePrefetches(PageCache* pageCache, bool waitAll)
+{
+    if(pageCache->aio == NULL) {
+        return;
+    }
+    SM_AsyncRequest* done[16];
+    int numDone;
+    do {
+        if(waitAsync(pageCache->aio, done, waitAll ? 1 : 0, 16, &numDone) != RC_OK) {
+            return;
+        }
+        for(int i = 0; i < numDone; i++) {
+            finishPrefetch(done[i]);
+        }
+    } while(numDone > 0);
+}
+
+// block until the read-ahead filling this frame has finished
+static void waitForFrame(PageCache* pageCache, Frame* frame)
+{
+    SM_AsyncRequest* done[16];
+    int numDone = 1;
+    while(frame->ioPending && numDone > 0) {
+        if(waitAsync(pageCache->aio, done, 1, 16, &numDone) != RC_OK) {
+            return;
+        }
+        for(int i = 0; i < numDone; i++) {
+            finishPrefetch(done[i]);
+        }
+    }
+}
+
+// true while pageNum is being written without the pool latch, by an eviction,
+// forcePage or the page cleaner
+static bool pageWriteInFlight(PageCache* pageCache, PageNumber pageNum)
+{
+    for(int i = 0; i < pageCache->numWriting; i++) {
+        if(pageCache->writing[i] == pageNum) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// register a write of pageNum that is about to run without the pool latch
+RC beginPageWrite(PageCache* pageCache, PageNumber pageNum)
+{
+    if(pageCache->numWriting == pageCache->writingCap) {
+        int cap = pageCache->writingCap > 0 ? 2 * pageCache->writingCap : 16;
+        PageNumber* writing = (PageNumber*) realloc(pageCache->writing, (size_t) cap * sizeof(PageNumber));
+        if(writing == NULL) {
+            return RC_MALLOC_FAILED;
+        }
+        pageCache->writing = writing;
+        pageCache->writingCap = cap;
+    }
+    pageCache->writing[pageCache->numWriting++] = pageNum;
+    return RC_OK;
+}
+
+// the write of pageNum registered by beginPageWrite has finished
+void endPageWrite(PageCache* pageCache, PageNumber pageNum)
+{
+    for(int i = 0; i < pageCache->numWriting; i++) {
+        if(pageCache->writing[i] == pageNum) {
+            pageCache->writing[i] = pageCache->writing[--pageCache->numWriting];
+            break;
+        }
+    }
+    pthread_cond_broadcast(&pageCache->ioDone);
+}
+
+// block until no write of pageNum is in flight, so the page is not read back
+// from the file, or written again, before its latest content lands
+static void waitForPageWrite(PageCache* pageCache, PageNumber pageNum)
+{
+    while(pageWriteInFlight(pageCache, pageNum)) {
+        pthread_cond_wait(&pageCache->ioDone, &pageCache->latch);
+    }
+}
 
 // initBufferPool creates a new buffer pool with numPages page frames using the page replacement strategy.
 // The pool is used to cache pages from the page file with name pageFileName.
 // -- Initially, all page frames should be empty.
 // -- The page file should already exist.
+// -- stratData is NULL or points to a BM_StrategyConfig (buffer_mgr_policy.h)
+//    tuning the strategy or naming a policy to use instead of it.
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                     const int numPages, ReplacementStrategy strategy,
 		            void *stratData)
@@ -35,9 +349,21 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
         return RC_ERROR;
     }
 
-    // check if the file specified by the filename exisits
-    FILE *fp = fopen(pageFileName, "r+");
-    if(fp == NULL) {
+    // the replacement strategy must be one the pool implements, unless the
+    // configuration brings its own policy
+    const BM_StrategyConfig defaults = { 0 };
+    const BM_StrategyConfig* config = stratData != NULL ? (const BM_StrategyConfig*) stratData : &defaults;
+    const BM_ReplacementPolicy* policy = config->policy != NULL ? config->policy : getReplacementPolicy(strategy);
+    if(policy == NULL || policy->pick_victim == NULL) {
+        return RC_ERROR;
+    }
+    if(config->k < 0 || config->arcTarget < 0 || config->arcTarget > numPages ||
+       config->a1inFrames < 0 || config->a1outPages < 0) {
+        return RC_ERROR;
+    }
+
+    // check if the file specified by the filename exisits, on disk or in memory
+    if(!pageFileExists((char *) pageFileName)) {
         return RC_FILE_NOT_FOUND;
     }
 
@@ -47,12 +373,23 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
     bm->strategy = strategy;
 
     // initialize page cache
-    PageCache* pageCache = createPageCache(bm, numPages);
+    PageCache* pageCache = NULL;
+    RC rc = createPageCache(bm, numPages, &pageCache);
+    if(rc != RC_OK) {
+        return rc;
+    }
 
-    bm->mgmtData = pageCache;
+    // the policy sets up its own state for the new pool
+    if(policy->init != NULL) {
+        rc = policy->init(pageCache, config);
+        if(rc != RC_OK) {
+            freePageCache(pageCache);
+            return rc;
+        }
+    }
+    pageCache->policy = policy;
 
-    fclose(fp);
-    fp = NULL;
+    bm->mgmtData = pageCache;
 
     return RC_OK;
 
@@ -78,6 +415,9 @@ RC shutdownBufferPool(BM_BufferPool *const bm)
         return RC_OK;
     }
 
+    // the page cleaner stops before the last flush
+    stopPageCleaner(bm);
+
     // force to flush all pages in buffer pool
     if(forceFlushPool(bm) != RC_OK) {
         return RC_ERROR;
@@ -96,6 +436,178 @@ RC shutdownBufferPool(BM_BufferPool *const bm)
 }
 
 
+// write back every dirty unpinned frame, sorted and coalesced, and force the
+// file. The pool latch is held on entry and on return, but not while pages are
+// written or the file is synced: each batch of pages is copied under the latch
+// and registered as written in flight, as the page cleaner does, so pins,
+// unpins and misses go on meanwhile. A mapped or in-memory pool writes its
+// pages in place and needs no copies.
+static RC flushDirtyFrames(PageCache* pageCache)
+{
+    // read-ahead still in flight must land before frames are inspected
+    completePrefetches(pageCache, true);
+
+    // get the disk page handle pointer
+    SM_FileHandle *fHandle = pageCache->fHandle;
+    int pageSize = fHandle->pageSize;
+    int batchCap = pageCache->capacity < FLUSH_BATCH ? pageCache->capacity : FLUSH_BATCH;
+    PageNumber *dirty = (PageNumber *) malloc(pageCache->capacity * sizeof(PageNumber));
+    PageNumber *pages = (PageNumber *) malloc(batchCap * sizeof(PageNumber));
+    SM_PageHandle *bufs = (SM_PageHandle *) malloc(batchCap * sizeof(SM_PageHandle));
+    SM_AsyncRequest *runs = (SM_AsyncRequest *) malloc(batchCap * sizeof(SM_AsyncRequest));
+    SM_AsyncRequest **done = (SM_AsyncRequest **) malloc(batchCap * sizeof(SM_AsyncRequest *));
+    char *copies = NULL;
+    if(!pageCache->zeroCopy &&
+       posix_memalign((void **) &copies, SM_IO_ALIGNMENT, (size_t) batchCap * pageSize) != 0) {
+        copies = NULL;
+    }
+    if(dirty == NULL || pages == NULL || bufs == NULL || runs == NULL || done == NULL ||
+       (!pageCache->zeroCopy && copies == NULL)) {
+        free(dirty);
+        free(pages);
+        free(bufs);
+        free(runs);
+        free(done);
+        free(copies);
+        return RC_MALLOC_FAILED;
+    }
+
+    // gather the dirty pages, skipping frames without a page file and pinned
+    // frames, and sort them by page number so the writes go out in file order
+    // whatever frames the pages landed in
+    int numDirty = 0;
+    for(int i = 0; i < pageCache->capacity; i++) {
+        Frame* frame = pageCache->arr[i];
+        if(frame->pageNum != NO_PAGE && frame->dirty == 1 && frame->fixCount == 0) {
+            dirty[numDirty++] = frame->pageNum;
+        }
+    }
+    qsort(dirty, numDirty, sizeof(PageNumber), comparePageNumbers);
+
+    // with direct I/O every write reaches the device, so several runs are
+    // written concurrently through a queue of the flush's own; the pool's
+    // queue is reaped by pins while the latch is released. Buffered writes
+    // only copy into the kernel's page cache and are cheapest issued in page
+    // order one after another, as are a single run or a flush without a queue.
+    SM_AsyncQueue *aio = NULL;
+    if(numDirty > 1 && getFileIOMode(fHandle) == SM_IO_DIRECT &&
+       createAsyncQueue(fHandle, POOL_ASYNC_DEPTH, SM_ASYNC_AUTO, &aio) != RC_OK) {
+        aio = NULL;
+    }
+
+    RC rc = RC_OK;
+    for(int first = 0; first < numDirty && rc == RC_OK; first += batchCap) {
+        int last = first + batchCap < numDirty ? first + batchCap : numDirty;
+
+        // copy the pages still dirty and unpinned. Each counts as clean from
+        // here on; a markDirty during the write dirties it again
+        int numPages = 0;
+        for(int i = first; i < last; i++) {
+            Frame* frame = searchPageFromCache(pageCache, dirty[i]);
+            if(frame == NULL || frame->dirty == 0 || frame->fixCount > 0 ||
+               pageWriteInFlight(pageCache, dirty[i])) {
+                continue;
+            }
+            if(beginPageWrite(pageCache, dirty[i]) != RC_OK) {
+                rc = RC_MALLOC_FAILED;
+                break;
+            }
+            pages[numPages] = dirty[i];
+            if(pageCache->zeroCopy) {
+                bufs[numPages] = frame->data;
+            } else {
+                bufs[numPages] = copies + (size_t) numPages * pageSize;
+                memcpy(bufs[numPages], frame->data, pageSize);
+            }
+            frame->dirty = 0;
+            pageCache->numDirty--;
+            numPages++;
+        }
+
+        // consecutive pages are merged into one vectored write
+        int numRuns = 0;
+        int i = 0;
+        while(i < numPages) {
+            int runLen = 1;
+            while(i + runLen < numPages && pages[i + runLen] == pages[i] + runLen) {
+                runLen++;
+            }
+            SM_AsyncRequest *run = &runs[numRuns++];
+            memset(run, 0, sizeof(SM_AsyncRequest));
+            run->op = SM_ASYNC_WRITE;
+            run->pageNum = pages[i];
+            run->numPages = runLen;
+            run->bufs = &bufs[i];
+            i += runLen;
+        }
+
+        pthread_mutex_unlock(&pageCache->latch);
+        int submitted = 0;
+        for(int k = 0; k < numRuns; k++) {
+            if(aio != NULL && numRuns > 1 && submitAsync(aio, &runs[k]) == RC_OK) {
+                submitted++;
+            } else {
+                runs[k].result = writeBlocks(runs[k].pageNum, runs[k].numPages, fHandle, runs[k].bufs);
+            }
+        }
+        int collected = 0;
+        while(collected < submitted) {
+            int numDone = 0;
+            if(waitAsync(aio, done, submitted - collected, submitted - collected, &numDone) != RC_OK || numDone == 0) {
+                break;
+            }
+            collected += numDone;
+        }
+        pthread_mutex_lock(&pageCache->latch);
+
+        if(collected != submitted) {
+            rc = RC_WRITE_FAILED;
+        }
+        for(int k = 0; k < numRuns; k++) {
+            bool written = (runs[k].result == RC_OK && collected == submitted);
+            if(written) {
+                pageCache->numWrite += runs[k].numPages;
+                pageCache->numWriteSaved += runs[k].numPages - 1;
+            } else {
+                rc = RC_WRITE_FAILED;
+            }
+            for(int j = 0; j < runs[k].numPages; j++) {
+                PageNumber pageNum = runs[k].pageNum + j;
+                // a page that may not have reached the file must be written again
+                Frame* frame = searchPageFromCache(pageCache, pageNum);
+                if(!written && frame != NULL && frame->dirty == 0) {
+                    frame->dirty = 1;
+                    pageCache->numDirty++;
+                }
+                endPageWrite(pageCache, pageNum);
+            }
+        }
+    }
+    if(aio != NULL) {
+        destroyAsyncQueue(aio);
+    }
+    free(dirty);
+    free(pages);
+    free(bufs);
+    free(runs);
+    free(done);
+    free(copies);
+    if(rc != RC_OK) {
+        return rc;
+    }
+
+    // one force covers every page written above, and pages edited in
+    // place through a memory mapping
+    pthread_mutex_unlock(&pageCache->latch);
+    rc = flushBlocks(0, filePages(fHandle), fHandle);
+    pthread_mutex_lock(&pageCache->latch);
+    if(rc != RC_OK) {
+        return RC_WRITE_FAILED;
+    }
+
+    return RC_OK;
+}
+
 // forceFlushPool is to cause all dirty pages from the buffer pool to be written to disk
 // -- check whether there are dirty pages as well as the pin counts is equal to 0
 RC forceFlushPool(BM_BufferPool *const bm)
@@ -112,36 +624,123 @@ RC forceFlushPool(BM_BufferPool *const bm)
     if(pageCache == NULL) {
         return RC_OK;
     }
-    // iterate to check all frames
-    int i;
-    for(i = 0; i < pageCache->capacity; i++) {
-        Frame* frame = pageCache->arr[i];
-        // this frame has no page file
-        if(frame->pageNum == NO_PAGE) {
-            continue;
-        }
-        // force all drity pages from the buffer pool to be written to disk
-        if (frame->dirty == 1 && frame->fixCount == 0) {
-            // get the disk page handle pointer
-            SM_FileHandle *fHandle = pageCache->fHandle;
 
-            // write this dirty page to the disk
-            if(writeBlock(frame->pageNum, fHandle, frame->data) != RC_OK) {
-                return RC_WRITE_FAILED;
-            }
-            pageCache->numWrite++;
+    // the force at the end must also cover the writes other threads and the
+    // page cleaner have in flight
+    pthread_mutex_lock(&pageCache->latch);
+    while(pageCache->numWriting > 0) {
+        pthread_cond_wait(&pageCache->ioDone, &pageCache->latch);
+    }
+    RC rc = flushDirtyFrames(pageCache);
+    pthread_mutex_unlock(&pageCache->latch);
+    return rc;
+}
 
-            // after flush all dirth pages in buffer pool
-            frame->dirty = 0;
+
+// Buffer Manager Interface Access Pages
+
+// load pageNum into the frame the replacement policy picks. The frame is
+// claimed under the pool latch and marked loading; the latch is then released
+// while the victim's dirty page is written back and the new page is read, so
+// misses on different pages overlap their I/O and pins of this page wait for
+// the one read. *retry asks the caller to look the page up again.
+static RC missPage(PageCache* pageCache, BM_PageHandle *const page, const PageNumber pageNum, bool* retry)
+{
+    SM_FileHandle *fHandle = pageCache->fHandle;
+    *retry = false;
+
+    Frame* frame = selectVictim(pageCache, pageNum);
+    if(frame == NULL) {
+        return RC_ERROR;
+    }
+    PageNumber oldPage = frame->pageNum;
+    bool writeBack = (oldPage != NO_PAGE && frame->dirty == 1);
+
+    // a victim dirtied again while an older copy of it is being written
+    // waits, so the older copy cannot land last
+    if(writeBack && pageWriteInFlight(pageCache, oldPage)) {
+        waitForPageWrite(pageCache, oldPage);
+        *retry = true;
+        return RC_OK;
+    }
+
+    // ensure the file page exists; the file only grows under the latch
+    if(ensureCapacity(pageNum + 1, fHandle) != RC_OK) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    if(writeBack && beginPageWrite(pageCache, oldPage) != RC_OK) {
+        return RC_MALLOC_FAILED;
+    }
+
+    // the victim's page leaves the pool; a dirty one is written back from
+    // the frame before the new page is read over it
+    if(oldPage != NO_PAGE) {
+        if(writeBack) {
+            pageCache->numDirty--;
+        } else if(frame->cleaned || frame->cleaning) {
+            // the page cleaner wrote the page, or still holds the copy it writes
+            pageCache->numStallsAvoided++;
         }
+        frame->cleaning = false;
+        dropPage(pageCache, frame);
+        pageCache->frameCnt = pageCache->frameCnt - 1;
     }
+    unlinkFrame(pageCache, frame);
+    frame->pageNum = pageNum;
+    frame->fixCount = 1;
+    frame->loading = true;
+    mapFrame(pageCache, frame);
+    touchFrame(pageCache, frame, true);
+    pageCache->frameCnt = pageCache->frameCnt + 1;
 
+    // the frame is pinned, so no other thread reuses it meanwhile. The write
+    // back is not synced, which is left to the next force or flush
+    pthread_mutex_unlock(&pageCache->latch);
+    RC writeRc = RC_OK;
+    RC rc = RC_OK;
+    if(writeBack) {
+        writeRc = writeBlock(oldPage, fHandle, frame->data);
+    }
+    if(writeRc == RC_OK) {
+        // copy the page from disk, or borrow the mapped page
+        rc = pageCache->zeroCopy ? getPagePointer(pageNum, fHandle, &frame->data)
+                                 : readBlock(pageNum, fHandle, frame->data);
+    }
+    pthread_mutex_lock(&pageCache->latch);
+
+    frame->loading = false;
+    pthread_cond_broadcast(&pageCache->ioDone);
+    if(writeRc != RC_OK) {
+        // the victim's page stays in the frame, still dirty
+        forgetPage(pageCache, frame);
+        frame->pageNum = oldPage;
+        frame->dirty = 1;
+        pageCache->numDirty++;
+        mapFrame(pageCache, frame);
+        touchFrame(pageCache, frame, true);
+        endPageWrite(pageCache, oldPage);
+        releaseFrame(pageCache, frame);
+        return RC_WRITE_FAILED;
+    }
+    if(writeBack) {
+        pageCache->numWrite++;
+        endPageWrite(pageCache, oldPage);
+    }
+    if(rc != RC_OK) {
+        // never leave a frame claiming a page it failed to read
+        forgetPage(pageCache, frame);
+        releaseFrame(pageCache, frame);
+        pageCache->frameCnt = pageCache->frameCnt - 1;
+        return RC_ERROR;
+    }
+    pageCache->numRead++;
+
+    // store page number info to page
+    page->pageNum = pageNum;
+    page->data = frame->data;
     return RC_OK;
 }
 
-
-// Buffer Manager Interface Access Pages
-
 // pinPage is to pin the page with page number pageNum.
 // pinning a page means that clients of the buffer mananger can request this page number.
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
@@ -160,29 +759,64 @@ RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
         return RC_ERROR;
     }
 
-    // check whether this pageNum hit the pageCache
-    Frame* frame = isHitPageCache(pageCache, pageNum);
+    pthread_mutex_lock(&pageCache->latch);
 
-    // if yes, hit page cache
-    if(frame != NULL) {
-        // printf("hit page cache===\n");
-        // printf("frame data = %s\n", frame->data);
-        page->pageNum = pageNum;
-        page->data = frame->data;
-        frame->fixCount++;
-        if(bm->strategy == RS_LRU) {
-            updateLRUOrder(pageCache, pageNum);
+    RC rc;
+    while(true) {
+        // check whether this pageNum hit the pageCache
+        Frame* frame = isHitPageCache(pageCache, pageNum);
+
+        // a page that is still being read ahead is usable once its read lands
+        if(frame != NULL && frame->ioPending) {
+            waitForFrame(pageCache, frame);
+            continue;
+        }
+
+        // if yes, hit page cache
+        if(frame != NULL) {
+            fixFrame(pageCache, frame);
+            touchFrame(pageCache, frame, false);
+
+            // another thread missed on the page first: wait for its read
+            // rather than reading the page a second time
+            while(frame->loading) {
+                pthread_cond_wait(&pageCache->ioDone, &pageCache->latch);
+            }
+            if(frame->pageNum != pageNum) {
+                // that load failed and gave the frame up: try again
+                releaseFrame(pageCache, frame);
+                continue;
+            }
+            page->pageNum = pageNum;
+            page->data = frame->data;
+            rc = RC_OK;
+            break;
+        }
+
+        // a copy of the page still being written is newer than the file
+        if(pageWriteInFlight(pageCache, pageNum)) {
+            waitForPageWrite(pageCache, pageNum);
+            continue;
+        }
+
+        // finished read-aheads give their frames back before a victim is chosen;
+        // if every unpinned frame is still being read ahead, wait for them
+        if(pageCache->aio != NULL) {
+            completePrefetches(pageCache, false);
+            if(pageCache->lruHead == NULL) {
+                completePrefetches(pageCache, true);
+            }
         }
-        return RC_OK;
-    }
 
-    // if no execute different pin page processes based on replacement strategy
-    if(bm->strategy == RS_FIFO) {
-        return addPageToPageCacheWithFIFO(bm, page, pageNum);
-    } else if(bm->strategy == RS_LRU) {
-        return addPageToPageCacheWithLRU(bm, page, pageNum);
+        // if no, load the page into the frame the replacement policy picks
+        bool retry;
+        rc = missPage(pageCache, page, pageNum, &retry);
+        if(!retry) {
+            break;
+        }
     }
-    return RC_OK;
+    pthread_mutex_unlock(&pageCache->latch);
+    return rc;
 }
 
 
@@ -201,16 +835,24 @@ RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
         return RC_OK;
     }
 
+    pthread_mutex_lock(&pageCache->latch);
+
     // search a frame from page cache
     Frame* frame = searchPageFromCache(pageCache, page->pageNum);
 
     // if this frame doesn't exist
     if(frame == NULL) {
+        pthread_mutex_unlock(&pageCache->latch);
         return RC_ERROR;
     }
 
-    frame->dirty = 1;
+    if(frame->dirty == 0) {
+        frame->dirty = 1;
+        pageCache->numDirty++;
+    }
+    frame->cleaned = false;
 
+    pthread_mutex_unlock(&pageCache->latch);
     return RC_OK;
 }
 
@@ -229,20 +871,26 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
         return RC_OK;
     }
 
+    pthread_mutex_lock(&pageCache->latch);
+
     // search a frame from page cache
     Frame* frame = searchPageFromCache(pageCache, page->pageNum);
 
     // if this frame doesn't exist
     if(frame == NULL) {
+        pthread_mutex_unlock(&pageCache->latch);
         return RC_ERROR;
     }
 
-    frame->fixCount--;
-
+    // a dirty page stays in its frame until it is evicted, forced or
+    // flushed with the pool, so repeated updates cost one write; once it
+    // is unpinned the page cleaner may write it back ahead of eviction
+    releaseFrame(pageCache, frame);
     if(frame->fixCount == 0 && frame->dirty == 1) {
-        // printf("hit force page");
-        forcePage(bm, page);
+        wakePageCleaner(pageCache);
     }
+
+    pthread_mutex_unlock(&pageCache->latch);
     return RC_OK;
 
 }
@@ -262,42 +910,173 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
         return RC_OK;
     }
 
-    // search a frame from page cache
-    Frame* frame = searchPageFromCache(pageCache, page->pageNum);
+    pthread_mutex_lock(&pageCache->latch);
+
+    // search a frame from page cache; an older copy of the page still being
+    // written must not land after this one
+    Frame* frame;
+    while(true) {
+        frame = searchPageFromCache(pageCache, page->pageNum);
+        if(frame == NULL || (!frame->loading && !pageWriteInFlight(pageCache, frame->pageNum))) {
+            break;
+        }
+        if(frame->loading) {
+            pthread_cond_wait(&pageCache->ioDone, &pageCache->latch);
+        } else {
+            waitForPageWrite(pageCache, frame->pageNum);
+        }
+    }
 
     // if this frame doesn't exist
     if(frame == NULL) {
+        pthread_mutex_unlock(&pageCache->latch);
         return RC_ERROR;
     }
 
     // get the disk page handle pointer
     SM_FileHandle* fHandle = pageCache->fHandle;
+    PageNumber pageNum = frame->pageNum;
+
+    // the page counts as clean from here on; a markDirty during the write
+    // dirties it again
+    bool wasDirty = (frame->dirty == 1);
+    if(wasDirty) {
+        frame->dirty = 0;
+        pageCache->numDirty--;
+    }
+
+    // write this page to the disk, and make the page durable as the file's
+    // durability mode asks (a mapped page was edited in place, so it only
+    // needs an msync). The write and the sync run without the pool latch, so
+    // other threads keep using the pool and concurrent forces can share one
+    // sync. A pinned page is kept pinned and written under its shared latch;
+    // an unpinned one is copied first, as the page cleaner does, since its
+    // frame may be given to another page meanwhile. The page is registered as
+    // written in flight either way, so it is not read back before it lands
+    if(beginPageWrite(pageCache, pageNum) != RC_OK) {
+        if(wasDirty) {
+            frame->dirty = 1;
+            pageCache->numDirty++;
+        }
+        pthread_mutex_unlock(&pageCache->latch);
+        return RC_MALLOC_FAILED;
+    }
+    bool pinned = (frame->fixCount > 0);
+    SM_PageHandle copy = NULL;
+    if(!pinned && !pageCache->zeroCopy) {
+        if(posix_memalign((void **) &copy, SM_IO_ALIGNMENT, fHandle->pageSize) != 0) {
+            if(wasDirty) {
+                frame->dirty = 1;
+                pageCache->numDirty++;
+            }
+            endPageWrite(pageCache, pageNum);
+            pthread_mutex_unlock(&pageCache->latch);
+            return RC_MALLOC_FAILED;
+        }
+        memcpy(copy, frame->data, fHandle->pageSize);
+    }
+    SM_PageHandle data = (copy != NULL) ? copy : frame->data;
+    if(pinned) {
+        fixFrame(pageCache, frame);
+    }
+    pthread_mutex_unlock(&pageCache->latch);
 
-    // printf("frame->data = %s\n", frame->data);
+    RC rc = RC_OK;
+    if(pinned) {
+        pthread_rwlock_rdlock(&frame->latch);
+    }
+    if(writeBlock(pageNum, fHandle, data) != RC_OK ||
+       flushBlocks(pageNum, 1, fHandle) != RC_OK) {
+        rc = RC_WRITE_FAILED;
+    }
+    if(pinned) {
+        pthread_rwlock_unlock(&frame->latch);
+    }
+    free(copy);
 
-    // write this dirty page to the disk
-    if(writeBlock(frame->pageNum, fHandle, frame->data) != RC_OK) {
-        return RC_WRITE_FAILED;
+    pthread_mutex_lock(&pageCache->latch);
+    if(pinned) {
+        releaseFrame(pageCache, frame);
     }
+    // an unpinned frame may hold another page by now
+    if(rc != RC_OK && wasDirty && frame->pageNum == pageNum && frame->dirty == 0) {
+        frame->dirty = 1;
+        pageCache->numDirty++;
+    }
+    endPageWrite(pageCache, pageNum);
 
-    return RC_OK;
+    pthread_mutex_unlock(&pageCache->latch);
+    return rc;
+}
+
+// latchPage takes the shared or the exclusive latch on the content of a page
+// the calling thread has pinned. Pins keep a page in the pool; latches order
+// the threads reading and changing it. forcePage takes the shared latch while
+// it writes a pinned page, so a thread must not force a page it holds the
+// exclusive latch on.
+RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, BM_LatchMode mode)
+{
+    if(bm == NULL || page == NULL || bm->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
+
+    // the caller's pin keeps the frame holding the page, so only the lookup
+    // needs the pool latch
+    pthread_mutex_lock(&pageCache->latch);
+    Frame* frame = searchPageFromCache(pageCache, page->pageNum);
+    bool pinned = (frame != NULL && frame->fixCount > 0);
+    pthread_mutex_unlock(&pageCache->latch);
+    if(!pinned) {
+        return RC_ERROR;
+    }
+
+    int err = (mode == BM_LATCH_EXCLUSIVE) ? pthread_rwlock_wrlock(&frame->latch)
+                                           : pthread_rwlock_rdlock(&frame->latch);
+    return err == 0 ? RC_OK : RC_ERROR;
+}
+
+// unlatchPage releases the latch latchPage took on a pinned page
+RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    if(bm == NULL || page == NULL || bm->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
+
+    pthread_mutex_lock(&pageCache->latch);
+    Frame* frame = searchPageFromCache(pageCache, page->pageNum);
+    bool pinned = (frame != NULL && frame->fixCount > 0);
+    pthread_mutex_unlock(&pageCache->latch);
+    if(!pinned) {
+        return RC_ERROR;
+    }
+
+    return pthread_rwlock_unlock(&frame->latch) == 0 ? RC_OK : RC_ERROR;
 }
 
 
-// initialize a new frame node in buffer pool
-Frame* createFrameNode()
+// initialize a new frame node in buffer pool.
+// data is this frame's page-size slice of the pool arena, or NULL when the
+// frame borrows page pointers from a memory-mapped file.
+Frame* createFrameNode(char *data)
 {
     // allocate memory for this frame
     Frame* frame = (Frame*)calloc(1, sizeof(Frame));
 
-    // allocate memory for storing the content of the page
-    char* data = (char *) calloc(PAGE_SIZE, sizeof(char));
-
     // initialize values for every attributes
     frame->pageNum = NO_PAGE;
     frame->fixCount = 0;
     frame->dirty = 0;
+    frame->ioPending = false;
+    frame->loading = false;
+    frame->cleaning = false;
+    frame->cleaned = false;
+    frame->meta.slot = -1;
+    frame->meta.prev = -1;
+    frame->meta.next = -1;
     frame->data = data;
+    pthread_rwlock_init(&frame->latch, NULL);
     return frame;
 }
 
@@ -307,54 +1086,116 @@ RC resetFrameNode(Frame* frame) {
     frame->pageNum = NO_PAGE;
     frame->fixCount = 0;
     frame->dirty = 0;
+    frame->ioPending = false;
+    frame->loading = false;
+    frame->cleaned = false;
     return RC_OK;
 }
 
-// create a map to record the utility of every frames, used for LRU
-int* createHash(int capacity )
-{
-    int* hash =(int*)malloc(capacity * sizeof(int));
-    for(int i = 0; i < capacity; i++) {
-        hash[i] = -1;
-    }
-    return hash;
-}
-
-// create a cache area for pages
-PageCache* createPageCache(BM_BufferPool *const bm, int numPages) {
+// create a cache area for pages over the pool's file; fails with the
+// storage manager's error if the file cannot be opened
+RC createPageCache(BM_BufferPool *const bm, int numPages, PageCache** result) {
     // allocate memory for this page cache
     PageCache* pageCache = (PageCache* ) malloc(sizeof(PageCache));
+    if(pageCache == NULL) {
+        return RC_MALLOC_FAILED;
+    }
 
     // initialize values for every attribute
-    pageCache->front = 0;
-    pageCache->rear = -1;
     pageCache->frameCnt = 0;
     pageCache->capacity = numPages;
     pageCache->numRead=0;
     pageCache->numWrite=0;
+    pageCache->numWriteSaved=0;
+    pageCache->numDirty = 0;
+    pageCache->numCleaned = 0;
+    pageCache->numStallsAvoided = 0;
+    pageCache->cleaner = NULL;
+    pageCache->writing = NULL;
+    pageCache->numWriting = 0;
+    pageCache->writingCap = 0;
+    pageCache->pending = NULL;
+    pageCache->numPending = 0;
+    pageCache->aio = NULL;
 
-    // store a page data
+    // store file handle data
+    SM_FileHandle* fHandle = (SM_FileHandle*)calloc(1, sizeof(SM_FileHandle));
+    if(fHandle == NULL) {
+        free(pageCache);
+        return RC_MALLOC_FAILED;
+    }
+
+    // a missing file, a bad header or no access leaves no pool behind
+    RC rc = openPageFile(bm->pageFile, fHandle);
+    if(rc != RC_OK) {
+        free(fHandle);
+        free(pageCache);
+        return rc;
+    }
+
+    pageCache->fHandle = fHandle;
+
+    // frames of a memory-mapped or in-memory file point straight at its pages
+    SM_IOMode ioMode = getFileIOMode(fHandle);
+    pageCache->zeroCopy = (ioMode == SM_IO_MMAP || ioMode == SM_IO_MEMORY);
+
+    // a zero-copy pool never reads pages, so it never needs an I/O queue
+    pageCache->aioUnavailable = pageCache->zeroCopy;
+
+    // one aligned arena backs every frame, so direct I/O can read straight into frames;
+    // frames are as large as the file's pages
+    pageCache->arena = NULL;
+    if(!pageCache->zeroCopy) {
+        size_t arenaSize = (size_t) numPages * fHandle->pageSize;
+        if(posix_memalign((void **) &pageCache->arena, SM_IO_ALIGNMENT, arenaSize) != 0) {
+            freeFileHandle(pageCache);
+            free(pageCache);
+            return RC_MALLOC_FAILED;
+        }
+        memset(pageCache->arena, 0, arenaSize);
+    }
+
+    // store a page data; every frame starts empty and unpinned
     pageCache->arr = (Frame**) malloc(numPages * sizeof(Frame*));
+    pageCache->lruHead = NULL;
+    pageCache->lruTail = NULL;
+    pageCache->policy = NULL;
+    pageCache->policyState = NULL;
+    pageCache->accessClock = 0;
     int i;
     for(i = 0; i < pageCache->capacity; ++i ) {
-        Frame* frame = createFrameNode();
+        char* data = pageCache->zeroCopy ? NULL : pageCache->arena + (size_t) i * fHandle->pageSize;
+        Frame* frame = createFrameNode(data);
+        frame->index = i;
         pageCache->arr[i] = frame;
     }
+    // empty frames go to the head of the list, so link them last to first
+    // and they are used in frame order
+    for(i = pageCache->capacity - 1; i >= 0; i--) {
+        linkFrame(pageCache, pageCache->arr[i]);
+    }
 
-    // store file handle data
-    SM_FileHandle* fHandle = (SM_FileHandle*)calloc(1, sizeof(SM_FileHandle));
-
-    openPageFile(bm->pageFile, fHandle);
+    // page table with at least twice as many slots as frames, so probe runs stay short
+    int slots = 16;
+    while(slots < 2 * numPages) {
+        slots *= 2;
+    }
+    pageCache->tableMask = slots - 1;
+    pageCache->pageTable = (int*) malloc((size_t) slots * sizeof(int));
+    if(pageCache->pageTable == NULL) {
+        freeFrame(pageCache);
+        freeFileHandle(pageCache);
+        free(pageCache);
+        return RC_MALLOC_FAILED;
+    }
+    // every slot starts empty (-1)
+    memset(pageCache->pageTable, 0xff, (size_t) slots * sizeof(int));
 
-    pageCache->fHandle = fHandle;
+    pthread_mutex_init(&pageCache->latch, NULL);
+    pthread_cond_init(&pageCache->ioDone, NULL);
 
-    // initialize hash map
-    if(bm->strategy == RS_LRU) {
-        pageCache->hash = createHash(numPages);
-    } else if(bm->strategy == RS_FIFO) {
-        pageCache->hash = NULL;
-    }
-    return pageCache;
+    *result = pageCache;
+    return RC_OK;
 }
 
 // release all resources assigned to frames
@@ -367,8 +1208,7 @@ void freeFrame(PageCache* pageCache) {
             if(frame == NULL) {
                 continue;
             }
-            // release the resources assigned to store the content of the page
-
+            pthread_rwlock_destroy(&frame->latch);
             free(frame);
 
             pageCache->arr[i] = NULL;
@@ -376,6 +1216,10 @@ void freeFrame(PageCache* pageCache) {
 
         free(pageCache->arr);
     }
+
+    // release the arena that stores the content of every page
+    free(pageCache->arena);
+    pageCache->arena = NULL;
 }
 
 // release the resources assigned to the storage file handle.
@@ -386,17 +1230,24 @@ void freeFileHandle(PageCache* pageCache) {
     }
 }
 
-// release map resources assigned to frames created by LRU strategy
-void freeHash(PageCache* pageCache) {
-    if(pageCache->hash) {
-        free(pageCache->hash);
-    }
-}
 void freePageCache(PageCache* pageCache) {
     if(pageCache != NULL) {
-        freeFileHandle(pageCache);
+        // outstanding read-ahead targets the frames, so it ends first
+        if(pageCache->aio != NULL) {
+            completePrefetches(pageCache, true);
+            destroyAsyncQueue(pageCache->aio);
+            pageCache->aio = NULL;
+        }
+        // frames may still point into the file mapping, so release them first
         freeFrame(pageCache);
-        freeHash(pageCache);
+        freeFileHandle(pageCache);
+        free(pageCache->pageTable);
+        if(pageCache->policy != NULL && pageCache->policy->shutdown != NULL) {
+            pageCache->policy->shutdown(pageCache);
+        }
+        pthread_mutex_destroy(&pageCache->latch);
+        pthread_cond_destroy(&pageCache->ioDone);
+        free(pageCache->writing);
         free(pageCache);
     }
 }
@@ -416,140 +1267,297 @@ int isEmpty(PageCache* pageCache)
 
 // check whether the required pageNum hits the cache
 Frame* isHitPageCache(PageCache* pageCache, const PageNumber pageNum) {
-    // iterate all frames stored in this page cache
-    for(int i = 0; i < pageCache->capacity; i++) {
-        Frame* frame = pageCache->arr[i];
+    if(pageNum < 0) {
+        return NULL;
+    }
+    // follow the probe run that starts at the page's home slot
+    int slot = pageSlot(pageCache, pageNum);
+    int index;
+    while((index = pageCache->pageTable[slot]) != -1) {
+        Frame* frame = pageCache->arr[index];
         if(frame->pageNum == pageNum) {
             return frame;
         }
+        slot = (slot + 1) & pageCache->tableMask;
     }
     // the page cache didn't contain the current page number data, return NULL
     return NULL;
 }
 
-RC updateLRUOrder(PageCache* pageCache, int pageNum)
+// bring pageNum into frame: copy it from disk, or borrow the mapped page
+static RC loadPageIntoFrame(PageCache* pageCache, Frame* frame, const PageNumber pageNum)
 {
-    (void)pageCache;
-    (void)pageNum;
-    int* hash = pageCache->hash;
-    // update hash
-    int index = -1;
-    int i;
-    for(i = 0; i < pageCache->capacity; i++) {
-        if(hash[i] == pageNum) {
-            index = i;
-            break;
-        }
+    SM_FileHandle *fHandle = pageCache->fHandle;
+
+    // ensure the file page exists
+    if(ensureCapacity(pageNum + 1, fHandle) != RC_OK) {
+        return RC_READ_NON_EXISTING_PAGE;
     }
-    if(index == -1) {
-        return RC_ERROR;
+
+    if(pageCache->zeroCopy) {
+        return getPagePointer(pageNum, fHandle, &frame->data);
     }
-    int updatePageNum = hash[index];
-    for(i = index; i < pageCache->capacity - 1; i++) {
-        hash[i] = hash[i + 1];
+
+    // prefetchPages collects the frames and reads them in batches afterwards
+    if(pageCache->pending != NULL) {
+        pageCache->pending[pageCache->numPending++] = frame;
+        return RC_OK;
     }
-    hash[pageCache->capacity - 1] = updatePageNum;
-    return RC_OK;
+
+    // copy the file content from disk to memory
+    return readBlock(pageNum, fHandle, frame->data);
 }
 
-// add a new frame to pageCache
-RC addPageToPageCacheWithFIFO(BM_BufferPool *const bm, BM_PageHandle *const page, int pageNum)
+// claim frames for the missing pages in [startPage, startPage + numPages)
+// and start reading them; the pool latch is held
+static RC readAhead(BM_BufferPool *const bm, const PageNumber startPage, const int numPages)
 {
-    (void)bm;
-    (void)page;
-    (void)pageNum;
-    // get current page cache
     PageCache* pageCache = bm->mgmtData;
+    SM_FileHandle *fHandle = pageCache->fHandle;
 
-    // The following process is to add this new page to page cache
-
-    // if current page cache is full
-    if (isFull(pageCache)) {
-        removePageWithFIFO(bm, page);
+    // prefetch never extends the file, and a mapped file needs no reads
+    PageNumber endPage = startPage + numPages;
+    PageNumber totalPages = filePages(fHandle);
+    if(endPage > totalPages) {
+        endPage = totalPages;
+    }
+    if(pageCache->zeroCopy || startPage >= endPage) {
+        return RC_OK;
     }
-    // get the frame to store this page content
-    pageCache->rear = (pageCache->rear + 1) % pageCache->capacity;
 
-    Frame* frame = pageCache->arr[pageCache->rear];
+    // frames whose earlier read-ahead already finished are free again
+    completePrefetches(pageCache, false);
 
-    // copy the file content from disk to memory
-    SM_FileHandle *fHandle = pageCache->fHandle;
+    // every claimed frame stays pinned until its read finishes, so only
+    // frames that are unpinned now can be used
+    int budget = 0;
+    for(int i = 0; i < pageCache->capacity; i++) {
+        if(pageCache->arr[i]->fixCount == 0) {
+            budget++;
+        }
+    }
 
-    if(ensureCapacity(pageNum + 1, fHandle) != RC_OK) {
-        return RC_READ_NON_EXISTING_PAGE;
+    Frame** pending = (Frame**) malloc(pageCache->capacity * sizeof(Frame*));
+    SM_PageHandle* bufs = (SM_PageHandle*) malloc(pageCache->capacity * sizeof(SM_PageHandle));
+    if(pending == NULL || bufs == NULL) {
+        free(pending);
+        free(bufs);
+        return RC_MALLOC_FAILED;
+    }
+    pageCache->pending = pending;
+    pageCache->numPending = 0;
+
+    RC rc = RC_OK;
+    BM_PageHandle handle;
+    for(PageNumber p = startPage; p < endPage && pageCache->numPending < budget; p++) {
+        // a page being written is newer than the file, so it is not read ahead;
+        // waiting would release the latch while claimed frames are unread
+        if(isHitPageCache(pageCache, p) != NULL || pageWriteInFlight(pageCache, p)) {
+            continue;
+        }
+        rc = addPageToPageCache(bm, &handle, p);
+        if(rc != RC_OK) {
+            break;
+        }
     }
+    pageCache->pending = NULL;
+
+    // pages were claimed in ascending order; read each consecutive run at once
+    SM_AsyncQueue* aio = (rc == RC_OK) ? getPoolQueue(pageCache) : NULL;
+    int numPending = pageCache->numPending;
+    int i = 0;
+    while(i < numPending) {
+        int runLen = 1;
+        bufs[0] = pending[i]->data;
+        while(i + runLen < numPending &&
+              pending[i + runLen]->pageNum == pending[i]->pageNum + runLen) {
+            bufs[runLen] = pending[i + runLen]->data;
+            runLen++;
+        }
 
-    if(readBlock(pageNum, fHandle, frame->data) != RC_OK) {
-        return RC_ERROR;
+        // hand the run to the queue; its frames stay pinned until it completes
+        PrefetchRun* run = NULL;
+        if(aio != NULL) {
+            run = (PrefetchRun*) malloc(sizeof(PrefetchRun) +
+                                        runLen * (sizeof(Frame*) + sizeof(SM_PageHandle)));
+        }
+        if(run != NULL) {
+            memset(&run->request, 0, sizeof(SM_AsyncRequest));
+            run->pageCache = pageCache;
+            run->frames = (Frame**) (run + 1);
+            run->request.op = SM_ASYNC_READ;
+            run->request.pageNum = pending[i]->pageNum;
+            run->request.numPages = runLen;
+            run->request.bufs = (SM_PageHandle*) (run->frames + runLen);
+            for(int k = 0; k < runLen; k++) {
+                run->frames[k] = pending[i + k];
+                run->request.bufs[k] = bufs[k];
+                pending[i + k]->ioPending = true;
+            }
+            if(submitAsync(aio, &run->request) == RC_OK) {
+                i += runLen;
+                continue;
+            }
+            for(int k = 0; k < runLen; k++) {
+                pending[i + k]->ioPending = false;
+            }
+            free(run);
+        }
+
+        // without a queue the run is read before returning
+        if(rc == RC_OK && readBlocks(pending[i]->pageNum, runLen, fHandle, bufs) != RC_OK) {
+            rc = RC_ERROR;
+        }
+        // release the pins taken while the read was outstanding
+        for(int k = 0; k < runLen; k++) {
+            if(rc != RC_OK) {
+                // never leave a frame claiming a page it failed to read
+                forgetPage(pageCache, pending[i + k]);
+            }
+            releaseFrame(pageCache, pending[i + k]);
+        }
+        i += runLen;
     }
 
-    pageCache->numRead++;
+    free(pending);
+    free(bufs);
+    return rc;
+}
 
-    // update this frame information page
-    frame->pageNum = pageNum;
-    frame->fixCount = 1;
-    frame->dirty = 0;
+// prefetchPages loads up to numPages pages starting at startPage that are not
+// cached yet, without pinning them. Pages are claimed through the pool's
+// replacement strategy, then each run of consecutive page numbers is
+// submitted as one asynchronous vectored read and the call returns at once.
+// A later pinPage of such a page waits only for the read that fills it.
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber startPage, const int numPages)
+{
+    if(bm == NULL || startPage < 0 || numPages < 0) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
+    if(pageCache == NULL) {
+        return RC_ERROR;
+    }
 
-    // store page number info to page
-    page->pageNum = pageNum;
-    page->data = frame->data;
+    pthread_mutex_lock(&pageCache->latch);
+    RC rc = readAhead(bm, startPage, numPages);
+    pthread_mutex_unlock(&pageCache->latch);
+    return rc;
+}
 
-    // store this page in the cache
-    // pageCache->arr[pageCache->rear] = frame;
-    pageCache->frameCnt = pageCache->frameCnt + 1;
+// adviseAccess passes an access-pattern hint for pages of the pool's file to
+// the storage manager. The range is clipped to the file, and numPages 0
+// means through the end of the file.
+RC adviseAccess(BM_BufferPool *const bm, const PageNumber startPage, const PageNumber numPages, SM_Advice advice)
+{
+    if(bm == NULL || startPage < 0 || numPages < 0) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
+    if(pageCache == NULL) {
+        return RC_ERROR;
+    }
+    SM_FileHandle *fHandle = pageCache->fHandle;
 
-    return RC_OK;
+    PageNumber totalPages = filePages(fHandle);
+    if(startPage >= totalPages) {
+        return RC_OK;
+    }
+    PageNumber count = numPages;
+    if(count > totalPages - startPage) {
+        count = totalPages - startPage;
+    }
+    return adviseBlocks(startPage, count, fHandle, advice);
 }
 
-// add new page to page cache based on LRU strategy
-RC addPageToPageCacheWithLRU(BM_BufferPool *const bm, BM_PageHandle *const page,
-		const PageNumber pageNum)
+// allocatePoolPage takes a page for new data from the free-page map of the
+// pool's file, or appends one, and returns its number. The page reads back as
+// zeros; a stale frame still holding it is emptied without being written.
+RC allocatePoolPage(BM_BufferPool *const bm, PageNumber *pageNum)
 {
-    (void)bm;
-    (void)page;
-    (void)pageNum;
-    // get current page cache
+    if(bm == NULL || bm->mgmtData == NULL || pageNum == NULL) {
+        return RC_ERROR;
+    }
     PageCache* pageCache = bm->mgmtData;
 
-    int* hash = pageCache->hash;
+    pthread_mutex_lock(&pageCache->latch);
+    RC rc = allocatePage(pageCache->fHandle, pageNum);
+    Frame* frame = (rc == RC_OK) ? searchPageFromCache(pageCache, *pageNum) : NULL;
+    if(frame != NULL && frame->dirty == 1) {
+        frame->dirty = 0;
+        pageCache->numDirty--;
+    }
+    if(frame != NULL && frame->fixCount == 0) {
+        dropPage(pageCache, frame);
+        pageCache->frameCnt = pageCache->frameCnt - 1;
+    } else if(frame != NULL && !pageCache->zeroCopy) {
+        memset(frame->data, 0, (size_t) pageCache->fHandle->pageSize);
+    }
+    pthread_mutex_unlock(&pageCache->latch);
+    return rc;
+}
 
-    int frameIndex = -1;
+// freePoolPage hands a page the caller no longer uses back to the free-page
+// map of the pool's file, for allocatePoolPage to reuse. Its frame is emptied
+// without writing the page back. Fails while the page is pinned.
+RC freePoolPage(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    if(bm == NULL || bm->mgmtData == NULL || pageNum < 0) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
 
-    Frame* frame = NULL;
-    // mark whether the current pageCache is full
-    int fullFlag = 0;
-    if(isFull(pageCache)) {
-        int leastUsedPageNum = hash[0];
-        frame = removePageWithLRU(bm, page, leastUsedPageNum);
-        fullFlag = 1;
-        // frame = pageCache->arr[leastUsedPageNum];
-    } else {
-        for(int i = 0; i < bm->numPages; i++) {
-            if(hash[i] == -1) {
-                frameIndex = i;
-                break;
-            }
+    pthread_mutex_lock(&pageCache->latch);
+    Frame* frame;
+    while(true) {
+        frame = searchPageFromCache(pageCache, pageNum);
+        if(frame != NULL && frame->ioPending) {
+            waitForFrame(pageCache, frame);
+            continue;
         }
-        if(frameIndex == -1) {
+        if(frame != NULL && (frame->fixCount > 0 || frame->loading)) {
+            pthread_mutex_unlock(&pageCache->latch);
             return RC_ERROR;
         }
-        frame = pageCache->arr[frameIndex];
+        // an older copy still being written must land before the page is freed
+        if(pageWriteInFlight(pageCache, pageNum)) {
+            waitForPageWrite(pageCache, pageNum);
+            continue;
+        }
+        break;
     }
 
-    if(frame == NULL) {
-        return RC_ERROR;
+    if(frame != NULL) {
+        if(frame->dirty == 1) {
+            frame->dirty = 0;
+            pageCache->numDirty--;
+        }
+        frame->cleaning = false;
+        dropPage(pageCache, frame);
+        pageCache->frameCnt = pageCache->frameCnt - 1;
     }
+    RC rc = freePage(pageCache->fHandle, pageNum);
+    pthread_mutex_unlock(&pageCache->latch);
+    return rc;
+}
 
-    // copy the page content
-    SM_FileHandle *fHandle = pageCache->fHandle;
+// add new page to page cache in the frame the pool's replacement policy picks
+RC addPageToPageCache(BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum)
+{
+    // get current page cache
+    PageCache* pageCache = bm->mgmtData;
 
-    // ensure the file page exists
-    if(ensureCapacity(pageNum + 1, fHandle) != RC_OK) {
-        return RC_READ_NON_EXISTING_PAGE;
+    Frame* frame = selectVictim(pageCache, pageNum);
+    if(frame == NULL) {
+        return RC_ERROR;
+    }
+    if(frame->pageNum != NO_PAGE && removePageFromCache(bm, frame) != RC_OK) {
+        return RC_ERROR;
     }
 
-    // copy the file content from disk to memory
-    if(readBlock(pageNum, fHandle, frame->data) != RC_OK) {
+    // copy the page content
+    if(loadPageIntoFrame(pageCache, frame, pageNum) != RC_OK) {
         return RC_ERROR;
     }
 
@@ -558,10 +1566,15 @@ RC addPageToPageCacheWithLRU(BM_BufferPool *const bm, BM_PageHandle *const page,
 
     pageCache->numRead++;
 
-    // update this frame information page
+    // update this frame information page; it leaves the unpinned list
+    if(frame->fixCount == 0) {
+        unlinkFrame(pageCache, frame);
+    }
     frame->pageNum = pageNum;
     frame->fixCount = 1;
     frame->dirty = 0;
+    mapFrame(pageCache, frame);
+    touchFrame(pageCache, frame, true);
 
     // store page number info to page
     page->pageNum = pageNum;
@@ -569,119 +1582,50 @@ RC addPageToPageCacheWithLRU(BM_BufferPool *const bm, BM_PageHandle *const page,
 
     pageCache->frameCnt = pageCache->frameCnt + 1;
 
-    // store this page in the cache
-    if(fullFlag == 1) {
-        // pageCache->arr[hash[0]] = frame;
-        for(int i = 0; i < pageCache->capacity - 1; i++) {
-            hash[i] = hash[i+1];
-        }
-        hash[pageCache->capacity - 1] = pageNum;
-    } else {
-        // pageCache->arr[frameIndex] = frame;
-        hash[frameIndex] = pageNum;
-    }
-
     return RC_OK;
 }
 
-// Remove a frame from queue based on FIFO. It changes front and frameCnt
-RC removePageWithFIFO(BM_BufferPool *const bm, BM_PageHandle *const page)
+// Remove the page of an unpinned frame chosen by selectVictim, writing it
+// back first if it is dirty. It changes frameCnt. The pool latch is held
+// throughout; pinPage evicts through missPage, which releases it for the I/O.
+RC removePageFromCache(BM_BufferPool *const bm, Frame* frame)
 {
-    (void)bm;
-    (void)page;
     PageCache* pageCache = bm->mgmtData;
-    // check whether this page cache is empty
-    if (isEmpty(pageCache))
-        return RC_ERROR;
 
-    // check whether there exisit frame with fixCount = 0
-    int cnt = 0;
-    Frame** arr = pageCache->arr;
-    for(int i = 0; i < pageCache->capacity; i++) {
-        if(arr[i]->fixCount == 0) {
-            cnt++;
-        }
-    }
-    if(cnt == 0) {
+    if(frame == NULL || frame->fixCount > 0 || frame->pageNum == NO_PAGE) {
         return RC_ERROR;
     }
 
-    // get the first frame in the page cache
-    Frame* frame = pageCache->arr[pageCache->front];
-
-    // fix test case :201
-    if(frame->fixCount > 0) {
-        while(pageCache->arr[pageCache->front]->fixCount > 0) {
-            pageCache->front = (pageCache->front + 1) % pageCache->capacity;
+    // write back the victim's own page, not the page being requested; it
+    // is not synced, which is left to the next force or flush. A page dirtied
+    // again while an older copy of it is written is not evicted, so the older
+    // copy cannot land last.
+    if(frame->dirty == 1) {
+        if(pageWriteInFlight(pageCache, frame->pageNum)) {
+            return RC_ERROR;
         }
-        frame = pageCache->arr[pageCache->front];
-
-        // set the tail to the current frame
-        pageCache->rear = pageCache->front - 1;
-    }
-    if(frame->fixCount == 0 && frame->dirty == 1) {
-        forcePage(bm, page);
-        pageCache->numWrite++;
-    }
-    // remove the first frame
-    pageCache->front = (pageCache->front + 1) % pageCache->capacity;
-
-    // update the number of used frame in page cache
-    pageCache->frameCnt = pageCache->frameCnt - 1;
-
-    // reset this frame node
-    resetFrameNode(frame);
-
-    return RC_OK;
-}
-
-Frame* removePageWithLRU(BM_BufferPool *const bm, BM_PageHandle *const page, int leastUsedPage)
-{
-    PageCache* pageCache = bm->mgmtData;
-    // check whether this page cache is empty
-    if (isEmpty(pageCache))
-        return NULL;
-
-    // check whether there exisit frame with fixCount = 0
-    int cnt = 0;
-    Frame** arr = pageCache->arr;
-    for(int i = 0; i < pageCache->capacity; i++) {
-        if(arr[i]->fixCount == 0) {
-            cnt++;
+        if(writeBlock(frame->pageNum, pageCache->fHandle, frame->data) != RC_OK) {
+            return RC_WRITE_FAILED;
         }
-    }
-    if(cnt == 0) {
-        return NULL;
-    }
-
-    // get the least page in the page cache
-    Frame* frame = searchPageFromCache(pageCache, leastUsedPage);
-
-    if(frame == NULL) {
-        return NULL;
-    }
-
-    if(frame->fixCount == 0 && frame->dirty == 1) {
-        forcePage(bm, page);
         pageCache->numWrite++;
+        frame->dirty = 0;
+        pageCache->numDirty--;
+    } else if(frame->cleaned || frame->cleaning) {
+        // the page cleaner wrote the page, or still holds the copy it writes
+        pageCache->numStallsAvoided++;
     }
+    frame->cleaning = false;
 
-    // remove the least page
-    resetFrameNode(frame);
+    // remove the page
+    dropPage(pageCache, frame);
 
     pageCache->frameCnt = pageCache->frameCnt - 1;
 
-    return frame;
+    return RC_OK;
 }
 
 // get the frame from the page cache
-Frame* searchPageFromCache(PageCache *const pageCache, int pageNum) {
+Frame* searchPageFromCache(PageCache *const pageCache, const PageNumber pageNum) {
     // get a frame based on page number
-    for(int i = 0; i < pageCache->capacity; i++) {
-        Frame* frame = pageCache->arr[i];
-        if(frame->pageNum == pageNum) {
-            return frame;
-        }
-    }
-    return NULL;
+    return isHitPageCache(pageCache, pageNum);
 }
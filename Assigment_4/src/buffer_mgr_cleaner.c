@@ -0,0 +1,235 @@
+/************************************************************
+ * File name:      buffer_mgr_cleaner.c
+ * CS 525 Advanced Database Organization (Spring 2025)
+ * Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ * Description:
+ *   This source file implements the buffer pool's optional
+ *   background page cleaner: a thread that writes cold dirty
+ *   pages back once too many frames are dirty, so that a miss
+ *   seldom has to write its victim before reading its page.
+ ************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+
+// most pages the cleaner copies and writes in one batch
+#define CLEANER_BATCH 64
+
+typedef struct PageCleaner {
+    pthread_t thread;
+    pthread_cond_t wake;      // signalled when dirty frames pass the high watermark, or to stop
+    int highWatermark;        // dirty frames above which the cleaner starts
+    int lowWatermark;         // dirty frames at which it stops again
+    bool stop;                // set by stopPageCleaner
+    char *copies;             // CLEANER_BATCH pages the batch is copied into
+    SM_PageHandle bufs[CLEANER_BATCH];
+    Frame *batch[CLEANER_BATCH];
+    PageNumber pages[CLEANER_BATCH]; // the page each batch frame held when it was copied
+} PageCleaner;
+
+// qsort order for frames: ascending page number
+static int compareBatchPages(const void* a, const void* b)
+{
+    PageNumber pa = (*(Frame* const*) a)->pageNum;
+    PageNumber pb = (*(Frame* const*) b)->pageNum;
+    return (pa > pb) - (pa < pb);
+}
+
+// write back one batch of the coldest dirty unpinned pages; returns how many
+// pages it cleaned. The pool latch is held, but not while the batch is written.
+static int cleanBatch(PageCache* pageCache, PageCleaner* cleaner)
+{
+    int want = pageCache->numDirty - cleaner->lowWatermark;
+    if(want > CLEANER_BATCH) {
+        want = CLEANER_BATCH;
+    }
+
+    // the unpinned list runs from the frame released longest ago, so the
+    // pages at its head are the ones least likely to be dirtied again soon
+    int numFrames = 0;
+    for(Frame* frame = pageCache->lruHead; frame != NULL && numFrames < want; frame = frame->lruNext) {
+        if(frame->dirty == 1 && !frame->cleaning) {
+            cleaner->batch[numFrames++] = frame;
+        }
+    }
+    if(numFrames == 0) {
+        return 0;
+    }
+
+    // copy the pages in file order so consecutive pages form one write. The
+    // frames stay usable: a page dirtied again is simply dirty again, and a
+    // frame may even be given to another page, as the copy is what is written.
+    // Each page is registered as written in flight, so it is not read back
+    // from the file before its copy lands
+    qsort(cleaner->batch, numFrames, sizeof(Frame*), compareBatchPages);
+    int pageSize = pageCache->fHandle->pageSize;
+    for(int i = 0; i < numFrames; i++) {
+        Frame* frame = cleaner->batch[i];
+        if(beginPageWrite(pageCache, frame->pageNum) != RC_OK) {
+            numFrames = i;
+            break;
+        }
+        cleaner->bufs[i] = cleaner->copies + (size_t) i * pageSize;
+        cleaner->pages[i] = frame->pageNum;
+        memcpy(cleaner->bufs[i], frame->data, pageSize);
+        frame->dirty = 0;
+        frame->cleaning = true;
+        pageCache->numDirty--;
+    }
+
+    // each run is released as soon as it is written, so whoever waits for
+    // one of its pages waits for that run only
+    bool failed = false;
+    int i = 0;
+    while(i < numFrames) {
+        int runLen = 1;
+        while(i + runLen < numFrames && cleaner->pages[i + runLen] == cleaner->pages[i] + runLen) {
+            runLen++;
+        }
+        pthread_mutex_unlock(&pageCache->latch);
+        RC rc = writeBlocks(cleaner->pages[i], runLen, pageCache->fHandle, &cleaner->bufs[i]);
+        pthread_mutex_lock(&pageCache->latch);
+
+        for(int j = i; j < i + runLen; j++) {
+            Frame* frame = cleaner->batch[j];
+            if(frame->cleaning && frame->pageNum == cleaner->pages[j]) {
+                frame->cleaning = false;
+                if(rc != RC_OK && frame->dirty == 0) {
+                    // the page may not have reached the file, so it must be written again
+                    frame->dirty = 1;
+                    pageCache->numDirty++;
+                }
+                frame->cleaned = (frame->dirty == 0);
+            } else if(rc != RC_OK) {
+                // the frame was reused, so the copy is the only one left
+                pthread_mutex_unlock(&pageCache->latch);
+                rc = writeBlock(cleaner->pages[j], pageCache->fHandle, cleaner->bufs[j]);
+                pthread_mutex_lock(&pageCache->latch);
+            }
+            endPageWrite(pageCache, cleaner->pages[j]);
+        }
+        if(rc == RC_OK) {
+            pageCache->numCleaned += runLen;
+            pageCache->numWrite += runLen;
+        } else {
+            failed = true;
+        }
+        i += runLen;
+    }
+    return failed ? 0 : numFrames;
+}
+
+static void* cleanerMain(void* arg)
+{
+    PageCache* pageCache = (PageCache*) arg;
+    PageCleaner* cleaner = pageCache->cleaner;
+
+    pthread_mutex_lock(&pageCache->latch);
+    while(!cleaner->stop) {
+        // once past the high watermark, clean down to the low one or until
+        // every dirty page left is pinned
+        if(pageCache->numDirty > cleaner->highWatermark) {
+            while(!cleaner->stop && pageCache->numDirty > cleaner->lowWatermark &&
+                  cleanBatch(pageCache, cleaner) > 0) {
+            }
+        }
+        if(!cleaner->stop) {
+            pthread_cond_wait(&cleaner->wake, &pageCache->latch);
+        }
+    }
+    pthread_mutex_unlock(&pageCache->latch);
+    return NULL;
+}
+
+// a dirty page was unpinned: start the cleaner if too many frames are dirty
+void wakePageCleaner(PageCache* pageCache)
+{
+    PageCleaner* cleaner = pageCache->cleaner;
+    if(cleaner != NULL && pageCache->numDirty > cleaner->highWatermark) {
+        pthread_cond_signal(&cleaner->wake);
+    }
+}
+
+// startPageCleaner starts a background thread that writes back the dirty
+// unpinned pages released longest ago whenever more than highWatermark frames
+// are dirty, until at most lowWatermark are. It runs until stopPageCleaner
+// or shutdownBufferPool. The frames of a pool over a mapped or in-memory file
+// are the file's own pages, so such a pool starts no thread.
+RC startPageCleaner(BM_BufferPool *const bm, int highWatermark, int lowWatermark)
+{
+    if(bm == NULL || bm->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
+    if(lowWatermark < 0 || lowWatermark >= highWatermark || highWatermark >= pageCache->capacity) {
+        return RC_ERROR;
+    }
+    if(pageCache->cleaner != NULL) {
+        return RC_ERROR;
+    }
+    if(pageCache->zeroCopy) {
+        return RC_OK;
+    }
+
+    PageCleaner* cleaner = (PageCleaner*) calloc(1, sizeof(PageCleaner));
+    if(cleaner == NULL) {
+        return RC_MALLOC_FAILED;
+    }
+    // batches are written from aligned copies, as direct I/O requires
+    if(posix_memalign((void**) &cleaner->copies, SM_IO_ALIGNMENT,
+                      (size_t) CLEANER_BATCH * pageCache->fHandle->pageSize) != 0) {
+        free(cleaner);
+        return RC_MALLOC_FAILED;
+    }
+    cleaner->highWatermark = highWatermark;
+    cleaner->lowWatermark = lowWatermark;
+    pthread_cond_init(&cleaner->wake, NULL);
+
+    pthread_mutex_lock(&pageCache->latch);
+    pageCache->cleaner = cleaner;
+    if(pthread_create(&cleaner->thread, NULL, cleanerMain, pageCache) != 0) {
+        pageCache->cleaner = NULL;
+        pthread_mutex_unlock(&pageCache->latch);
+        pthread_cond_destroy(&cleaner->wake);
+        free(cleaner->copies);
+        free(cleaner);
+        return RC_ERROR;
+    }
+    // pages dirtied before the start may already be past the watermark
+    wakePageCleaner(pageCache);
+    pthread_mutex_unlock(&pageCache->latch);
+    return RC_OK;
+}
+
+// stopPageCleaner stops the pool's page cleaner once its current batch has
+// been written. Pages it has not cleaned stay dirty in the pool.
+RC stopPageCleaner(BM_BufferPool *const bm)
+{
+    if(bm == NULL || bm->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    PageCache* pageCache = bm->mgmtData;
+
+    pthread_mutex_lock(&pageCache->latch);
+    PageCleaner* cleaner = pageCache->cleaner;
+    if(cleaner == NULL) {
+        pthread_mutex_unlock(&pageCache->latch);
+        return RC_OK;
+    }
+    cleaner->stop = true;
+    pthread_cond_signal(&cleaner->wake);
+    pthread_mutex_unlock(&pageCache->latch);
+
+    pthread_join(cleaner->thread, NULL);
+
+    pthread_mutex_lock(&pageCache->latch);
+    pageCache->cleaner = NULL;
+    pthread_mutex_unlock(&pageCache->latch);
+    pthread_cond_destroy(&cleaner->wake);
+    free(cleaner->copies);
+    free(cleaner);
+    return RC_OK;
+}
@@ -0,0 +1,724 @@
+/************************************************************
+ * File name:      buffer_mgr_policy.c
+ * CS 525 Advanced Database Organization (Spring 2025)
+ * Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ * Description:
+ *   This source file implements the buffer pool's built-in page
+ *   replacement policies (FIFO, LRU, CLOCK, LFU, LRU-K, ARC and
+ *   2Q) behind the interface defined in buffer_mgr_policy.h.
+ ************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_mgr_policy.h"
+
+// --- Frame lists ---
+
+// a doubly linked list of indexes; the links live with the entries
+typedef struct IndexList {
+    int head;   // least recent entry, -1 if empty
+    int tail;   // most recent entry, -1 if empty
+    int size;   // number of entries
+} IndexList;
+
+static void listInit(IndexList* list)
+{
+    list->head = -1;
+    list->tail = -1;
+    list->size = 0;
+}
+
+// append frame to list as its most recent entry, linked through its meta
+static void frameAppend(PageCache* pageCache, IndexList* list, Frame* frame)
+{
+    frame->meta.prev = list->tail;
+    frame->meta.next = -1;
+    if(list->tail >= 0) {
+        pageCache->arr[list->tail]->meta.next = frame->index;
+    } else {
+        list->head = frame->index;
+    }
+    list->tail = frame->index;
+    list->size++;
+}
+
+static void frameRemove(PageCache* pageCache, IndexList* list, Frame* frame)
+{
+    if(frame->meta.prev >= 0) {
+        pageCache->arr[frame->meta.prev]->meta.next = frame->meta.next;
+    } else {
+        list->head = frame->meta.next;
+    }
+    if(frame->meta.next >= 0) {
+        pageCache->arr[frame->meta.next]->meta.prev = frame->meta.prev;
+    } else {
+        list->tail = frame->meta.prev;
+    }
+    frame->meta.prev = -1;
+    frame->meta.next = -1;
+    list->size--;
+}
+
+// the least recent unpinned frame of list, or NULL
+static Frame* oldestUnpinned(PageCache* pageCache, const IndexList* list)
+{
+    for(int i = list->head; i >= 0; i = pageCache->arr[i]->meta.next) {
+        if(pageCache->arr[i]->fixCount == 0) {
+            return pageCache->arr[i];
+        }
+    }
+    return NULL;
+}
+
+// --- FIFO: pages leave in the order they were loaded ---
+// Every page is queued, pinned or not, and the oldest unpinned one goes.
+
+static RC fifoInit(PageCache* pageCache, const BM_StrategyConfig* config)
+{
+    (void) config;
+    IndexList* queue = (IndexList*) malloc(sizeof(IndexList));
+    if(queue == NULL) {
+        return RC_MALLOC_FAILED;
+    }
+    listInit(queue);
+    pageCache->policyState = queue;
+    return RC_OK;
+}
+
+static void freePolicyState(PageCache* pageCache)
+{
+    free(pageCache->policyState);
+    pageCache->policyState = NULL;
+}
+
+static void fifoLoad(PageCache* pageCache, Frame* frame)
+{
+    frameAppend(pageCache, (IndexList*) pageCache->policyState, frame);
+    frame->meta.list = 1;
+}
+
+static Frame* fifoVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    (void) pageNum;
+    return oldestUnpinned(pageCache, (IndexList*) pageCache->policyState);
+}
+
+static void fifoEvict(PageCache* pageCache, Frame* frame)
+{
+    if(frame->meta.list != 0) {
+        frameRemove(pageCache, (IndexList*) pageCache->policyState, frame);
+        frame->meta.list = 0;
+    }
+}
+
+// --- LRU: the page unpinned longest ago goes ---
+// The pool's list of unpinned frames is already in that order.
+
+static Frame* lruVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    (void) pageNum;
+    return pageCache->lruHead;
+}
+
+// --- CLOCK: a hand passes the frames, giving used pages a second chance ---
+
+typedef struct ClockState {
+    int hand;   // index of the next frame the hand inspects
+} ClockState;
+
+static RC clockInit(PageCache* pageCache, const BM_StrategyConfig* config)
+{
+    (void) config;
+    ClockState* clock = (ClockState*) calloc(1, sizeof(ClockState));
+    if(clock == NULL) {
+        return RC_MALLOC_FAILED;
+    }
+    pageCache->policyState = clock;
+    return RC_OK;
+}
+
+static void clockTouch(PageCache* pageCache, Frame* frame)
+{
+    (void) pageCache;
+    frame->meta.useBit = 1;
+}
+
+// the hand passes pinned frames and clears the use bits it finds set;
+// some frame is unpinned, so it stops within two turns
+static Frame* clockVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    (void) pageNum;
+    ClockState* clock = (ClockState*) pageCache->policyState;
+    while(true) {
+        Frame* frame = pageCache->arr[clock->hand];
+        clock->hand = (clock->hand + 1) % pageCache->capacity;
+        if(frame->fixCount > 0) {
+            continue;
+        }
+        if(frame->meta.useBit == 1) {
+            frame->meta.useBit = 0;
+            continue;
+        }
+        return frame;
+    }
+}
+
+// --- LFU and LRU-K: unpinned pages in a min-heap by rank ---
+// LFU ranks a page by its accesses since it was loaded, LRU-K by the K-th
+// latest of its access times (0 while it has fewer than K, so those pages
+// go first). Ties go to the page used least recently. The heap holds only
+// unpinned pages, so choosing a victim and removing it are O(log n).
+
+typedef struct HeapState {
+    Frame **heap;         // unpinned pages, next victim first
+    int size;             // number of frames in heap
+    int k;                // LRU-K: number of access times kept per page; 0 for LFU
+    long long *history;   // LRU-K: the latest k access times of every frame, as a ring
+} HeapState;
+
+// whether frame a is replaced before frame b
+static bool evictsBefore(const Frame* a, const Frame* b)
+{
+    if(a->meta.key != b->meta.key) {
+        return a->meta.key < b->meta.key;
+    }
+    return a->meta.lastAccess < b->meta.lastAccess;
+}
+
+// store frame at position i of the heap
+static void heapSet(HeapState* state, int i, Frame* frame)
+{
+    state->heap[i] = frame;
+    frame->meta.slot = i;
+}
+
+// move the frame at position i up until its parent goes first
+static void siftUp(HeapState* state, int i)
+{
+    Frame* frame = state->heap[i];
+    while(i > 0) {
+        int parent = (i - 1) / 2;
+        if(!evictsBefore(frame, state->heap[parent])) {
+            break;
+        }
+        heapSet(state, i, state->heap[parent]);
+        i = parent;
+    }
+    heapSet(state, i, frame);
+}
+
+// move the frame at position i down until both children go after it
+static void siftDown(HeapState* state, int i)
+{
+    Frame* frame = state->heap[i];
+    while(true) {
+        int child = 2 * i + 1;
+        if(child >= state->size) {
+            break;
+        }
+        if(child + 1 < state->size && evictsBefore(state->heap[child + 1], state->heap[child])) {
+            child++;
+        }
+        if(!evictsBefore(state->heap[child], frame)) {
+            break;
+        }
+        heapSet(state, i, state->heap[child]);
+        i = child;
+    }
+    heapSet(state, i, frame);
+}
+
+// take frame out of the heap, if it is in it
+static void heapRemove(HeapState* state, Frame* frame)
+{
+    int i = frame->meta.slot;
+    if(i < 0) {
+        return;
+    }
+    frame->meta.slot = -1;
+    Frame* last = state->heap[--state->size];
+    if(last != frame) {
+        heapSet(state, i, last);
+        siftUp(state, i);
+        siftDown(state, last->meta.slot);
+    }
+}
+
+static void freeHeapState(PageCache* pageCache)
+{
+    HeapState* state = (HeapState*) pageCache->policyState;
+    if(state != NULL) {
+        free(state->heap);
+        free(state->history);
+        free(state);
+    }
+    pageCache->policyState = NULL;
+}
+
+static RC heapInit(PageCache* pageCache, int k)
+{
+    HeapState* state = (HeapState*) calloc(1, sizeof(HeapState));
+    if(state == NULL) {
+        return RC_MALLOC_FAILED;
+    }
+    pageCache->policyState = state;
+    state->k = k;
+    state->heap = (Frame**) malloc(pageCache->capacity * sizeof(Frame*));
+    if(k > 0) {
+        state->history = (long long*) calloc((size_t) pageCache->capacity * k, sizeof(long long));
+    }
+    if(state->heap == NULL || (k > 0 && state->history == NULL)) {
+        freeHeapState(pageCache);
+        return RC_MALLOC_FAILED;
+    }
+    return RC_OK;
+}
+
+static RC lfuInit(PageCache* pageCache, const BM_StrategyConfig* config)
+{
+    (void) config;
+    return heapInit(pageCache, 0);
+}
+
+static RC lruKInit(PageCache* pageCache, const BM_StrategyConfig* config)
+{
+    return heapInit(pageCache, config->k > 0 ? config->k : 2);
+}
+
+// record an access to the page in frame and rank it again
+static void rankAccess(PageCache* pageCache, Frame* frame)
+{
+    HeapState* state = (HeapState*) pageCache->policyState;
+    frame->meta.count++;
+    frame->meta.lastAccess = pageCache->accessClock;
+    if(state->k == 0) {
+        frame->meta.key = frame->meta.count;
+        return;
+    }
+    // the slot written next holds the K-th latest access once there are K
+    long long* times = state->history + (size_t) frame->index * state->k;
+    times[(frame->meta.count - 1) % state->k] = pageCache->accessClock;
+    frame->meta.key = frame->meta.count >= state->k ? times[frame->meta.count % state->k] : 0;
+}
+
+static void heapHit(PageCache* pageCache, Frame* frame)
+{
+    heapRemove((HeapState*) pageCache->policyState, frame);
+    rankAccess(pageCache, frame);
+}
+
+static void heapLoad(PageCache* pageCache, Frame* frame)
+{
+    frame->meta.count = 0;
+    rankAccess(pageCache, frame);
+}
+
+static void heapUnpin(PageCache* pageCache, Frame* frame)
+{
+    HeapState* state = (HeapState*) pageCache->policyState;
+    heapSet(state, state->size++, frame);
+    siftUp(state, frame->meta.slot);
+}
+
+static Frame* heapVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    (void) pageNum;
+    return ((HeapState*) pageCache->policyState)->heap[0];
+}
+
+static void heapEvict(PageCache* pageCache, Frame* frame)
+{
+    heapRemove((HeapState*) pageCache->policyState, frame);
+}
+
+// --- ARC and 2Q: resident and ghost lists ---
+// Both strategies split the resident pages between two lists, T1 and T2,
+// and remember recently evicted pages in ghost lists that hold page
+// numbers only.
+// ARC: T1 holds pages used once since they were loaded, T2 pages used
+// again; B1 and B2 remember pages evicted from T1 and T2. A miss on a page
+// in B1 means T1 was too small and grows its target size, a miss in B2
+// shrinks it.
+// 2Q: T1 is the probation queue A1in, in load order, and B1 is A1out, the
+// pages pushed out of A1in. T2 is the main LRU list Am, which a page only
+// enters when it is used again after it left A1in; pages leaving Am are
+// not remembered.
+// T2, and T1 under ARC, link only unpinned frames, least recently released
+// first; 2Q's T1 keeps pinned frames in place so it stays in load order.
+// The list sizes count pinned pages too.
+
+#define LIST_NONE 0
+#define LIST_T1   1
+#define LIST_T2   2
+#define LIST_B1   3
+#define LIST_B2   4
+
+typedef struct ListState {
+    bool twoQueue;        // follow 2Q's rules rather than ARC's
+    int target;           // ARC: preferred number of pages in T1 (p in the ARC paper)
+    int t1Max;            // 2Q: pages A1in holds before it gives one up (Kin)
+    int b1Max;            // 2Q: pages A1out remembers (Kout)
+    int t1Size;           // pages in T1, pinned ones included
+    int t2Size;           // pages in T2, pinned ones included
+    IndexList t1;         // frames of T1, linked through Frame.meta
+    IndexList t2;         // unpinned frames of T2, linked through Frame.meta
+    IndexList b1;         // ghosts of pages evicted from T1
+    IndexList b2;         // ghosts of pages evicted from T2
+    PageNumber *ghostPage; // page number of every ghost
+    int *ghostPrev;       // list links of ghosts
+    int *ghostNext;
+    char *ghostList;      // LIST_B1 or LIST_B2 for every ghost in use
+    int freeGhost;        // first unused ghost, chained through ghostNext
+    int *ghostTable;      // open-addressing table of ghosts keyed by page number
+    int ghostMask;        // number of ghostTable slots minus one
+    bool discard;         // the next eviction leaves no ghost behind
+} ListState;
+
+// append ghost g as the most recent entry of list
+static void ghostAppend(ListState* lists, IndexList* list, int g)
+{
+    lists->ghostPrev[g] = list->tail;
+    lists->ghostNext[g] = -1;
+    if(list->tail >= 0) {
+        lists->ghostNext[list->tail] = g;
+    } else {
+        list->head = g;
+    }
+    list->tail = g;
+    list->size++;
+}
+
+static void ghostUnlink(ListState* lists, IndexList* list, int g)
+{
+    if(lists->ghostPrev[g] >= 0) {
+        lists->ghostNext[lists->ghostPrev[g]] = lists->ghostNext[g];
+    } else {
+        list->head = lists->ghostNext[g];
+    }
+    if(lists->ghostNext[g] >= 0) {
+        lists->ghostPrev[lists->ghostNext[g]] = lists->ghostPrev[g];
+    } else {
+        list->tail = lists->ghostPrev[g];
+    }
+    list->size--;
+}
+
+static void freeListState(PageCache* pageCache)
+{
+    ListState* lists = (ListState*) pageCache->policyState;
+    if(lists != NULL) {
+        free(lists->ghostPage);
+        free(lists->ghostPrev);
+        free(lists->ghostNext);
+        free(lists->ghostList);
+        free(lists->ghostTable);
+        free(lists);
+    }
+    pageCache->policyState = NULL;
+}
+
+// list state for the pool under ARC or 2Q, with numGhosts ghost nodes
+static RC listInitState(PageCache* pageCache, bool twoQueue, int numGhosts)
+{
+    ListState* lists = (ListState*) calloc(1, sizeof(ListState));
+    if(lists == NULL) {
+        return RC_MALLOC_FAILED;
+    }
+    pageCache->policyState = lists;
+    int slots = 16;
+    while(slots < 2 * numGhosts) {
+        slots *= 2;
+    }
+    lists->ghostPage = (PageNumber*) malloc(numGhosts * sizeof(PageNumber));
+    lists->ghostPrev = (int*) malloc(numGhosts * sizeof(int));
+    lists->ghostNext = (int*) malloc(numGhosts * sizeof(int));
+    lists->ghostList = (char*) calloc(numGhosts, sizeof(char));
+    lists->ghostTable = (int*) malloc((size_t) slots * sizeof(int));
+    if(lists->ghostPage == NULL || lists->ghostPrev == NULL || lists->ghostNext == NULL ||
+       lists->ghostList == NULL || lists->ghostTable == NULL) {
+        freeListState(pageCache);
+        return RC_MALLOC_FAILED;
+    }
+    lists->twoQueue = twoQueue;
+    listInit(&lists->t1);
+    listInit(&lists->t2);
+    listInit(&lists->b1);
+    listInit(&lists->b2);
+    for(int i = 0; i < numGhosts; i++) {
+        lists->ghostNext[i] = i + 1 < numGhosts ? i + 1 : -1;
+    }
+    lists->freeGhost = 0;
+    lists->ghostMask = slots - 1;
+    memset(lists->ghostTable, 0xff, (size_t) slots * sizeof(int));
+    return RC_OK;
+}
+
+// ARC's ghost lists hold up to a pool's worth of pages between them, and
+// get twice that many nodes for slack
+static RC arcInit(PageCache* pageCache, const BM_StrategyConfig* config)
+{
+    RC rc = listInitState(pageCache, false, 2 * pageCache->capacity);
+    if(rc == RC_OK) {
+        ((ListState*) pageCache->policyState)->target = config->arcTarget;
+    }
+    return rc;
+}
+
+// by default A1in holds a quarter of the pool and A1out remembers half a
+// pool of pages, the sizes the 2Q paper recommends
+static RC twoQueueInit(PageCache* pageCache, const BM_StrategyConfig* config)
+{
+    int c = pageCache->capacity;
+    int t1Max = config->a1inFrames > 0 ? config->a1inFrames : (c / 4 > 0 ? c / 4 : 1);
+    int b1Max = config->a1outPages > 0 ? config->a1outPages : (c / 2 > 0 ? c / 2 : 1);
+    RC rc = listInitState(pageCache, true, b1Max + 1 > 2 * c ? b1Max + 1 : 2 * c);
+    if(rc == RC_OK) {
+        ListState* lists = (ListState*) pageCache->policyState;
+        lists->t1Max = t1Max;
+        lists->b1Max = b1Max;
+    }
+    return rc;
+}
+
+// slot of the ghost table where the search for pageNum starts
+static int ghostSlot(const ListState* lists, const PageNumber pageNum)
+{
+    unsigned int h = (unsigned int) pageNum * 0x9E3779B1u;
+    return (int) ((h ^ (h >> 16)) & (unsigned int) lists->ghostMask);
+}
+
+// the ghost of pageNum, or -1
+static int findGhost(const ListState* lists, const PageNumber pageNum)
+{
+    int slot = ghostSlot(lists, pageNum);
+    int g;
+    while((g = lists->ghostTable[slot]) != -1) {
+        if(lists->ghostPage[g] == pageNum) {
+            return g;
+        }
+        slot = (slot + 1) & lists->ghostMask;
+    }
+    return -1;
+}
+
+// forget ghost g, with the same backward shift as the pool's page table
+static void removeGhost(ListState* lists, int g)
+{
+    int* table = lists->ghostTable;
+    int mask = lists->ghostMask;
+    int slot = ghostSlot(lists, lists->ghostPage[g]);
+    while(table[slot] != g) {
+        slot = (slot + 1) & mask;
+    }
+    int next = slot;
+    while(true) {
+        next = (next + 1) & mask;
+        if(table[next] == -1) {
+            break;
+        }
+        int home = ghostSlot(lists, lists->ghostPage[table[next]]);
+        if(((next - home) & mask) >= ((next - slot) & mask)) {
+            table[slot] = table[next];
+            slot = next;
+        }
+    }
+    table[slot] = -1;
+
+    ghostUnlink(lists, lists->ghostList[g] == LIST_B1 ? &lists->b1 : &lists->b2, g);
+    lists->ghostList[g] = LIST_NONE;
+    lists->ghostNext[g] = lists->freeGhost;
+    lists->freeGhost = g;
+}
+
+// remember pageNum as the most recent ghost of B1 or B2
+static void addGhost(ListState* lists, const PageNumber pageNum, char which)
+{
+    if(lists->freeGhost == -1) {
+        removeGhost(lists, lists->b1.size >= lists->b2.size ? lists->b1.head : lists->b2.head);
+    }
+    int g = lists->freeGhost;
+    lists->freeGhost = lists->ghostNext[g];
+    lists->ghostPage[g] = pageNum;
+    lists->ghostList[g] = which;
+    ghostAppend(lists, which == LIST_B1 ? &lists->b1 : &lists->b2, g);
+
+    int slot = ghostSlot(lists, pageNum);
+    while(lists->ghostTable[slot] != -1) {
+        slot = (slot + 1) & lists->ghostMask;
+    }
+    lists->ghostTable[slot] = g;
+}
+
+// the list of the frame's page
+static IndexList* residentList(ListState* lists, const Frame* frame)
+{
+    return frame->meta.list == LIST_T1 ? &lists->t1 : &lists->t2;
+}
+
+// whether the frame's list links it only while it is unpinned
+static bool linkedWhenUnpinned(const ListState* lists, const Frame* frame)
+{
+    return frame->meta.list == LIST_T2 || (frame->meta.list == LIST_T1 && !lists->twoQueue);
+}
+
+// a page was pinned again: an unpinned frame leaves its list until it is
+// released, and under ARC a page used again belongs to T2 from now on;
+// under 2Q a page stays in A1in, however often it is used there
+static void listHit(PageCache* pageCache, Frame* frame)
+{
+    ListState* lists = (ListState*) pageCache->policyState;
+    if(frame->fixCount == 1 && linkedWhenUnpinned(lists, frame)) {
+        frameRemove(pageCache, residentList(lists, frame), frame);
+    }
+    if(!lists->twoQueue && frame->meta.list == LIST_T1) {
+        frame->meta.list = LIST_T2;
+        lists->t1Size--;
+        lists->t2Size++;
+    }
+}
+
+// a page was loaded into a pinned frame: it joins T2 if it left a ghost, else T1
+static void listLoad(PageCache* pageCache, Frame* frame)
+{
+    ListState* lists = (ListState*) pageCache->policyState;
+    int g = findGhost(lists, frame->pageNum);
+    if(g >= 0) {
+        removeGhost(lists, g);
+        frame->meta.list = LIST_T2;
+        lists->t2Size++;
+    } else {
+        frame->meta.list = LIST_T1;
+        lists->t1Size++;
+        if(lists->twoQueue) {
+            frameAppend(pageCache, &lists->t1, frame);
+        }
+    }
+}
+
+// a frame was released: it is now its list's most recent entry
+static void listUnpin(PageCache* pageCache, Frame* frame)
+{
+    ListState* lists = (ListState*) pageCache->policyState;
+    if(linkedWhenUnpinned(lists, frame)) {
+        frameAppend(pageCache, residentList(lists, frame), frame);
+    }
+}
+
+// the page of frame leaves the pool; unless it never finished loading
+// (the frame is still pinned) or the eviction was marked to discard, it
+// is remembered in B1 or B2
+static void listEvict(PageCache* pageCache, Frame* frame)
+{
+    ListState* lists = (ListState*) pageCache->policyState;
+    int which = frame->meta.list;
+    if(which == LIST_NONE) {
+        return;
+    }
+    if(frame->fixCount == 0 || !linkedWhenUnpinned(lists, frame)) {
+        frameRemove(pageCache, residentList(lists, frame), frame);
+    }
+    if(which == LIST_T1) {
+        lists->t1Size--;
+    } else {
+        lists->t2Size--;
+    }
+    if(frame->fixCount == 0 && !lists->discard) {
+        addGhost(lists, frame->pageNum, which == LIST_T1 ? LIST_B1 : LIST_B2);
+        if(lists->twoQueue && lists->b1.size > lists->b1Max) {
+            removeGhost(lists, lists->b1.head);
+        }
+    }
+    lists->discard = false;
+    frame->meta.list = LIST_NONE;
+}
+
+// ARC's response to a miss on pageNum: adapt the target size to the ghost
+// hit, keep the directory within bounds and pick the page to replace
+static Frame* arcVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    ListState* lists = (ListState*) pageCache->policyState;
+    int c = pageCache->capacity;
+    int g = findGhost(lists, pageNum);
+    bool inB2 = false;
+    lists->discard = false;
+
+    if(g >= 0 && lists->ghostList[g] == LIST_B1) {
+        int delta = lists->b2.size > lists->b1.size ? lists->b2.size / lists->b1.size : 1;
+        lists->target = lists->target + delta < c ? lists->target + delta : c;
+    } else if(g >= 0) {
+        int delta = lists->b1.size > lists->b2.size ? lists->b1.size / lists->b2.size : 1;
+        lists->target = lists->target - delta > 0 ? lists->target - delta : 0;
+        inB2 = true;
+    } else if(lists->t1Size + lists->b1.size >= c) {
+        // T1 and its ghosts fill a cache's worth: drop the oldest ghost, or,
+        // when T1 alone is that large, evict from it without a ghost
+        if(lists->b1.size > 0 && lists->t1Size < c) {
+            removeGhost(lists, lists->b1.head);
+        } else {
+            lists->discard = true;
+        }
+    } else if(lists->t1Size + lists->t2Size + lists->b1.size + lists->b2.size >= 2 * c &&
+              lists->b2.size > 0) {
+        removeGhost(lists, lists->b2.head);
+    }
+
+    // replace from T1 when it is over its target, else from T2; if every
+    // frame of that list is pinned, the other list gives up a page instead
+    bool fromT1 = lists->discard || (lists->t1Size > 0 &&
+                  (lists->t1Size > lists->target || (inB2 && lists->t1Size == lists->target)));
+    IndexList* first = fromT1 ? &lists->t1 : &lists->t2;
+    IndexList* second = fromT1 ? &lists->t2 : &lists->t1;
+    if(first->head >= 0) {
+        return pageCache->arr[first->head];
+    }
+    lists->discard = false;
+    if(second->head >= 0) {
+        return pageCache->arr[second->head];
+    }
+    return pageCache->lruHead;
+}
+
+// 2Q's response to a miss: A1in over its size gives up its oldest page,
+// remembered in A1out; otherwise Am gives up its least recently used page
+static Frame* twoQueueVictim(PageCache* pageCache, const PageNumber pageNum)
+{
+    (void) pageNum;
+    ListState* lists = (ListState*) pageCache->policyState;
+    lists->discard = false;
+
+    Frame* victim = NULL;
+    if(lists->t1Size > lists->t1Max || lists->t2.head < 0) {
+        victim = oldestUnpinned(pageCache, &lists->t1);
+    }
+    if(victim == NULL && lists->t2.head >= 0) {
+        victim = pageCache->arr[lists->t2.head];
+        lists->discard = true;
+    }
+    if(victim == NULL) {
+        victim = oldestUnpinned(pageCache, &lists->t1);
+    }
+    return victim != NULL ? victim : pageCache->lruHead;
+}
+
+// --- Built-in policies, by ReplacementStrategy ---
+
+static const BM_ReplacementPolicy builtinPolicies[] = {
+    [RS_FIFO] = { "FIFO", fifoInit, freePolicyState, NULL, fifoLoad, NULL, fifoVictim, fifoEvict },
+    [RS_LRU] = { "LRU", NULL, NULL, NULL, NULL, NULL, lruVictim, NULL },
+    [RS_CLOCK] = { "CLOCK", clockInit, freePolicyState, clockTouch, clockTouch, NULL, clockVictim, NULL },
+    [RS_LFU] = { "LFU", lfuInit, freeHeapState, heapHit, heapLoad, heapUnpin, heapVictim, heapEvict },
+    [RS_LRU_K] = { "LRU-K", lruKInit, freeHeapState, heapHit, heapLoad, heapUnpin, heapVictim, heapEvict },
+    [RS_ARC] = { "ARC", arcInit, freeListState, listHit, listLoad, listUnpin, arcVictim, listEvict },
+    [RS_2Q] = { "2Q", twoQueueInit, freeListState, listHit, listLoad, listUnpin, twoQueueVictim, listEvict },
+};
+
+// the built-in policy implementing strategy, or NULL if there is none
+const BM_ReplacementPolicy* getReplacementPolicy(ReplacementStrategy strategy)
+{
+    int numPolicies = (int) (sizeof(builtinPolicies) / sizeof(builtinPolicies[0]));
+    if((int) strategy < 0 || (int) strategy >= numPolicies) {
+        return NULL;
+    }
+    return &builtinPolicies[strategy];
+}
@@ -41,6 +41,12 @@ static void printStrat(BM_BufferPool *const bm) {
         case RS_LRU_K:
             printf("LRU-K");
             break;
+        case RS_ARC:
+            printf("ARC");
+            break;
+        case RS_2Q:
+            printf("2Q");
+            break;
         default:
             printf("%i", bm->strategy);
             break;
@@ -77,7 +83,7 @@ void printPoolContent(BM_BufferPool *const bm) {
     printStrat(bm);
     printf(" %i}: ", numPages);
     for (int i = 0; i < numPages; i++) {
-        printf("%s[%i%s%i]", (i == 0 ? "" : ","), frameContent[i],
+        printf("%s[%lld%s%i]", (i == 0 ? "" : ","), (long long) frameContent[i],
                (dirtyFlags[i] ? "x" : " "), fixCounts[i]);
     }
     printf("\n");
@@ -108,7 +114,7 @@ char *sprintPoolContent(BM_BufferPool *const bm) {
         return NULL;
     }
 
-    size_t bufSize = 256 + (22 * numPages);
+    size_t bufSize = 256 + (36 * numPages);
     char *message = (char *) malloc(bufSize);
     if (message == NULL) {
         free(frameContent);
@@ -118,8 +124,8 @@ char *sprintPoolContent(BM_BufferPool *const bm) {
     }
     int pos = 0;
     for (int i = 0; i < numPages; i++) {
-        pos += snprintf(message + pos, bufSize - pos, "%s[%i%s%i]",
-                        (i == 0 ? "" : ","), frameContent[i],
+        pos += snprintf(message + pos, bufSize - pos, "%s[%lld%s%i]",
+                        (i == 0 ? "" : ","), (long long) frameContent[i],
                         (dirtyFlags[i] ? "x" : " "), fixCounts[i]);
     }
 
@@ -131,15 +137,21 @@ char *sprintPoolContent(BM_BufferPool *const bm) {
 
 /*
  * printPageContent:
- *   Prints a formatted hexadecimal representation of the content of a page.
+ *   Prints a formatted hexadecimal representation of the content of a page,
+ *   as many bytes as the pages of the pool's file hold.
  */
-void printPageContent(BM_PageHandle *const page) {
+void printPageContent(BM_BufferPool *const bm, BM_PageHandle *const page) {
     if (page == NULL) {
         printf("Page is NULL.\n");
         return;
     }
-    printf("[Page %i]\n", page->pageNum);
-    for (int i = 0; i < PAGE_SIZE; i++) {
+    int pageSize = getPoolPageSize(bm);
+    if (pageSize < 0) {
+        printf("Buffer pool is not initialized.\n");
+        return;
+    }
+    printf("[Page %lld]\n", (long long) page->pageNum);
+    for (int i = 0; i < pageSize; i++) {
         printf("%02X%s", (unsigned char) page->data[i],
                (((i + 1) % 8 == 0) ? " " : ""));
         if ((i + 1) % 64 == 0)
@@ -153,16 +165,17 @@ void printPageContent(BM_PageHandle *const page) {
  *   Returns a string with a formatted hexadecimal representation of the page's content.
  *   The caller is responsible for freeing the returned string.
  */
-char *sprintPageContent(BM_PageHandle *const page) {
-    if (page == NULL)
+char *sprintPageContent(BM_BufferPool *const bm, BM_PageHandle *const page) {
+    int pageSize = getPoolPageSize(bm);
+    if (page == NULL || pageSize < 0)
         return NULL;
-    size_t bufSize = 30 + (2 * PAGE_SIZE) + (PAGE_SIZE / 8) + (PAGE_SIZE / 64);
+    size_t bufSize = 30 + (2 * (size_t) pageSize) + (pageSize / 8) + (pageSize / 64);
     char *message = (char *) malloc(bufSize);
     if (message == NULL)
         return NULL;
     int pos = 0;
-    pos += snprintf(message + pos, bufSize - pos, "[Page %i]\n", page->pageNum);
-    for (int i = 0; i < PAGE_SIZE; i++) {
+    pos += snprintf(message + pos, bufSize - pos, "[Page %lld]\n", (long long) page->pageNum);
+    for (int i = 0; i < pageSize; i++) {
         pos += snprintf(message + pos, bufSize - pos, "%02X%s",
                         (unsigned char) page->data[i],
                         (((i + 1) % 8 == 0) ? " " : ""));
@@ -182,15 +195,17 @@ PageNumber *getFrameContents(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL)
         return NULL;
 
-    BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
     int numPages = bm->numPages;
     PageNumber *arr = (PageNumber *) malloc(numPages * sizeof(PageNumber));
     if (arr == NULL)
         return NULL;
 
+    pthread_mutex_lock(&pageCache->latch);
     for (int i = 0; i < numPages; i++) {
-        arr[i] = mgmt->frames[i].pageNum;
+        arr[i] = pageCache->arr[i]->pageNum;
     }
+    pthread_mutex_unlock(&pageCache->latch);
     return arr;
 }
 
@@ -203,15 +218,17 @@ bool *getDirtyFlags(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL)
         return NULL;
 
-    BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
     int numPages = bm->numPages;
     bool *arr = (bool *) malloc(numPages * sizeof(bool));
     if (arr == NULL)
         return NULL;
 
+    pthread_mutex_lock(&pageCache->latch);
     for (int i = 0; i < numPages; i++) {
-        arr[i] = mgmt->frames[i].dirty;
+        arr[i] = pageCache->arr[i]->dirty;
     }
+    pthread_mutex_unlock(&pageCache->latch);
     return arr;
 }
 
@@ -224,15 +241,17 @@ int *getFixCounts(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL)
         return NULL;
 
-    BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
     int numPages = bm->numPages;
     int *arr = (int *) malloc(numPages * sizeof(int));
     if (arr == NULL)
         return NULL;
 
+    pthread_mutex_lock(&pageCache->latch);
     for (int i = 0; i < numPages; i++) {
-        arr[i] = mgmt->frames[i].fixCount;
+        arr[i] = pageCache->arr[i]->fixCount;
     }
+    pthread_mutex_unlock(&pageCache->latch);
     return arr;
 }
 
@@ -243,8 +262,11 @@ int *getFixCounts(BM_BufferPool *const bm) {
 int getNumReadIO(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL)
         return -1;
-    BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
-    return mgmt->readIO;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    pthread_mutex_lock(&pageCache->latch);
+    int numRead = pageCache->numRead;
+    pthread_mutex_unlock(&pageCache->latch);
+    return numRead;
 }
 
 /*
@@ -254,6 +276,75 @@ int getNumReadIO(BM_BufferPool *const bm) {
 int getNumWriteIO(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL)
         return -1;
-    BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
-    return mgmt->writeIO;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    pthread_mutex_lock(&pageCache->latch);
+    int numWrite = pageCache->numWrite;
+    pthread_mutex_unlock(&pageCache->latch);
+    return numWrite;
+}
+
+/*
+ * getNumWriteIOSaved:
+ *   Returns the number of page writes forceFlushPool merged into a neighbour's vectored write.
+ */
+int getNumWriteIOSaved(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL)
+        return -1;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    pthread_mutex_lock(&pageCache->latch);
+    int numWriteSaved = pageCache->numWriteSaved;
+    pthread_mutex_unlock(&pageCache->latch);
+    return numWriteSaved;
+}
+
+/*
+ * getNumPagesCleaned:
+ *   Returns the number of dirty pages the pool's page cleaner wrote back.
+ */
+int getNumPagesCleaned(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL)
+        return -1;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    pthread_mutex_lock(&pageCache->latch);
+    int numCleaned = pageCache->numCleaned;
+    pthread_mutex_unlock(&pageCache->latch);
+    return numCleaned;
+}
+
+/*
+ * getNumStallsAvoided:
+ *   Returns the number of evictions that found their victim already written
+ *   back by the page cleaner, and so did not have to write it first.
+ */
+int getNumStallsAvoided(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL)
+        return -1;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    pthread_mutex_lock(&pageCache->latch);
+    int numStallsAvoided = pageCache->numStallsAvoided;
+    pthread_mutex_unlock(&pageCache->latch);
+    return numStallsAvoided;
+}
+
+/*
+ * getPoolPageSize:
+ *   Returns the page size of the pool's file, which is the size of every frame.
+ */
+int getPoolPageSize(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL)
+        return -1;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    return pageCache->fHandle->pageSize;
+}
+
+/*
+ * getPoolStorageStats:
+ *   Copies the storage manager's I/O statistics for the pool's file: the
+ *   physical reads and writes, and their latencies, beneath the pool's misses.
+ */
+RC getPoolStorageStats(BM_BufferPool *const bm, SM_IOStats *stats) {
+    if (bm == NULL || bm->mgmtData == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    PageCache *pageCache = (PageCache *) bm->mgmtData;
+    return getStorageStats(pageCache->fHandle, stats);
 }
\ No newline at end of file
@@ -38,6 +38,12 @@ char *errorMessage(RC error) {
         case RC_READ_NON_EXISTING_PAGE:
             message = strdup("Attempt to read a non-existing page");
             break;
+        case RC_PAGE_ALREADY_FREE:
+            message = strdup("Page is already free");
+            break;
+        case RC_PAGE_CORRUPT:
+            message = strdup("Stored page could not be decoded");
+            break;
         /* Buffer Manager Errors */
         case RC_MALLOC_FAILED:
             message = strdup("Memory allocation failed");
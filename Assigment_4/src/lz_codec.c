@@ -0,0 +1,183 @@
+/************************************************************
+ *     File name:                lz_codec.c
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ ************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "lz_codec.h"
+
+#define LZ_MIN_MATCH     4        /* Shortest match worth encoding */
+#define LZ_MAX_OFFSET    65535    /* Offsets are stored in two bytes */
+#define LZ_LAST_LITERALS 5        /* The stream always ends with literals */
+#define LZ_MATCH_LIMIT   12       /* No match may start this close to the end */
+#define LZ_HASH_BITS     12
+
+static uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes a length that did not fit in its 4-bit token field */
+static char *putLength(char *op, const char *oend, int len) {
+    while (len >= 255) {
+        if (op >= oend)
+            return NULL;
+        *op++ = (char) 255;
+        len -= 255;
+    }
+    if (op >= oend)
+        return NULL;
+    *op++ = (char) len;
+    return op;
+}
+
+/* Emits one sequence: literals [anchor, anchor + litLen), then an optional match */
+static char *putSequence(char *op, const char *oend, const char *anchor, int litLen,
+                         int offset, int matchLen) {
+    if (op >= oend)
+        return NULL;
+    char *token = op++;
+    int litCode = litLen < 15 ? litLen : 15;
+    int matchCode = 0;
+    if (matchLen > 0)
+        matchCode = (matchLen - LZ_MIN_MATCH) < 15 ? (matchLen - LZ_MIN_MATCH) : 15;
+    *token = (char) ((litCode << 4) | matchCode);
+
+    if (litLen >= 15 && (op = putLength(op, oend, litLen - 15)) == NULL)
+        return NULL;
+    if (oend - op < litLen)
+        return NULL;
+    memcpy(op, anchor, (size_t) litLen);
+    op += litLen;
+
+    if (matchLen > 0) {
+        if (oend - op < 2)
+            return NULL;
+        *op++ = (char) (offset & 0xff);
+        *op++ = (char) (offset >> 8);
+        if (matchLen - LZ_MIN_MATCH >= 15 &&
+            (op = putLength(op, oend, matchLen - LZ_MIN_MATCH - 15)) == NULL)
+            return NULL;
+    }
+    return op;
+}
+
+int lzCompress(const char *src, int srcLen, char *dst, int dstCapacity) {
+    int table[1 << LZ_HASH_BITS];
+    const char *ip = src;
+    const char *anchor = src;
+    const char *end = src + srcLen;
+    const char *matchLimit = end - LZ_MATCH_LIMIT;
+    const char *extendLimit = end - LZ_LAST_LITERALS;
+    char *op = dst;
+    const char *oend = dst + dstCapacity;
+
+    for (int i = 0; i < (1 << LZ_HASH_BITS); i++)
+        table[i] = -1;
+
+    while (srcLen >= LZ_MATCH_LIMIT && ip <= matchLimit) {
+        uint32_t seq = read32(ip);
+        uint32_t h = hash32(seq);
+        int ref = table[h];
+        table[h] = (int) (ip - src);
+
+        if (ref < 0 || (ip - src) - ref > LZ_MAX_OFFSET || read32(src + ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        /* Grow the match as far as the trailing literals allow */
+        const char *match = src + ref;
+        const char *mp = ip + LZ_MIN_MATCH;
+        const char *rp = match + LZ_MIN_MATCH;
+        while (mp < extendLimit && *mp == *rp) {
+            mp++;
+            rp++;
+        }
+        int matchLen = (int) (mp - ip);
+
+        op = putSequence(op, oend, anchor, (int) (ip - anchor), (int) (ip - match), matchLen);
+        if (op == NULL)
+            return -1;
+        ip = mp;
+        anchor = ip;
+    }
+
+    op = putSequence(op, oend, anchor, (int) (end - anchor), 0, 0);
+    return op == NULL ? -1 : (int) (op - dst);
+}
+
+/* Reads a length extension; returns -1 on truncated input */
+static int getLength(const unsigned char **ip, const unsigned char *iend) {
+    int len = 0;
+    unsigned char b;
+    do {
+        if (*ip >= iend)
+            return -1;
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+int lzDecompress(const char *src, int srcLen, char *dst, int dstCapacity) {
+    const unsigned char *ip = (const unsigned char *) src;
+    const unsigned char *iend = ip + srcLen;
+    char *op = dst;
+    char *oend = dst + dstCapacity;
+
+    while (ip < iend) {
+        int token = *ip++;
+
+        int litLen = token >> 4;
+        if (litLen == 15) {
+            int ext = getLength(&ip, iend);
+            if (ext < 0)
+                return -1;
+            litLen += ext;
+        }
+        if (iend - ip < litLen || oend - op < litLen)
+            return -1;
+        memcpy(op, ip, (size_t) litLen);
+        ip += litLen;
+        op += litLen;
+
+        /* The last sequence carries literals only */
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst)
+            return -1;
+
+        int matchLen = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15) {
+            int ext = getLength(&ip, iend);
+            if (ext < 0)
+                return -1;
+            matchLen += ext;
+        }
+        if (oend - op < matchLen)
+            return -1;
+
+        /* Overlapping matches repeat a short pattern and go byte by byte */
+        const char *match = op - offset;
+        if (offset >= matchLen)
+            memcpy(op, match, (size_t) matchLen);
+        else {
+            for (int i = 0; i < matchLen; i++)
+                op[i] = match[i];
+        }
+        op += matchLen;
+    }
+    return (int) (op - dst);
+}
@@ -12,7 +12,6 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>  // For access()
 
 #include "tables.h"
 #include "rm_serializer.h"
@@ -21,7 +20,7 @@
 #include "storage_mgr.h"
 
 
-PageDirectory* createPageDirectoryNode(int pageNum) {
+PageDirectory* createPageDirectoryNode(PageNumber pageNum) {
     PageDirectory* node = malloc(sizeof(PageDirectory));
     node->pageNum = pageNum;
     node->count = 0;
@@ -47,6 +46,59 @@ RecordNode* deserializeRecords(Schema *schema, char *recordData, int recordSize)
     return NULL;
 }
 
+/*
+ * Function: linkPageDirectory
+ * ---------------------------
+ * Adds a directory node to the cache, keeping the nodes in page order so
+ * that the rear node holds the last data page.
+ */
+static void linkPageDirectory(PageDirectoryCache *cache, PageDirectory *node) {
+    PageDirectory *after = cache->rear;
+    while (after != NULL && after->pageNum > node->pageNum)
+        after = after->pre;
+    node->pre = after;
+    node->next = (after != NULL) ? after->next : cache->front;
+    if (node->next != NULL)
+        node->next->pre = node;
+    else
+        cache->rear = node;
+    if (after != NULL)
+        after->next = node;
+    else
+        cache->front = node;
+    cache->count++;
+}
+
+/*
+ * Function: unlinkPageDirectory
+ * -----------------------------
+ * Removes a directory node from the cache; the caller frees it.
+ */
+static void unlinkPageDirectory(PageDirectoryCache *cache, PageDirectory *node) {
+    if (node->pre != NULL)
+        node->pre->next = node->next;
+    else
+        cache->front = node->next;
+    if (node->next != NULL)
+        node->next->pre = node->pre;
+    else
+        cache->rear = node->pre;
+    cache->count--;
+}
+
+/*
+ * Function: findPageDirectory
+ * ---------------------------
+ * Returns the directory node of a data page, or NULL if the page holds no
+ * records of the table.
+ */
+static PageDirectory *findPageDirectory(PageDirectoryCache *cache, PageNumber pageNum) {
+    PageDirectory *curr = cache->front;
+    while (curr != NULL && curr->pageNum != pageNum)
+        curr = curr->next;
+    return curr;
+}
+
 /* ---------------------------------------------------------------------------
  * Data Structures
  * -------------------------------------------------------------------------*/
@@ -62,7 +114,7 @@ RecordNode* deserializeRecords(Schema *schema, char *recordData, int recordSize)
  *   filter      - The expression filter to be applied during the scan.
  */
 typedef struct ScanCondition {
-    int currentPage;
+    PageNumber currentPage;
     int currentSlot;
     Expr *filter;
 } ScanCondition;
@@ -87,6 +139,12 @@ int recordSizeBytes;         // Size of a record in bytes (including any overhea
 int pageCapacity;            // Maximum number of records that can be stored in a page
 int maxPageDirectories;      // Maximum number of page directory entries per page
 
+// Largest record count a page directory entry can store (3 digits)
+#define MAX_DIRECTORY_COUNT 999
+
+// Data pages a scan asks the kernel to start reading as soon as it begins
+#define SCAN_WILLNEED_PAGES 64
+
 /* ---------------------------------------------------------------------------
  * Initialization and Shutdown Functions
  * -------------------------------------------------------------------------*/
@@ -145,7 +203,7 @@ RC createTable(char *name, Schema *schema) {
         return RC_PARAMS_ERROR;
 
     // Check if the table already exists
-    if (access(name, F_OK) == 0)
+    if (pageFileExists(name))
         return RC_TABLE_EXISTS;
 
     // Create the page file for the table
@@ -156,9 +214,19 @@ RC createTable(char *name, Schema *schema) {
     if (openPageFile(name, &fileHandle) != RC_OK)
         return RC_ERROR;
 
+    // Pages are as large as the file says; strings are copied into a zeroed page
+    int pageSize = fileHandle.pageSize;
+    char *page = (char *) calloc(pageSize, sizeof(char));
+    if (page == NULL) {
+        closePageFile(&fileHandle);
+        return RC_MALLOC_FAILED;
+    }
+
     // Serialize the schema and write it to block 0
     char *schemaData = serializeSchema(schema);
-    if (writeBlock(0, &fileHandle, schemaData) != RC_OK) {
+    strncpy(page, schemaData, pageSize - 1);
+    if (writeBlock(0, &fileHandle, page) != RC_OK) {
+        free(page);
         free(schemaData);
         return RC_WRITE_FAILED;
     }
@@ -168,7 +236,10 @@ RC createTable(char *name, Schema *schema) {
     char *dirData = serializePageDirectory(dirNode);
 
     ensureCapacity(2, &fileHandle);
-    if (writeBlock(1, &fileHandle, dirData) != RC_OK) {
+    memset(page, 0, pageSize);
+    strncpy(page, dirData, pageSize - 1);
+    if (writeBlock(1, &fileHandle, page) != RC_OK) {
+        free(page);
         free(dirData);
         return RC_WRITE_FAILED;
     }
@@ -176,12 +247,15 @@ RC createTable(char *name, Schema *schema) {
     // Close file to flush changes
     closePageFile(&fileHandle);
 
-    // Initialize global metadata
+    // Initialize global metadata; the page layout follows the file's page size
     totalTuples = 0;
     recordSizeBytes = getRecordSize(schema) + sizeof(int) + sizeof(int) + 2 + 2 + 2 + 3 + 1 + 3 + 1;
-    pageCapacity = 110;  // Reduced capacity to account for overhead
-    maxPageDirectories = PAGE_SIZE / strlen(dirData);
+    pageCapacity = pageSize / recordSizeBytes;
+    if (pageCapacity > MAX_DIRECTORY_COUNT)
+        pageCapacity = MAX_DIRECTORY_COUNT;  // directory entries hold 3-digit counts
+    maxPageDirectories = pageSize / strlen(dirData);
 
+    free(page);
     free(schemaData);
     free(dirNode);
     free(dirData);
@@ -206,7 +280,7 @@ RC openTable(RM_TableData *rel, char *name) {
     if (rel == NULL || name == NULL)
         return RC_PARAMS_ERROR;
 
-    if (access(name, F_OK) == -1)
+    if (!pageFileExists(name))
         return TABLE_DOES_NOT_EXIST;
 
     // Initialize buffer pool and page handle
@@ -228,6 +302,9 @@ RC openTable(RM_TableData *rel, char *name) {
     rel->schema = tableSchema;
     rel->mgmtData = dirCache;
     unpinPage(bufferPool, pageHandle);
+
+    // Record lookups touch single pages, so kernel read-ahead would only waste I/O
+    adviseAccess(bufferPool, 0, 0, SM_ADVICE_RANDOM);
     return RC_OK;
 }
 
@@ -254,10 +331,11 @@ RC closeTable(RM_TableData *rel) {
     PageDirectoryCache *dirCache = rel->mgmtData;
     char *dirData = serializePageDirectories(dirCache);
     strcpy(frame->data, dirData);
+    free(dirData);
     markDirty(bufferPool, pageHandle);
     unpinPage(bufferPool, pageHandle);
-    forcePage(bufferPool, pageHandle);
 
+    // writes back every page the table changed
     shutdownBufferPool(bufferPool);
     freeSchema(rel->schema);
 
@@ -288,7 +366,7 @@ RC deleteTable(char *name) {
     (void)*name;
     if (name == NULL)
         return RC_FILE_NOT_FOUND;
-    if (access(name, F_OK) == -1)
+    if (!pageFileExists(name))
         return TABLE_DOES_NOT_EXIST;
     return destroyPageFile(name);
 }
@@ -316,7 +394,9 @@ int getNumTuples(RM_TableData *rel) {
 /*
  * Function: flushDataToPage
  * -------------------------
- * Writes a string of data into a specific page at a given offset.
+ * Writes a string of data into a specific page at a given offset. The
+ * page is only marked dirty; the buffer pool writes it back when it is
+ * evicted or the table is closed.
  *
  * Parameters:
  *   data    - The data string to write.
@@ -326,7 +406,7 @@ int getNumTuples(RM_TableData *rel) {
  * Returns:
  *   RC_OK on success or an appropriate error code.
  */
-RC flushDataToPage(char *data, int offset, int pageNum) {
+RC flushDataToPage(char *data, int offset, PageNumber pageNum) {
     (void)*data;
     (void)offset;
     (void)pageNum;
@@ -340,7 +420,6 @@ RC flushDataToPage(char *data, int offset, int pageNum) {
     strcpy(frame->data + offset, data);
     markDirty(bufferPool, pageHandle);
     unpinPage(bufferPool, pageHandle);
-    forcePage(bufferPool, pageHandle);
     return RC_OK;
 }
 
@@ -397,26 +476,26 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         curr = curr->next;
     }
 
-    // If no free slot is found, create a new page directory node
+    // If no free slot is found, take a new data page: a page freed when its
+    // last record was deleted is reused before the file grows
     if (targetDir == NULL) {
-        int newPageNum = dirCache->rear->pageNum + 1;
+        PageNumber newPageNum;
+        if (allocatePoolPage(bufferPool, &newPageNum) != RC_OK)
+            return RC_WRITE_FAILED;
         PageDirectory *newDir = createPageDirectoryNode(newPageNum);
         if (dirCache->count % maxPageDirectories == 0) {
-            newPageNum = dirCache->rear->pageNum + 1;
             char *tempDirData = serializePageDirectory(newDir);
             flushDataToPage(tempDirData, 0, newPageNum);
+            free(tempDirData);
         }
-        dirCache->rear->next = newDir;
-        newDir->pre = dirCache->rear;
-        dirCache->rear = newDir;
-        dirCache->count++;
-        targetDir = dirCache->rear;
+        linkPageDirectory(dirCache, newDir);
+        targetDir = newDir;
     }
 
     if (targetDir == NULL)
         return RC_ERROR;
 
-    int targetPage = targetDir->pageNum;
+    PageNumber targetPage = targetDir->pageNum;
     int freeSlot = targetDir->firstFreeSlot;
 
     // Set record identifier and serialize record data
@@ -425,6 +504,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     int offset = record->id.slot * recordSizeBytes;
     char *serializedRecord = serializeRecord(record, schema);
     flushDataToPage(serializedRecord, offset, targetPage);
+    free(serializedRecord);
 
     // Update directory metadata and total tuple count
     targetDir->count++;
@@ -436,7 +516,8 @@ RC insertRecord(RM_TableData *rel, Record *record) {
 /*
  * Function: deleteRecord
  * ----------------------
- * Deletes a record identified by its RID by marking it as deleted.
+ * Deletes a record identified by its RID by marking it as deleted. A data
+ * page left without records is handed back to the file's free-page map.
  *
  * Parameters:
  *   rel - Pointer to the RM_TableData structure.
@@ -457,8 +538,6 @@ RC deleteRecord(RM_TableData *rel, RID id) {
 
     while (curr != NULL) {
         if (curr->pageNum == id.page) {
-            pinPage(bufferPool, pageHandle, curr->pageNum);
-
             // Create a temporary record to mark as deleted
             Record *tempRecord = (Record *)malloc(sizeof(Record));
             if (tempRecord == NULL)
@@ -480,9 +559,13 @@ RC deleteRecord(RM_TableData *rel, RID id) {
             PageCache *cache = bufferPool->mgmtData;
             Frame *frame = searchPageFromCache(cache, pageHandle->pageNum);
             strncpy(frame->data + offset, deletedData, recordSizeBytes);
+            free(deletedData);
+            if (tempRecord->data != dataBuffer)
+                free(tempRecord->data);
+            free(dataBuffer);
+            free(tempRecord);
             markDirty(bufferPool, pageHandle);
             unpinPage(bufferPool, pageHandle);
-            forcePage(bufferPool, pageHandle);
 
             // Update record list and directory info
             getRecords(rel, pageHandle->data, recordSizeBytes);
@@ -498,6 +581,14 @@ RC deleteRecord(RM_TableData *rel, RID id) {
                 node = node->next;
             }
             totalTuples--;
+
+            // The page holds no records any more: let a later insert reuse it
+            if (curr->count == 0) {
+                unlinkPageDirectory(dirCache, curr);
+                RC rc = freePoolPage(bufferPool, curr->pageNum);
+                free(curr);
+                return rc;
+            }
             break;
         }
         curr = curr->next;
@@ -550,7 +641,6 @@ RC updateRecord(RM_TableData *rel, Record *record) {
             strcpy(frame->data + offset, updatedData);
             markDirty(bufferPool, pageHandle);
             unpinPage(bufferPool, pageHandle);
-            forcePage(bufferPool, pageHandle);
             free(tempRecord);
         }
         curr = curr->next;
@@ -582,6 +672,7 @@ RC getRecord(RM_TableData *rel, RID id, Record *record) {
     record->id.slot = id.slot;
     pinPage(bufferPool, pageHandle, id.page);
     getRecords(rel, pageHandle->data, recordSizeBytes);
+    unpinPage(bufferPool, pageHandle);
     RecordNode *curr = recordListHead;
     while (curr != NULL) {
         if (id.page == curr->page && id.slot == curr->slot) {
@@ -628,6 +719,11 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
     scanCond->currentSlot = 0;
     scanCond->filter = cond;
 
+    // A scan reads the data pages in order: ask for deep read-ahead and
+    // have the first stretch read in right away
+    adviseAccess(bufferPool, 2, 0, SM_ADVICE_SEQUENTIAL);
+    adviseAccess(bufferPool, 2, SCAN_WILLNEED_PAGES, SM_ADVICE_WILLNEED);
+
     scan->rel = rel;
     return RC_OK;
 }
@@ -653,10 +749,12 @@ RC next(RM_ScanHandle *scan, Record *record) {
 
     RM_TableData *rel = scan->rel;
     ScanCondition *scanCond = (ScanCondition *)scan->mgmtData;
-    int currentPage = scanCond->currentPage;
+    PageNumber currentPage = scanCond->currentPage;
     int currentSlot = scanCond->currentSlot;
     PageDirectoryCache *dirCache = rel->mgmtData;
-    int maxPageNum = dirCache->rear->pageNum;
+    if (dirCache->rear == NULL)
+        return RC_RM_NO_MORE_TUPLES;
+    PageNumber maxPageNum = dirCache->rear->pageNum;
 
     // End scan if current page or slot exceeds limits
     if (currentPage > maxPageNum || (currentPage <= maxPageNum && currentSlot >= pageCapacity))
@@ -670,6 +768,11 @@ RC next(RM_ScanHandle *scan, Record *record) {
                 scanCond->currentPage++;
             continue;
         }
+        // Pages freed by deleteRecord hold no records
+        if (findPageDirectory(dirCache, scanCond->currentPage) == NULL) {
+            scanCond->currentSlot = pageCapacity;
+            continue;
+        }
         RID rid;
         rid.page = scanCond->currentPage;
         rid.slot = scanCond->currentSlot;
@@ -706,6 +809,9 @@ RC closeScan(RM_ScanHandle *scan) {
     (void)*scan;
     if (scan->mgmtData)
         free(scan->mgmtData);
+
+    // Back to point lookups
+    adviseAccess(bufferPool, 0, 0, SM_ADVICE_RANDOM);
     return RC_OK;
 }
 
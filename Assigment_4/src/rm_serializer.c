@@ -63,7 +63,7 @@ char *serializeRecord(Record *record, Schema *schema) {
     (void)schema;
     char *result = (char *) malloc(100);
     if (!result) return NULL;
-    snprintf(result, 100, "%d:%d:%s", record->id.page, record->id.slot, record->data);
+    snprintf(result, 100, "%lld:%d:%s", (long long) record->id.page, record->id.slot, record->data);
     return result;
 }
 
@@ -117,10 +117,10 @@ char *serializePageDirectory(PageDirectory *pd) {
     MAKE_VARSTRING(result);
     int attrSize = sizeof(int);
     char data[attrSize + 1];
-    memset(data, '0', sizeof(char) * 4);
 
-    PageInfoToString(3, pd->pageNum, data);
-    APPEND(result, "[%s-", data);
+    // page numbers take as many digits as a 64-bit PageNumber can need,
+    // so RIDs past page 999 survive the directory unchanged
+    APPEND(result, "[%0*lld-", PAGE_NUMBER_DIGITS, (long long) pd->pageNum);
 
     memset(data, '0', sizeof(char) * 4);
     PageInfoToString(3, pd->count, data);
@@ -142,7 +142,9 @@ char *serializePageDirectories(PageDirectoryCache *pageDirectoryCache) {
     MAKE_VARSTRING(result);
     PageDirectory *p = pageDirectoryCache->front;
     while (p != NULL) {
-        APPEND_STRING(result, serializePageDirectory(p));
+        char *entry = serializePageDirectory(p);
+        APPEND_STRING(result, entry);
+        free(entry);
         p = p->next;
     }
     RETURN_STRING(result);
@@ -3,11 +3,1968 @@
  *     CS 525 Advanced Database Organization (Spring 2025)
  *     Harlee Ramos, Jisun Yun, Baozhu Xie
  ************************************************************/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE             /* O_DIRECT, fallocate */
+#endif
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
 #include "storage_mgr.h"
 #include "dberror.h"
+#include "lz_codec.h"
+
+/*
+ * Mapped files are mapped in fixed-size segments. Growing the file maps
+ * new segments and never moves existing ones, so page pointers handed
+ * out by getPagePointer stay valid until the file is closed. Segments
+ * cover the file from offset 0, header included, and every page size
+ * divides the segment size, so no page straddles two segments.
+ */
+#define MMAP_SEGMENT_BYTES  ((size_t) 64 * 1024 * 1024)
+
+/*
+ * Page files start with a header page (SM_FileHeader) recording the page
+ * size; logical page p is stored at (p + 1) * pageSize. Files without a
+ * header are read as PAGE_SIZE pages starting at offset 0.
+ */
+#define SM_FILE_MAGIC   "SMPGFILE"
+#define SM_FILE_VERSION 1
+
+typedef struct SM_FileHeader {
+    char magic[8];
+    int32_t version;
+    int32_t pageSize;
+} SM_FileHeader;
+
+/* How the pages of a file are laid out, as told by its first bytes */
+typedef enum SM_FileFormat {
+    SM_FORMAT_HEADERLESS,  /* No header: PAGE_SIZE pages from offset 0 */
+    SM_FORMAT_PAGED,       /* SM_FileHeader, then fixed-size pages */
+    SM_FORMAT_COMPRESSED,  /* CP_Header, then compressed extents */
+    SM_FORMAT_MEMORY       /* In-memory file (SM_IO_MEMORY), no header */
+} SM_FileFormat;
+
+/*
+ * Compressed page files (SM_IO_COMPRESSED) start with one header page
+ * (CP_Header). Every logical page is stored LZ-compressed in an extent
+ * somewhere after it, and an extent table, itself kept in the file and
+ * located by the header, maps page numbers to extents. Pages that do not
+ * compress are stored as is; all-zero pages take no space at all.
+ */
+#define CP_MAGIC  "SMCPAGE1"
+#define CP_GRAIN  256           /* Extents are allocated in multiples of this */
+#define CP_RUN_BYTES (256 * 1024) /* Largest run of adjacent extents read at once */
+
+typedef struct CP_Header {
+    char magic[8];
+    int64_t numPages;     /* Logical pages in the file */
+    int64_t mapOffset;    /* Byte offset of the extent table */
+    int64_t mapCapacity;  /* Bytes reserved for the table; 0 if never written */
+    int64_t dataEnd;      /* Extents are appended from here */
+    int64_t pageSize;     /* Logical page size; 0 in older files means PAGE_SIZE */
+} CP_Header;
+
+/* Where one logical page lives; entries are stored in the file as is */
+typedef struct CP_Extent {
+    int64_t offset;       /* Byte offset of the extent, 0 if none was ever allocated */
+    uint32_t length;      /* Stored bytes: 0 for a zero page, pageSize if uncompressed */
+    uint32_t capacity;    /* Bytes allocated at offset, a multiple of CP_GRAIN */
+} CP_Extent;
+
+/*
+ * Group commit state of a file (SM_DURABILITY_GROUP_COMMIT). Every force,
+ * through any handle on the file, takes a ticket; one sync covers all
+ * tickets handed out before it began.
+ */
+typedef struct SM_SyncGroup {
+    pthread_mutex_t lock;
+    pthread_cond_t done;      /* Broadcast when a sync finishes */
+    uint64_t requested;   /* Last ticket handed out */
+    uint64_t synced;      /* Every ticket up to this one is durable */
+    int leading;          /* A force is waiting to sync, or syncing */
+    int64_t lastSync;     /* Monotonic time of the last sync, in microseconds */
+    RC error;             /* A failed sync fails every later force too */
+} SM_SyncGroup;
+
+/*
+ * What every handle open on one file shares, kept in the file's
+ * SM_CachedFile or SM_MemFile. A handle's own totalNumPages may lag
+ * behind numPages while other handles grow the file; resizes start from
+ * numPages, so no handle cuts off pages it has not seen. The free-page
+ * map and the extent table of a compressed file are loaded by the first
+ * open and kept here too, so handles never hand out the same free page
+ * or the same extent, nor write back diverging copies on close. Forces
+ * through any handle join the same sync group, so one sync covers them all.
+ * Lock order: lock, then extentLock.
+ */
+typedef struct SM_SharedFile {
+    pthread_mutex_t lock;     /* Held across every resize; guards the fields up to extentLock */
+    PageNumber numPages;      /* Data pages in the file; read atomically without the lock */
+    PageNumber reservedPages; /* Pages with disk space reserved (>= numPages) */
+    int numHandles;       /* Handles open on the file */
+    int freeMapLoaded;    /* The fork has been read, or found missing */
+    int fsmFd;            /* Descriptor of the fork, -1 until a page is first freed */
+    uint8_t *freeMap;     /* One bit per page, set while the page is free */
+    PageNumber freeMapPages;  /* Pages covered by freeMap */
+    PageNumber numFree;   /* Number of set bits in freeMap */
+    PageNumber freeHint;  /* No page below this one is free */
+    pthread_mutex_t extentLock;   /* SM_IO_COMPRESSED: guards the fields below */
+    int extentsLoaded;    /* The extent table has been read */
+    CP_Extent *extents;   /* Extent of every logical page */
+    PageNumber extentSlots;   /* Allocated length of extents[] */
+    int64_t dataEnd;      /* First byte past the last extent */
+    int64_t mapOffset;    /* Extent table location in the file */
+    int64_t mapCapacity;  /* Bytes reserved for the table */
+    int mapDirty;         /* Table changed since it was last written */
+    SM_SyncGroup group;   /* SM_DURABILITY_GROUP_COMMIT: waiting forces of every handle */
+} SM_SharedFile;
+
+/*
+ * Directory of the segment (SM_IO_MMAP) or chunk (SM_IO_MEMORY) addresses
+ * of a file. It grows in blocks that never move, so threads look pages up
+ * without a lock while another thread grows the file; each entry is set
+ * before the page count covering it is published.
+ */
+#define SM_DIR_BLOCK_ENTRIES 1024
+#define SM_DIR_BLOCKS        1024
+
+typedef struct SM_AddressDir {
+    char **blocks[SM_DIR_BLOCKS];
+} SM_AddressDir;
+
+/*
+ * In-memory page files (SM_IO_MEMORY) exist only inside this process.
+ * They are found by name, keep their pages across close and reopen, and
+ * are gone after destroyPageFile or exit. Pages are allocated in chunks
+ * that never move, so page pointers stay valid while the file is open.
+ */
+#define MEM_CHUNK_PAGES 64
+
+typedef struct SM_MemFile {
+    char *name;
+    int pageSize;
+    SM_AddressDir chunks; /* MEM_CHUNK_PAGES zero-initialised pages each */
+    PageNumber numChunks;     /* Chunks allocated so far; never shrinks */
+    SM_SharedFile shared; /* Size and free-page map, which has no fork */
+    int openCount;        /* Handles currently open on the file */
+    int destroyed;        /* Destroyed while open: freed on the last close */
+    struct SM_MemFile *next;
+} SM_MemFile;
+
+/*
+ * Open-file cache: one read-write descriptor per on-disk page file,
+ * shared by every handle open on it and kept open after the last close
+ * so reopening costs no system calls. The header format, page size and
+ * page count are cached with it; resizes through any handle keep the
+ * count current. Space reserved past end of file is handed back once the
+ * last handle closes. Entries no handle uses are closed least recently
+ * used first once more than fileCacheBudget descriptors are open.
+ */
+#define FC_BUCKETS 1024
+
+typedef struct SM_CachedFile {
+    char *name;
+    int fd;               /* O_RDWR descriptor shared by the file's handles */
+    SM_FileFormat format; /* Layout told by the header */
+    int pageSize;         /* Bytes per page, from the header */
+    SM_SharedFile shared; /* Size, reservation and metadata of the file */
+    int refCount;         /* Handles open on the file */
+    int detached;         /* Destroyed or recreated while open: closed on the last release */
+    struct SM_CachedFile *hashNext;
+    struct SM_CachedFile *idlePrev;   /* Idle list, most recently released first */
+    struct SM_CachedFile *idleNext;
+} SM_CachedFile;
+
+/*
+ * Operations behind one I/O mode, chosen when the file is opened. The
+ * public functions check their arguments and dispatch through the table.
+ * Every operation gets the open handle; totalNumPages is still the size
+ * before the call.
+ */
+typedef struct SM_Backend {
+    /* Opens fileName and sets fHandle->totalNumPages */
+    RC (*open)(SM_FileHandle *fHandle, const char *fileName);
+    /* Writes out pending metadata and releases what open acquired */
+    RC (*close)(SM_FileHandle *fHandle);
+    /* Move count consecutive pages: page pageNum + i to or from bufs[i] */
+    RC (*read)(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]);
+    RC (*write)(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]);
+    /*
+     * Grows the file with zero pages, or cuts it back, to newNumPages pages.
+     * Called with the shared lock held; shared->numPages is the size before
+     * the call, which may be past this handle's totalNumPages.
+     */
+    RC (*resize)(SM_FileHandle *fHandle, PageNumber newNumPages);
+    /* Makes pages [pageNum, pageNum + count) durable */
+    RC (*sync)(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count);
+    /* Address of a page for zero-copy access; NULL if the backend has none */
+    char *(*pagePointer)(SM_FileHandle *fHandle, PageNumber pageNum);
+    /* Passes an access-pattern hint for pages [pageNum, pageNum + count) to the kernel */
+    RC (*advise)(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count, SM_Advice advice);
+} SM_Backend;
+
+/*
+ * Per-file management data stored in SM_FileHandle.mgmtInfo.
+ * Only one of fp / fd / memFile is in use, depending on the I/O mode;
+ * fd is the cached descriptor except in SM_IO_DIRECT.
+ */
+typedef struct SM_FileMgmt {
+    SM_IOMode mode;       /* Backend chosen at open time */
+    const SM_Backend *ops;    /* Operations of that backend */
+    int pageSize;         /* Bytes per page */
+    off_t dataStart;      /* Offset of page 0: one header page, or 0 without a header */
+    FILE *fp;             /* SM_IO_STDIO: buffered stream */
+    int fd;               /* SM_IO_POSITIONAL / SM_IO_MMAP / SM_IO_DIRECT: raw descriptor */
+    pthread_mutex_t ioLock;   /* SM_IO_STDIO: held across each seek and the transfer after it */
+    SM_AddressDir segments;   /* SM_IO_MMAP: base address of each mapped segment */
+    int numSegments;      /* SM_IO_MMAP: number of mapped segments */
+    SM_GrowthPolicy growth; /* How far ahead space is reserved on growth */
+    int growthAmount;     /* Percent or chunk size, depending on growth */
+    char *fsmName;        /* Free-page map fork: "<fileName>.fsm" */
+    SM_MemFile *memFile;  /* SM_IO_MEMORY: the file's pages */
+    SM_CachedFile *cached;    /* On-disk files: shared descriptor and metadata */
+    SM_SharedFile *shared;    /* State shared with the file's other handles */
+    SM_Durability durability; /* What flushBlocks does after handing pages to the kernel */
+    int groupIntervalUs;  /* SM_DURABILITY_GROUP_COMMIT: shortest time between syncs */
+    SM_IOStats stats;     /* I/O counters and latencies, updated with relaxed atomics */
+} SM_FileMgmt;
+
+/*
+ * Free-page map fork layout: one header page (FSM_Header), then the
+ * bitmap, bit p of byte p / 8 standing for page p.
+ */
+#define FSM_SUFFIX  ".fsm"
+#define FSM_MAGIC   "SMFREEPG"
+
+typedef struct FSM_Header {
+    char magic[8];
+    int64_t numPages;     /* Pages covered by the bitmap */
+    int64_t numFree;      /* Informational; recounted on load */
+} FSM_Header;
+
+/* Mode used by openPageFile; positional I/O unless changed by the caller */
+static SM_IOMode defaultIOMode = SM_IO_POSITIONAL;
+
+/* Page size given to files created from now on */
+static int defaultPageSize = PAGE_SIZE;
+
+/* Zeros written into a reused page; aligned so direct I/O can use it as is */
+static _Alignas(SM_IO_ALIGNMENT) const char zeroPage[SM_MAX_PAGE_SIZE];
+
+/* Growth policy given to files opened from now on */
+static SM_GrowthPolicy defaultGrowth = SM_GROW_PERCENT;
+static int defaultGrowthAmount = 25;
+
+/* Open-file cache: entries by name, idle ones in LRU order (see SM_CachedFile) */
+static SM_CachedFile *fileCache[FC_BUCKETS];
+static SM_CachedFile *idleHead = NULL;
+static SM_CachedFile *idleTail = NULL;
+static int fileCacheBudget = SM_DEFAULT_FILE_CACHE_BUDGET;
+static int numCachedFiles = 0;
+static SM_FileCacheStats fileCacheStats;
+static pthread_mutex_t fileCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Whether reads and writes are timed for the latency histograms */
+static int ioTiming = 1;
+
+/* Durability mode given to files opened from now on */
+static SM_Durability defaultDurability = SM_DURABILITY_NONE;
+static int defaultGroupIntervalUs = SM_DEFAULT_GROUP_INTERVAL_US;
+
+/*
+ * Direct I/O needs SM_IO_ALIGNMENT-aligned buffers. Callers that pass an
+ * unaligned page go through this per-thread bounce buffer instead.
+ */
+static _Thread_local _Alignas(SM_IO_ALIGNMENT) char bouncePage[SM_MAX_PAGE_SIZE];
+
+#define IS_IO_ALIGNED(ptr) (((uintptr_t) (ptr) & (SM_IO_ALIGNMENT - 1)) == 0)
+
+/* Byte offset of a page in the file */
+static off_t pageOffset(const SM_FileMgmt *mgmt, PageNumber pageNum) {
+    return mgmt->dataStart + (off_t) pageNum * mgmt->pageSize;
+}
+
+/* Page sizes are powers of two between SM_MIN_PAGE_SIZE and SM_MAX_PAGE_SIZE */
+static int isValidPageSize(int64_t pageSize) {
+    return pageSize >= SM_MIN_PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE &&
+           (pageSize & (pageSize - 1)) == 0;
+}
+
+/* Largest number of pages moved by one preadv/pwritev call */
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define MAX_IOV_PAGES IOV_MAX
+#else
+#define MAX_IOV_PAGES 1024
+#endif
+
+/*
+ * curPagePos is only a hint for the relative read functions. Concurrent
+ * readers may all update it, so the store is atomic to keep it well defined.
+ */
+#define SET_PAGE_POS(fHandle, pageNum) \
+    __atomic_store_n(&(fHandle)->curPagePos, (pageNum), __ATOMIC_RELAXED)
+
+/*
+ * Threads sharing a handle through a buffer pool read and write pages
+ * while one of them grows the file, so the page count the block functions
+ * check against is loaded and stored atomically. The store releases the
+ * address directory entries the growth added to threads that load it.
+ */
+#define NUM_PAGES(fHandle) __atomic_load_n(&(fHandle)->totalNumPages, __ATOMIC_ACQUIRE)
+#define SET_NUM_PAGES(fHandle, numPages) \
+    __atomic_store_n(&(fHandle)->totalNumPages, (numPages), __ATOMIC_RELEASE)
+
+/*
+ * Reads exactly len bytes at offset, retrying on short reads and EINTR.
+ * Bytes past end of file are returned as zeros.
+ */
+static RC preadFull(int fd, char *buf, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, offset + (off_t) done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+        if (n == 0) {
+            memset(buf + done, 0, len - done);
+            break;
+        }
+        done += (size_t) n;
+    }
+    return RC_OK;
+}
+
+/*
+ * Writes exactly len bytes at offset, retrying on short writes and EINTR.
+ */
+static RC pwriteFull(int fd, const char *buf, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(fd, buf + done, len - done, offset + (off_t) done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return RC_WRITE_FAILED;
+        }
+        done += (size_t) n;
+    }
+    return RC_OK;
+}
+
+/*
+ * Moves count consecutive pages between the file and bufs with as few
+ * preadv/pwritev calls as possible, resuming after short transfers.
+ */
+static RC vectorIO(int fd, SM_PageHandle bufs[], int count, int pageSize, off_t offset, int isWrite) {
+    struct iovec iov[MAX_IOV_PAGES];
+    int done = 0;
+
+    while (done < count) {
+        int batch = count - done;
+        if (batch > MAX_IOV_PAGES)
+            batch = MAX_IOV_PAGES;
+        for (int i = 0; i < batch; i++) {
+            iov[i].iov_base = bufs[done + i];
+            iov[i].iov_len = (size_t) pageSize;
+        }
+
+        struct iovec *cur = iov;
+        int curCount = batch;
+        off_t pos = offset + (off_t) done * pageSize;
+        while (curCount > 0) {
+            ssize_t n = isWrite ? pwritev(fd, cur, curCount, pos)
+                                : preadv(fd, cur, curCount, pos);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+            }
+            if (n == 0) {
+                if (isWrite)
+                    return RC_WRITE_FAILED;
+                /* End of file: the remaining pages read as zeros */
+                for (int i = 0; i < curCount; i++)
+                    memset(cur[i].iov_base, 0, cur[i].iov_len);
+                break;
+            }
+            pos += n;
+            /* Skip fully transferred buffers, trim a partially transferred one */
+            while (curCount > 0 && (size_t) n >= cur->iov_len) {
+                n -= (ssize_t) cur->iov_len;
+                cur++;
+                curCount--;
+            }
+            if (curCount > 0) {
+                cur->iov_base = (char *) cur->iov_base + n;
+                cur->iov_len -= (size_t) n;
+            }
+        }
+        done += batch;
+    }
+    return RC_OK;
+}
+
+/*
+ * Opens a descriptor that bypasses the kernel page cache.
+ */
+static int openDirect(const char *fileName) {
+#if defined(O_DIRECT)
+    return open(fileName, O_RDWR | O_DIRECT);
+#elif defined(F_NOCACHE)
+    int fd = open(fileName, O_RDWR);
+    if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    (void) fileName;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+/* Sets entry i of a directory, allocating its block first */
+static RC setDirEntry(SM_AddressDir *dir, PageNumber i, char *addr) {
+    if (i >= (PageNumber) SM_DIR_BLOCKS * SM_DIR_BLOCK_ENTRIES)
+        return RC_MALLOC_FAILED;
+    char ***block = &dir->blocks[i / SM_DIR_BLOCK_ENTRIES];
+    if (*block == NULL && (*block = (char **) calloc(SM_DIR_BLOCK_ENTRIES, sizeof(char *))) == NULL)
+        return RC_MALLOC_FAILED;
+    (*block)[i % SM_DIR_BLOCK_ENTRIES] = addr;
+    return RC_OK;
+}
+
+static char *dirEntry(const SM_AddressDir *dir, PageNumber i) {
+    return dir->blocks[i / SM_DIR_BLOCK_ENTRIES][i % SM_DIR_BLOCK_ENTRIES];
+}
+
+/* Frees the blocks of a directory, not what its entries point to */
+static void freeDirBlocks(SM_AddressDir *dir) {
+    for (int b = 0; b < SM_DIR_BLOCKS && dir->blocks[b] != NULL; b++) {
+        free(dir->blocks[b]);
+        dir->blocks[b] = NULL;
+    }
+}
+
+/*
+ * Maps enough segments to cover numPages pages of a mapped file.
+ * Segments may extend past end of file; only pages below
+ * totalNumPages are ever touched.
+ */
+static RC mapSegments(SM_FileMgmt *mgmt, PageNumber numPages) {
+    off_t end = pageOffset(mgmt, numPages);
+    int needed = (int) ((end + (off_t) MMAP_SEGMENT_BYTES - 1) / (off_t) MMAP_SEGMENT_BYTES);
+    while (mgmt->numSegments < needed) {
+        off_t offset = (off_t) mgmt->numSegments * (off_t) MMAP_SEGMENT_BYTES;
+        void *addr = mmap(NULL, MMAP_SEGMENT_BYTES, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, mgmt->fd, offset);
+        if (addr == MAP_FAILED)
+            return RC_MALLOC_FAILED;
+        if (setDirEntry(&mgmt->segments, mgmt->numSegments, (char *) addr) != RC_OK) {
+            munmap(addr, MMAP_SEGMENT_BYTES);
+            return RC_MALLOC_FAILED;
+        }
+        mgmt->numSegments++;
+    }
+    return RC_OK;
+}
+
+/* Releases every mapped segment of a file */
+static void unmapSegments(SM_FileMgmt *mgmt) {
+    for (int i = 0; i < mgmt->numSegments; i++)
+        munmap(dirEntry(&mgmt->segments, i), MMAP_SEGMENT_BYTES);
+    freeDirBlocks(&mgmt->segments);
+    mgmt->numSegments = 0;
+}
+
+/* Address of a byte offset inside a mapped file */
+static char *mappedOffset(SM_FileMgmt *mgmt, off_t offset) {
+    return dirEntry(&mgmt->segments, offset / (off_t) MMAP_SEGMENT_BYTES)
+           + (size_t) (offset % (off_t) MMAP_SEGMENT_BYTES);
+}
+
+/* End of the part of bytes [offset, end) that lies in offset's segment */
+static off_t segmentRunEnd(off_t offset, off_t end) {
+    off_t segEnd = (offset / (off_t) MMAP_SEGMENT_BYTES + 1) * (off_t) MMAP_SEGMENT_BYTES;
+    return end < segEnd ? end : segEnd;
+}
+
+/* Address of a page inside a mapped file */
+static char *mappedPage(SM_FileMgmt *mgmt, PageNumber pageNum) {
+    return mappedOffset(mgmt, pageOffset(mgmt, pageNum));
+}
+
+/* --- Compressed page file helpers --- */
+
+/*
+ * Reads the first bytes of a file to tell its format and page size.
+ * A file too short for a header, or without a known magic, is headerless.
+ */
+static RC probeDescriptor(int fd, SM_FileFormat *format, int *pageSize) {
+    union {
+        SM_FileHeader paged;
+        CP_Header compressed;
+    } header;
+    memset(&header, 0, sizeof(header));
+    ssize_t n = pread(fd, &header, sizeof(header), 0);
+
+    *format = SM_FORMAT_HEADERLESS;
+    *pageSize = PAGE_SIZE;
+    if (n >= (ssize_t) sizeof(SM_FileHeader) &&
+        memcmp(header.paged.magic, SM_FILE_MAGIC, sizeof(header.paged.magic)) == 0) {
+        *format = SM_FORMAT_PAGED;
+        *pageSize = header.paged.pageSize;
+    } else if (n >= (ssize_t) sizeof(CP_Header) - (ssize_t) sizeof(int64_t) &&
+               memcmp(header.compressed.magic, CP_MAGIC, sizeof(header.compressed.magic)) == 0) {
+        *format = SM_FORMAT_COMPRESSED;
+        if (header.compressed.pageSize != 0)
+            *pageSize = (int) header.compressed.pageSize;
+    }
+    return isValidPageSize(*pageSize) ? RC_OK : RC_PAGE_CORRUPT;
+}
+
+/* Makes room in the extent table for numPages pages; new entries are zero pages */
+static RC growExtents(SM_FileMgmt *mgmt, PageNumber numPages) {
+    if (numPages <= mgmt->shared->extentSlots)
+        return RC_OK;
+    PageNumber slots = mgmt->shared->extentSlots ? mgmt->shared->extentSlots : 64;
+    while (slots < numPages)
+        slots *= 2;
+    CP_Extent *extents = (CP_Extent *) realloc(mgmt->shared->extents, (size_t) slots * sizeof(CP_Extent));
+    if (extents == NULL)
+        return RC_MALLOC_FAILED;
+    memset(extents + mgmt->shared->extentSlots, 0, (size_t) (slots - mgmt->shared->extentSlots) * sizeof(CP_Extent));
+    mgmt->shared->extents = extents;
+    mgmt->shared->extentSlots = slots;
+    return RC_OK;
+}
+
+/* Reads the header and the extent table of a compressed file */
+static RC loadExtents(SM_FileMgmt *mgmt, PageNumber *numPages) {
+    CP_Header header;
+    if (preadFull(mgmt->fd, (char *) &header, sizeof(header), 0) != RC_OK ||
+        memcmp(header.magic, CP_MAGIC, sizeof(header.magic)) != 0 || header.numPages < 0)
+        return RC_PAGE_CORRUPT;
+
+    RC rc = growExtents(mgmt, header.numPages);
+    if (rc != RC_OK)
+        return rc;
+    int64_t stored = header.numPages * (int64_t) sizeof(CP_Extent);
+    if (stored > header.mapCapacity)
+        stored = header.mapCapacity;
+    if (stored > 0) {
+        rc = preadFull(mgmt->fd, (char *) mgmt->shared->extents, (size_t) stored, (off_t) header.mapOffset);
+        if (rc != RC_OK)
+            return rc;
+    }
+    mgmt->shared->dataEnd = header.dataEnd;
+    mgmt->shared->mapOffset = header.mapOffset;
+    mgmt->shared->mapCapacity = header.mapCapacity;
+    *numPages = header.numPages;
+    return RC_OK;
+}
+
+/*
+ * Writes the extent table and then the header. The table is rewritten in
+ * place while it fits; otherwise it moves to a larger slot at the end of
+ * the file, sized with room to spare.
+ */
+static RC saveExtents(SM_FileMgmt *mgmt) {
+    if (!mgmt->shared->mapDirty)
+        return RC_OK;
+
+    PageNumber numPages = __atomic_load_n(&mgmt->shared->numPages, __ATOMIC_RELAXED);
+    int64_t bytes = numPages * (int64_t) sizeof(CP_Extent);
+    if (bytes > mgmt->shared->mapCapacity) {
+        mgmt->shared->mapCapacity = (bytes * 2 + mgmt->pageSize - 1) / mgmt->pageSize * mgmt->pageSize;
+        mgmt->shared->mapOffset = mgmt->shared->dataEnd;
+        mgmt->shared->dataEnd += mgmt->shared->mapCapacity;
+    }
+    if (bytes > 0) {
+        RC rc = pwriteFull(mgmt->fd, (const char *) mgmt->shared->extents, (size_t) bytes, (off_t) mgmt->shared->mapOffset);
+        if (rc != RC_OK)
+            return rc;
+    }
+
+    CP_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CP_MAGIC, sizeof(header.magic));
+    header.numPages = numPages;
+    header.mapOffset = mgmt->shared->mapOffset;
+    header.mapCapacity = mgmt->shared->mapCapacity;
+    header.dataEnd = mgmt->shared->dataEnd;
+    header.pageSize = mgmt->pageSize;
+    RC rc = pwriteFull(mgmt->fd, (const char *) &header, sizeof(header), 0);
+    if (rc == RC_OK)
+        mgmt->shared->mapDirty = 0;
+    return rc;
+}
+
+/* Decodes one stored extent into memPage */
+static RC decodeExtent(const SM_FileMgmt *mgmt, const CP_Extent *ext, const char *stored,
+                       SM_PageHandle memPage) {
+    if (ext->length == (uint32_t) mgmt->pageSize) {
+        if (stored != memPage)
+            memcpy(memPage, stored, (size_t) mgmt->pageSize);
+        return RC_OK;
+    }
+    if (lzDecompress(stored, (int) ext->length, memPage, mgmt->pageSize) != mgmt->pageSize)
+        return RC_PAGE_CORRUPT;
+    return RC_OK;
+}
+
+/* Reads and decompresses one logical page */
+static RC readCompressedPage(SM_FileMgmt *mgmt, PageNumber pageNum, SM_PageHandle memPage) {
+    const CP_Extent *ext = &mgmt->shared->extents[pageNum];
+    if (ext->length == 0) {
+        memset(memPage, 0, (size_t) mgmt->pageSize);
+        return RC_OK;
+    }
+    /* Uncompressed pages are read straight into the caller's buffer */
+    char *stored = (ext->length == (uint32_t) mgmt->pageSize) ? memPage : bouncePage;
+    RC rc = preadFull(mgmt->fd, stored, ext->length, (off_t) ext->offset);
+    if (rc != RC_OK)
+        return rc;
+    return decodeExtent(mgmt, ext, stored, memPage);
+}
+
+/*
+ * Reads count logical pages. Pages written in order sit in adjacent
+ * extents, so each such stretch is fetched with one pread and then
+ * decompressed page by page.
+ */
+static RC readCompressedRun(SM_FileMgmt *mgmt, PageNumber startPage, int count, SM_PageHandle bufs[]) {
+    char *run = NULL;
+    int i = 0;
+    RC rc = RC_OK;
+
+    while (i < count && rc == RC_OK) {
+        const CP_Extent *first = &mgmt->shared->extents[startPage + i];
+        int64_t end = first->offset + first->capacity;
+        int j = i + 1;
+        while (first->length > 0 && j < count) {
+            const CP_Extent *next = &mgmt->shared->extents[startPage + j];
+            if (next->length == 0 || next->offset != end ||
+                end + next->capacity - first->offset > CP_RUN_BYTES)
+                break;
+            end += next->capacity;
+            j++;
+        }
+
+        if (j - i == 1) {
+            rc = readCompressedPage(mgmt, startPage + i, bufs[i]);
+            i++;
+            continue;
+        }
+
+        if (run == NULL && (run = (char *) malloc(CP_RUN_BYTES)) == NULL)
+            return RC_MALLOC_FAILED;
+        rc = preadFull(mgmt->fd, run, (size_t) (end - first->offset), (off_t) first->offset);
+        for (; i < j && rc == RC_OK; i++) {
+            const CP_Extent *ext = &mgmt->shared->extents[startPage + i];
+            rc = decodeExtent(mgmt, ext, run + (ext->offset - first->offset), bufs[i]);
+        }
+    }
+    free(run);
+    return rc;
+}
+
+/*
+ * Compresses memPage and stores it. The page keeps its extent while the
+ * new image fits; otherwise a new extent is appended and the old one is
+ * left unused.
+ */
+static RC writeCompressedPage(SM_FileMgmt *mgmt, PageNumber pageNum, SM_PageHandle memPage) {
+    CP_Extent *ext = &mgmt->shared->extents[pageNum];
+    mgmt->shared->mapDirty = 1;
+    if (memcmp(memPage, zeroPage, (size_t) mgmt->pageSize) == 0) {
+        ext->length = 0;
+        return RC_OK;
+    }
+
+    /* Compression must save at least one grain to be worth decoding */
+    const char *stored = bouncePage;
+    int length = lzCompress(memPage, mgmt->pageSize, bouncePage, mgmt->pageSize - CP_GRAIN);
+    if (length < 0) {
+        stored = memPage;
+        length = mgmt->pageSize;
+    }
+
+    uint32_t needed = (uint32_t) (length + CP_GRAIN - 1) / CP_GRAIN * CP_GRAIN;
+    if (ext->offset == 0 || needed > ext->capacity) {
+        ext->offset = mgmt->shared->dataEnd;
+        ext->capacity = needed;
+        mgmt->shared->dataEnd += needed;
+    }
+    ext->length = (uint32_t) length;
+    return pwriteFull(mgmt->fd, stored, (size_t) length, (off_t) ext->offset);
+}
+
+/* Percentage growth never reserves more than this many bytes ahead */
+#define MAX_PERCENT_RESERVE ((PageNumber) 64 * 1024 * 1024)
+
+/* Number of pages to reserve once the file needs newNumPages pages */
+static PageNumber growthTarget(SM_FileMgmt *mgmt, PageNumber newNumPages) {
+    PageNumber target = newNumPages;
+    if (mgmt->growth == SM_GROW_PERCENT) {
+        PageNumber ahead = newNumPages / 100 * mgmt->growthAmount
+                           + newNumPages % 100 * mgmt->growthAmount / 100;
+        PageNumber maxAhead = MAX_PERCENT_RESERVE / mgmt->pageSize;
+        target += ahead < maxAhead ? ahead : maxAhead;
+    }
+    else if (mgmt->growth == SM_GROW_CHUNK && mgmt->growthAmount > 1)
+        target = (target + mgmt->growthAmount - 1) / mgmt->growthAmount * mgmt->growthAmount;
+    return target;
+}
+
+/*
+ * Allocates disk blocks for bytes [offset, end) past end of file without
+ * changing the file size. Best effort: file systems that cannot do it
+ * just allocate blocks on first write, as before.
+ */
+static void reserveSpace(int fd, off_t offset, off_t end) {
+    off_t len = end - offset;
+#if defined(__linux__)
+    while (fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, len) != 0 && errno == EINTR)
+        ;
+#elif defined(F_PREALLOCATE)
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, len, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) != 0) {
+        store.fst_flags = F_ALLOCATEALL;
+        fcntl(fd, F_PREALLOCATE, &store);
+    }
+    (void) offset;
+#else
+    (void) fd;
+    (void) offset;
+    (void) len;
+#endif
+}
+
+/* Returns reserved space past end of file (bytes [offset, end)) to the file system */
+static void releaseReservation(int fd, off_t offset, off_t end) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    if (end > offset)
+        fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, end - offset);
+#else
+    (void) fd;
+    (void) offset;
+    (void) end;
+#endif
+}
+
+static void initSharedFile(SM_SharedFile *shared, PageNumber numPages) {
+    memset(shared, 0, sizeof(*shared));
+    pthread_mutex_init(&shared->lock, NULL);
+    pthread_mutex_init(&shared->extentLock, NULL);
+    pthread_mutex_init(&shared->group.lock, NULL);
+    pthread_cond_init(&shared->group.done, NULL);
+    shared->numPages = numPages;
+    shared->reservedPages = numPages;
+    shared->fsmFd = -1;
+}
+
+static void destroySharedFile(SM_SharedFile *shared) {
+    if (shared->fsmFd >= 0)
+        close(shared->fsmFd);
+    free(shared->freeMap);
+    free(shared->extents);
+    pthread_mutex_destroy(&shared->lock);
+    pthread_mutex_destroy(&shared->extentLock);
+    pthread_mutex_destroy(&shared->group.lock);
+    pthread_cond_destroy(&shared->group.done);
+}
+
+/* --- Open-file cache --- */
+
+/* FNV-1a hash of a file name, reduced to a bucket of fileCache */
+static size_t fileCacheBucket(const char *fileName) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *) fileName; *c != '\0'; c++)
+        hash = (hash ^ *c) * 16777619u;
+    return hash & (FC_BUCKETS - 1);
+}
+
+/* Finds the cached entry of fileName; the caller holds fileCacheLock */
+static SM_CachedFile *findCachedFile(const char *fileName) {
+    for (SM_CachedFile *file = fileCache[fileCacheBucket(fileName)]; file != NULL; file = file->hashNext) {
+        if (strcmp(file->name, fileName) == 0)
+            return file;
+    }
+    return NULL;
+}
+
+static void removeIdle(SM_CachedFile *file) {
+    if (file->idlePrev != NULL)
+        file->idlePrev->idleNext = file->idleNext;
+    else
+        idleHead = file->idleNext;
+    if (file->idleNext != NULL)
+        file->idleNext->idlePrev = file->idlePrev;
+    else
+        idleTail = file->idlePrev;
+    file->idlePrev = file->idleNext = NULL;
+}
+
+static void pushIdle(SM_CachedFile *file) {
+    file->idlePrev = NULL;
+    file->idleNext = idleHead;
+    if (idleHead != NULL)
+        idleHead->idlePrev = file;
+    else
+        idleTail = file;
+    idleHead = file;
+}
+
+/* Takes an entry out of the name table; the caller holds fileCacheLock */
+static void unhashCachedFile(SM_CachedFile *file) {
+    SM_CachedFile **link = &fileCache[fileCacheBucket(file->name)];
+    while (*link != file)
+        link = &(*link)->hashNext;
+    *link = file->hashNext;
+    numCachedFiles--;
+}
+
+static void freeCachedFile(SM_CachedFile *file) {
+    destroySharedFile(&file->shared);
+    close(file->fd);
+    free(file->name);
+    free(file);
+}
+
+/* Closes idle descriptors, oldest first, until the cache fits its budget */
+static void trimFileCache(int budget) {
+    while (numCachedFiles > budget && idleTail != NULL) {
+        SM_CachedFile *victim = idleTail;
+        removeIdle(victim);
+        unhashCachedFile(victim);
+        freeCachedFile(victim);
+        fileCacheStats.evictions++;
+    }
+}
+
+/*
+ * Adds a freshly opened descriptor to the cache with refCount handles on
+ * it, unless another thread cached the same file first. The descriptor
+ * is closed when the entry cannot be made. The caller holds fileCacheLock.
+ */
+static SM_CachedFile *insertCachedFile(const char *fileName, int fd, SM_FileFormat format,
+                                       int pageSize, PageNumber numPages, int refCount) {
+    SM_CachedFile *file = findCachedFile(fileName);
+    if (file != NULL) {
+        close(fd);
+        if (refCount > 0 && file->refCount++ == 0)
+            removeIdle(file);
+        return file;
+    }
+
+    file = (SM_CachedFile *) calloc(1, sizeof(SM_CachedFile));
+    if (file == NULL || (file->name = strdup(fileName)) == NULL) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+    file->fd = fd;
+    file->format = format;
+    file->pageSize = pageSize;
+    initSharedFile(&file->shared, numPages);
+    file->refCount = refCount;
+    size_t bucket = fileCacheBucket(fileName);
+    file->hashNext = fileCache[bucket];
+    fileCache[bucket] = file;
+    numCachedFiles++;
+    if (refCount == 0)
+        pushIdle(file);
+    trimFileCache(fileCacheBudget);
+    return file;
+}
+
+/*
+ * Returns the cache entry of an on-disk page file with one more handle
+ * on it. On a miss the file is opened, its header probed and its size
+ * taken, outside the lock.
+ */
+static RC acquireCachedFile(const char *fileName, SM_CachedFile **cached) {
+    pthread_mutex_lock(&fileCacheLock);
+    SM_CachedFile *file = findCachedFile(fileName);
+    if (file != NULL) {
+        if (file->refCount++ == 0)
+            removeIdle(file);
+        fileCacheStats.hits++;
+        pthread_mutex_unlock(&fileCacheLock);
+        *cached = file;
+        return RC_OK;
+    }
+    fileCacheStats.misses++;
+    pthread_mutex_unlock(&fileCacheLock);
+
+    int fd = open(fileName, O_RDWR);
+    if (fd < 0)
+        return RC_FILE_NOT_FOUND;
+    SM_FileFormat format;
+    int pageSize;
+    RC rc = probeDescriptor(fd, &format, &pageSize);
+    struct stat st;
+    if (rc == RC_OK && format != SM_FORMAT_COMPRESSED && fstat(fd, &st) != 0)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    if (rc != RC_OK) {
+        close(fd);
+        return rc;
+    }
+    PageNumber numPages = 0;
+    off_t dataStart = (format == SM_FORMAT_PAGED) ? pageSize : 0;
+    if (format != SM_FORMAT_COMPRESSED && st.st_size > dataStart)
+        numPages = (PageNumber) ((st.st_size - dataStart) / pageSize);
+
+    pthread_mutex_lock(&fileCacheLock);
+    file = insertCachedFile(fileName, fd, format, pageSize, numPages, 1);
+    pthread_mutex_unlock(&fileCacheLock);
+    *cached = file;
+    return file != NULL ? RC_OK : RC_MALLOC_FAILED;
+}
+
+/*
+ * Hands back the space reserved past end of file. Only done once no
+ * handle is open, as any handle may have grown the file into it since.
+ * Compressed files reserve nothing.
+ */
+static void releaseUnusedSpace(SM_CachedFile *file) {
+    SM_SharedFile *shared = &file->shared;
+    off_t dataStart = (file->format == SM_FORMAT_PAGED) ? file->pageSize : 0;
+    if (file->format != SM_FORMAT_COMPRESSED)
+        releaseReservation(file->fd, dataStart + (off_t) shared->numPages * file->pageSize,
+                           dataStart + (off_t) shared->reservedPages * file->pageSize);
+    shared->reservedPages = shared->numPages;
+}
+
+/*
+ * Drops one handle from an entry; the descriptor stays open while the
+ * budget allows. A detached entry keeps its reservation: the name, and
+ * with O_TRUNC the very inode, may already belong to a new file.
+ */
+static void releaseCachedFile(SM_CachedFile *file) {
+    pthread_mutex_lock(&fileCacheLock);
+    if (--file->refCount == 0) {
+        if (file->detached)
+            freeCachedFile(file);
+        else {
+            releaseUnusedSpace(file);
+            pushIdle(file);
+            trimFileCache(fileCacheBudget);
+        }
+    }
+    pthread_mutex_unlock(&fileCacheLock);
+}
+
+/* Forgets fileName before it is destroyed or recreated; open handles keep their descriptor */
+static void forgetCachedFile(const char *fileName) {
+    pthread_mutex_lock(&fileCacheLock);
+    SM_CachedFile *file = findCachedFile(fileName);
+    if (file != NULL) {
+        unhashCachedFile(file);
+        if (file->refCount == 0) {
+            removeIdle(file);
+            freeCachedFile(file);
+        } else
+            file->detached = 1;
+    }
+    pthread_mutex_unlock(&fileCacheLock);
+}
+
+static int isFileCached(const char *fileName) {
+    pthread_mutex_lock(&fileCacheLock);
+    int found = findCachedFile(fileName) != NULL;
+    pthread_mutex_unlock(&fileCacheLock);
+    return found;
+}
+
+/* --- Backends --- */
+
+/*
+ * Sets a descriptor-based file to exactly newNumPages pages with one
+ * ftruncate. When the file grows past the reservation, space for the
+ * next stretch of pages is reserved up front per the growth policy.
+ * The reservation is shared by the file's handles, under the shared lock.
+ */
+static RC resizeDescriptor(SM_FileHandle *fHandle, int fd, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_SharedFile *shared = mgmt->shared;
+
+    /*
+     * Only the stretch past the new size is reserved, so a large jump
+     * (e.g. pinning a far page) leaves the skipped range sparse.
+     */
+    if (newNumPages > shared->reservedPages) {
+        PageNumber target = growthTarget(mgmt, newNumPages);
+        if (target > newNumPages)
+            reserveSpace(fd, pageOffset(mgmt, newNumPages), pageOffset(mgmt, target));
+        shared->reservedPages = target;
+    }
+
+    if (ftruncate(fd, pageOffset(mgmt, newNumPages)) != 0)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+/* Positional and direct writes are already in the kernel's hands */
+static RC syncNothing(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count) {
+    (void) fHandle;
+    (void) pageNum;
+    (void) count;
+    return RC_OK;
+}
+
+/*
+ * Passes a hint for bytes [offset, offset + len) of a descriptor to the
+ * kernel. Hints are best effort: systems without posix_fadvise only get
+ * read-ahead requests, and failures are ignored.
+ */
+static void adviseDescriptor(int fd, off_t offset, off_t len, SM_Advice advice) {
+#if defined(POSIX_FADV_NORMAL)
+    static const int fadvice[] = {
+        POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM,
+        POSIX_FADV_WILLNEED, POSIX_FADV_DONTNEED
+    };
+    posix_fadvise(fd, offset, len, fadvice[advice]);
+#elif defined(F_RDADVISE)
+    if (advice == SM_ADVICE_WILLNEED) {
+        struct radvisory ra = { offset, (int) (len < INT_MAX ? len : INT_MAX) };
+        fcntl(fd, F_RDADVISE, &ra);
+    }
+#else
+    (void) fd;
+    (void) offset;
+    (void) len;
+    (void) advice;
+#endif
+}
+
+/* Direct I/O bypasses the page cache and in-memory files have none, so hints do nothing */
+static RC adviseNothing(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count, SM_Advice advice) {
+    (void) fHandle;
+    (void) pageNum;
+    (void) count;
+    (void) advice;
+    return RC_OK;
+}
+
+/* SM_IO_STDIO: one buffered FILE* stream */
+
+static RC stdioOpen(SM_FileHandle *fHandle, const char *fileName) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    mgmt->fp = fopen(fileName, "r+");
+    if (mgmt->fp == NULL)
+        return RC_FILE_NOT_FOUND;
+    fHandle->totalNumPages = __atomic_load_n(&mgmt->shared->numPages, __ATOMIC_ACQUIRE);
+    return RC_OK;
+}
+
+static RC stdioClose(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    fflush(mgmt->fp);
+    fclose(mgmt->fp);
+    return RC_OK;
+}
+
+/*
+ * The stream has one file position, so each seek and its transfer hold ioLock.
+ * Like preadFull, pages past the end of the file read as zeros; a stream
+ * error fails the read.
+ */
+static RC stdioRead(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&mgmt->ioLock);
+    if (fseeko(mgmt->fp, pageOffset(mgmt, pageNum), SEEK_SET) != 0)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    for (int i = 0; i < count && rc == RC_OK; i++) {
+        size_t n = fread(bufs[i], sizeof(char), (size_t) mgmt->pageSize, mgmt->fp);
+        if (n < (size_t) mgmt->pageSize) {
+            if (ferror(mgmt->fp)) {
+                clearerr(mgmt->fp);
+                rc = RC_READ_NON_EXISTING_PAGE;
+            } else {
+                memset(bufs[i] + n, 0, (size_t) mgmt->pageSize - n);
+            }
+        }
+    }
+    pthread_mutex_unlock(&mgmt->ioLock);
+    return rc;
+}
+
+static RC stdioWrite(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&mgmt->ioLock);
+    if (fseeko(mgmt->fp, pageOffset(mgmt, pageNum), SEEK_SET) != 0)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    for (int i = 0; i < count && rc == RC_OK; i++) {
+        if (fwrite(bufs[i], sizeof(char), (size_t) mgmt->pageSize, mgmt->fp) != (size_t) mgmt->pageSize)
+            rc = RC_WRITE_FAILED;
+    }
+    pthread_mutex_unlock(&mgmt->ioLock);
+    return rc;
+}
+
+static RC stdioResize(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    /* Buffered writes must reach the file before its size changes */
+    pthread_mutex_lock(&mgmt->ioLock);
+    RC rc = (fflush(mgmt->fp) == 0) ? resizeDescriptor(fHandle, fileno(mgmt->fp), newNumPages)
+                                     : RC_WRITE_FAILED;
+    pthread_mutex_unlock(&mgmt->ioLock);
+    return rc;
+}
+
+static RC stdioSync(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    (void) pageNum;
+    (void) count;
+    pthread_mutex_lock(&mgmt->ioLock);
+    int result = fflush(mgmt->fp);
+    pthread_mutex_unlock(&mgmt->ioLock);
+    return result == 0 ? RC_OK : RC_WRITE_FAILED;
+}
+
+static RC stdioAdvise(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count, SM_Advice advice) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    adviseDescriptor(fileno(mgmt->fp), pageOffset(mgmt, pageNum), (off_t) count * mgmt->pageSize, advice);
+    return RC_OK;
+}
+
+static const SM_Backend stdioBackend = {
+    stdioOpen, stdioClose, stdioRead, stdioWrite, stdioResize, stdioSync, NULL, stdioAdvise
+};
+
+/* SM_IO_POSITIONAL: pread/pwrite on a raw descriptor, preadv/pwritev for runs */
+
+/* Direct I/O needs its own O_DIRECT descriptor; the other modes share the cached one */
+static RC descriptorOpen(SM_FileHandle *fHandle, const char *fileName) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    mgmt->fd = (mgmt->mode == SM_IO_DIRECT) ? openDirect(fileName) : mgmt->cached->fd;
+    if (mgmt->fd < 0)
+        return RC_FILE_NOT_FOUND;
+    fHandle->totalNumPages = __atomic_load_n(&mgmt->shared->numPages, __ATOMIC_ACQUIRE);
+    return RC_OK;
+}
+
+static RC descriptorClose(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (mgmt->mode == SM_IO_DIRECT)
+        close(mgmt->fd);
+    return RC_OK;
+}
+
+static RC positionalRead(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (count == 1)
+        return preadFull(mgmt->fd, bufs[0], (size_t) mgmt->pageSize, pageOffset(mgmt, pageNum));
+    return vectorIO(mgmt->fd, bufs, count, mgmt->pageSize, pageOffset(mgmt, pageNum), 0);
+}
+
+static RC positionalWrite(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (count == 1)
+        return pwriteFull(mgmt->fd, bufs[0], (size_t) mgmt->pageSize, pageOffset(mgmt, pageNum));
+    return vectorIO(mgmt->fd, bufs, count, mgmt->pageSize, pageOffset(mgmt, pageNum), 1);
+}
+
+static RC descriptorResize(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return resizeDescriptor(fHandle, mgmt->fd, newNumPages);
+}
+
+static RC descriptorAdvise(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count, SM_Advice advice) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    adviseDescriptor(mgmt->fd, pageOffset(mgmt, pageNum), (off_t) count * mgmt->pageSize, advice);
+    return RC_OK;
+}
+
+static const SM_Backend positionalBackend = {
+    descriptorOpen, descriptorClose, positionalRead, positionalWrite, descriptorResize,
+    syncNothing, NULL, descriptorAdvise
+};
+
+/* SM_IO_DIRECT: positional I/O with O_DIRECT; unaligned pages go through bouncePage */
+
+static int allAligned(SM_PageHandle bufs[], int count) {
+    for (int i = 0; i < count; i++) {
+        if (!IS_IO_ALIGNED(bufs[i]))
+            return 0;
+    }
+    return 1;
+}
+
+static RC directRead(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (allAligned(bufs, count))
+        return positionalRead(fHandle, pageNum, count, bufs);
+    for (int i = 0; i < count; i++) {
+        RC rc = preadFull(mgmt->fd, bouncePage, (size_t) mgmt->pageSize, pageOffset(mgmt, pageNum + i));
+        if (rc != RC_OK)
+            return rc;
+        memcpy(bufs[i], bouncePage, (size_t) mgmt->pageSize);
+    }
+    return RC_OK;
+}
+
+static RC directWrite(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (allAligned(bufs, count))
+        return positionalWrite(fHandle, pageNum, count, bufs);
+    for (int i = 0; i < count; i++) {
+        memcpy(bouncePage, bufs[i], (size_t) mgmt->pageSize);
+        RC rc = pwriteFull(mgmt->fd, bouncePage, (size_t) mgmt->pageSize, pageOffset(mgmt, pageNum + i));
+        if (rc != RC_OK)
+            return rc;
+    }
+    return RC_OK;
+}
+
+static const SM_Backend directBackend = {
+    descriptorOpen, descriptorClose, directRead, directWrite, descriptorResize,
+    syncNothing, NULL, adviseNothing
+};
+
+/* SM_IO_MMAP: the file is mapped in segments; pages are copied or handed out in place */
+
+static RC mmapOpen(SM_FileHandle *fHandle, const char *fileName) {
+    RC rc = descriptorOpen(fHandle, fileName);
+    if (rc != RC_OK)
+        return rc;
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (mapSegments(mgmt, fHandle->totalNumPages) != RC_OK) {
+        unmapSegments(mgmt);
+        return RC_MALLOC_FAILED;
+    }
+    return RC_OK;
+}
+
+static RC mmapClose(SM_FileHandle *fHandle) {
+    unmapSegments(fHandle->mgmtInfo);
+    return descriptorClose(fHandle);
+}
+
+static RC mmapRead(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    for (int i = 0; i < count; i++) {
+        char *src = mappedPage(mgmt, pageNum + i);
+        if (src != bufs[i])
+            memcpy(bufs[i], src, (size_t) mgmt->pageSize);
+    }
+    return RC_OK;
+}
+
+static RC mmapWrite(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    for (int i = 0; i < count; i++) {
+        /* Pages edited in place through getPagePointer need no copy */
+        char *dst = mappedPage(mgmt, pageNum + i);
+        if (dst != bufs[i])
+            memcpy(dst, bufs[i], (size_t) mgmt->pageSize);
+    }
+    return RC_OK;
+}
+
+/* Growing a mapped file also maps any new segments the larger file needs */
+static RC mmapResize(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    RC rc = descriptorResize(fHandle, newNumPages);
+    if (rc != RC_OK || newNumPages < fHandle->totalNumPages)
+        return rc;
+    return mapSegments(fHandle->mgmtInfo, newNumPages);
+}
+
+static RC mmapSync(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+
+    /* Without durability the pages only need to be scheduled for write-back */
+    int flags = (mgmt->durability == SM_DURABILITY_NONE) ? MS_ASYNC : MS_SYNC;
+
+    /* A run of pages may cross segment boundaries; sync each piece */
+    off_t offset = pageOffset(mgmt, pageNum);
+    off_t end = pageOffset(mgmt, pageNum + count);
+    while (offset < end) {
+        off_t runEnd = segmentRunEnd(offset, end);
+        if (msync(mappedOffset(mgmt, offset), (size_t) (runEnd - offset), flags) != 0)
+            return RC_WRITE_FAILED;
+        offset = runEnd;
+    }
+    return RC_OK;
+}
+
+static char *mmapPagePointer(SM_FileHandle *fHandle, PageNumber pageNum) {
+    return mappedPage(fHandle->mgmtInfo, pageNum);
+}
+
+/* Mapped pages are faulted in through the mapping, so the hint goes to it */
+static RC mmapAdvise(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count, SM_Advice advice) {
+#if defined(POSIX_MADV_NORMAL)
+    static const int madvice[] = {
+        POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM,
+        POSIX_MADV_WILLNEED, POSIX_MADV_DONTNEED
+    };
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    uintptr_t osPage = (uintptr_t) sysconf(_SC_PAGESIZE);
+    off_t offset = pageOffset(mgmt, pageNum);
+    off_t end = pageOffset(mgmt, pageNum + count);
+    while (offset < end) {
+        off_t runEnd = segmentRunEnd(offset, end);
+        char *addr = mappedOffset(mgmt, offset);
+        char *start = (char *) ((uintptr_t) addr & ~(osPage - 1));
+        posix_madvise(start, (size_t) (runEnd - offset) + (size_t) (addr - start), madvice[advice]);
+        offset = runEnd;
+    }
+#else
+    (void) fHandle;
+    (void) pageNum;
+    (void) count;
+    (void) advice;
+#endif
+    return RC_OK;
+}
+
+static const SM_Backend mmapBackend = {
+    mmapOpen, mmapClose, mmapRead, mmapWrite, mmapResize, mmapSync, mmapPagePointer, mmapAdvise
+};
+
+/* SM_IO_COMPRESSED: pages LZ-compressed into extents located by the extent table */
+
+/*
+ * The extent table is read by the first handle opened on the file and
+ * shared by all of them; every use of it holds the entry's extentLock.
+ */
+static RC compressedOpen(SM_FileHandle *fHandle, const char *fileName) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_SharedFile *shared = mgmt->shared;
+    (void) fileName;
+    mgmt->fd = mgmt->cached->fd;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&shared->lock);
+    pthread_mutex_lock(&shared->extentLock);
+    if (!shared->extentsLoaded) {
+        PageNumber numPages;
+        rc = loadExtents(mgmt, &numPages);
+        if (rc == RC_OK) {
+            shared->extentsLoaded = 1;
+            __atomic_store_n(&shared->numPages, numPages, __ATOMIC_RELEASE);
+        }
+    }
+    fHandle->totalNumPages = shared->numPages;
+    pthread_mutex_unlock(&shared->extentLock);
+    pthread_mutex_unlock(&shared->lock);
+    return rc;
+}
+
+static RC compressedRead(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    pthread_mutex_lock(&mgmt->shared->extentLock);
+    RC rc = (count == 1) ? readCompressedPage(mgmt, pageNum, bufs[0])
+                         : readCompressedRun(mgmt, pageNum, count, bufs);
+    pthread_mutex_unlock(&mgmt->shared->extentLock);
+    return rc;
+}
+
+static RC compressedWrite(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&mgmt->shared->extentLock);
+    for (int i = 0; i < count && rc == RC_OK; i++)
+        rc = writeCompressedPage(mgmt, pageNum + i, bufs[i]);
+    pthread_mutex_unlock(&mgmt->shared->extentLock);
+    return rc;
+}
+
+/*
+ * New compressed pages are zero pages, so only the extent table grows.
+ * Dropped pages forget their extents; the space is not reclaimed.
+ */
+static RC compressedResize(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_SharedFile *shared = mgmt->shared;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&shared->extentLock);
+    if (newNumPages > shared->numPages)
+        rc = growExtents(mgmt, newNumPages);
+    else
+        memset(shared->extents + newNumPages, 0,
+               (size_t) (shared->numPages - newNumPages) * sizeof(CP_Extent));
+    if (rc == RC_OK)
+        shared->mapDirty = 1;
+    pthread_mutex_unlock(&shared->extentLock);
+    return rc;
+}
+
+static RC compressedSync(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    (void) pageNum;
+    (void) count;
+    pthread_mutex_lock(&mgmt->shared->extentLock);
+    RC rc = saveExtents(mgmt);
+    pthread_mutex_unlock(&mgmt->shared->extentLock);
+    return rc;
+}
+
+/* The table stays loaded for the other handles and later opens */
+static RC compressedClose(SM_FileHandle *fHandle) {
+    return compressedSync(fHandle, 0, 0);
+}
+
+/*
+ * Extents are not stored in page order, so access patterns apply to the
+ * whole file; range hints go to each stretch of adjacent extents.
+ */
+static RC compressedAdvise(SM_FileHandle *fHandle, PageNumber pageNum, PageNumber count, SM_Advice advice) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (advice != SM_ADVICE_WILLNEED && advice != SM_ADVICE_DONTNEED) {
+        adviseDescriptor(mgmt->fd, 0, 0, advice);
+        return RC_OK;
+    }
+
+    PageNumber p = pageNum;
+    PageNumber end = pageNum + count;
+    pthread_mutex_lock(&mgmt->shared->extentLock);
+    while (p < end) {
+        const CP_Extent *ext = &mgmt->shared->extents[p++];
+        if (ext->length == 0)
+            continue;
+        int64_t runEnd = ext->offset + ext->capacity;
+        while (p < end && mgmt->shared->extents[p].length > 0 && mgmt->shared->extents[p].offset == runEnd)
+            runEnd += mgmt->shared->extents[p++].capacity;
+        adviseDescriptor(mgmt->fd, (off_t) ext->offset, (off_t) (runEnd - ext->offset), advice);
+    }
+    pthread_mutex_unlock(&mgmt->shared->extentLock);
+    return RC_OK;
+}
+
+static const SM_Backend compressedBackend = {
+    compressedOpen, compressedClose, compressedRead, compressedWrite, compressedResize,
+    compressedSync, NULL, compressedAdvise
+};
+
+/* SM_IO_MEMORY: pages kept in process memory, registered by file name */
+
+static SM_MemFile *memFiles = NULL;
+static pthread_mutex_t memFilesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Finds a live in-memory file; the caller holds memFilesLock */
+static SM_MemFile *findMemFile(const char *fileName) {
+    for (SM_MemFile *file = memFiles; file != NULL; file = file->next) {
+        if (strcmp(file->name, fileName) == 0)
+            return file;
+    }
+    return NULL;
+}
+
+static void freeMemFile(SM_MemFile *file) {
+    for (PageNumber c = 0; c < file->numChunks; c++)
+        free(dirEntry(&file->chunks, c));
+    freeDirBlocks(&file->chunks);
+    destroySharedFile(&file->shared);
+    free(file->name);
+    free(file);
+}
+
+/* Takes a file out of the registry; it is freed once no handle is open on it */
+static void unlinkMemFile(SM_MemFile *file) {
+    SM_MemFile **link = &memFiles;
+    while (*link != file)
+        link = &(*link)->next;
+    *link = file->next;
+    if (file->openCount == 0)
+        freeMemFile(file);
+    else
+        file->destroyed = 1;
+}
+
+/* Allocates chunks until numPages pages exist; the caller holds memFilesLock */
+static RC growMemFile(SM_MemFile *file, PageNumber numPages) {
+    PageNumber needed = (numPages + MEM_CHUNK_PAGES - 1) / MEM_CHUNK_PAGES;
+    while (file->numChunks < needed) {
+        char *chunk = (char *) calloc(MEM_CHUNK_PAGES, (size_t) file->pageSize);
+        if (chunk == NULL)
+            return RC_MALLOC_FAILED;
+        if (setDirEntry(&file->chunks, file->numChunks, chunk) != RC_OK) {
+            free(chunk);
+            return RC_MALLOC_FAILED;
+        }
+        file->numChunks++;
+    }
+    return RC_OK;
+}
+
+static char *memPageAddress(const SM_MemFile *file, PageNumber pageNum) {
+    return dirEntry(&file->chunks, pageNum / MEM_CHUNK_PAGES)
+           + (size_t) (pageNum % MEM_CHUNK_PAGES) * (size_t) file->pageSize;
+}
+
+/*
+ * Creates (or empties) the in-memory file fileName with one zero page.
+ * A file of that name still open elsewhere keeps its old pages until closed.
+ */
+static RC createMemFile(const char *fileName, int pageSize) {
+    SM_MemFile *file = (SM_MemFile *) calloc(1, sizeof(SM_MemFile));
+    if (file == NULL)
+        return RC_MALLOC_FAILED;
+    file->name = strdup(fileName);
+    file->pageSize = pageSize;
+    initSharedFile(&file->shared, 1);
+
+    pthread_mutex_lock(&memFilesLock);
+    RC rc = (file->name == NULL) ? RC_MALLOC_FAILED : growMemFile(file, 1);
+    if (rc != RC_OK) {
+        pthread_mutex_unlock(&memFilesLock);
+        freeMemFile(file);
+        return rc;
+    }
+    SM_MemFile *old = findMemFile(fileName);
+    if (old != NULL)
+        unlinkMemFile(old);
+    file->next = memFiles;
+    memFiles = file;
+    pthread_mutex_unlock(&memFilesLock);
+    return RC_OK;
+}
+
+/* Page size of the in-memory file fileName, or 0 if there is none */
+static int memFilePageSize(const char *fileName) {
+    pthread_mutex_lock(&memFilesLock);
+    SM_MemFile *file = findMemFile(fileName);
+    int pageSize = (file != NULL) ? file->pageSize : 0;
+    pthread_mutex_unlock(&memFilesLock);
+    return pageSize;
+}
+
+/* Removes the in-memory file fileName; returns 0 if there is none */
+static int destroyMemFile(const char *fileName) {
+    pthread_mutex_lock(&memFilesLock);
+    SM_MemFile *file = findMemFile(fileName);
+    if (file != NULL)
+        unlinkMemFile(file);
+    pthread_mutex_unlock(&memFilesLock);
+    return file != NULL;
+}
+
+static RC memoryOpen(SM_FileHandle *fHandle, const char *fileName) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    pthread_mutex_lock(&memFilesLock);
+    SM_MemFile *file = findMemFile(fileName);
+    if (file != NULL) {
+        file->openCount++;
+        mgmt->memFile = file;
+        mgmt->shared = &file->shared;
+        mgmt->pageSize = file->pageSize;
+        fHandle->pageSize = file->pageSize;
+        fHandle->totalNumPages = __atomic_load_n(&file->shared.numPages, __ATOMIC_ACQUIRE);
+    }
+    pthread_mutex_unlock(&memFilesLock);
+    return file != NULL ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+static RC memoryClose(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_MemFile *file = mgmt->memFile;
+    pthread_mutex_lock(&memFilesLock);
+    if (--file->openCount == 0 && file->destroyed)
+        freeMemFile(file);
+    pthread_mutex_unlock(&memFilesLock);
+    return RC_OK;
+}
+
+static RC memoryRead(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    for (int i = 0; i < count; i++) {
+        char *src = memPageAddress(mgmt->memFile, pageNum + i);
+        if (src != bufs[i])
+            memcpy(bufs[i], src, (size_t) mgmt->pageSize);
+    }
+    return RC_OK;
+}
+
+static RC memoryWrite(SM_FileHandle *fHandle, PageNumber pageNum, int count, SM_PageHandle bufs[]) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    for (int i = 0; i < count; i++) {
+        char *dst = memPageAddress(mgmt->memFile, pageNum + i);
+        if (dst != bufs[i])
+            memcpy(dst, bufs[i], (size_t) mgmt->pageSize);
+    }
+    return RC_OK;
+}
+
+/*
+ * Chunks are never freed while the file exists, so pointers into them
+ * stay valid; pages dropped by a shrink are zeroed for later regrowth.
+ */
+static RC memoryResize(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_MemFile *file = mgmt->memFile;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&memFilesLock);
+    if (newNumPages > file->shared.numPages)
+        rc = growMemFile(file, newNumPages);
+    else {
+        for (PageNumber p = newNumPages; p < file->shared.numPages; p++)
+            memset(memPageAddress(file, p), 0, (size_t) file->pageSize);
+    }
+    pthread_mutex_unlock(&memFilesLock);
+    return rc;
+}
+
+static char *memoryPagePointer(SM_FileHandle *fHandle, PageNumber pageNum) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return memPageAddress(mgmt->memFile, pageNum);
+}
+
+static const SM_Backend memoryBackend = {
+    memoryOpen, memoryClose, memoryRead, memoryWrite, memoryResize, syncNothing,
+    memoryPagePointer, adviseNothing
+};
+
+/* Backend of every I/O mode, indexed by SM_IOMode */
+static const SM_Backend *const backends[] = {
+    [SM_IO_STDIO] = &stdioBackend,
+    [SM_IO_POSITIONAL] = &positionalBackend,
+    [SM_IO_MMAP] = &mmapBackend,
+    [SM_IO_DIRECT] = &directBackend,
+    [SM_IO_COMPRESSED] = &compressedBackend,
+    [SM_IO_MEMORY] = &memoryBackend
+};
+
+#define NUM_BACKENDS ((int) (sizeof(backends) / sizeof(backends[0])))
+
+/*
+ * Size of the file counting pages added through any handle; this
+ * handle's totalNumPages may be behind it. The caller holds the shared lock.
+ */
+static PageNumber sharedNumPages(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    PageNumber numPages = mgmt->shared->numPages;
+    return numPages > fHandle->totalNumPages ? numPages : fHandle->totalNumPages;
+}
+
+/*
+ * Resizes the file and records the new size for this handle, the other
+ * handles and the next open. The caller holds the shared lock.
+ */
+static RC resizeFile(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    RC rc = mgmt->ops->resize(fHandle, newNumPages);
+    if (rc != RC_OK)
+        return rc;
+    SET_NUM_PAGES(fHandle, newNumPages);
+    __atomic_store_n(&mgmt->shared->numPages, newNumPages, __ATOMIC_RELEASE);
+    return RC_OK;
+}
+
+/*
+ * Grows the file to newNumPages pages of zeros. If another handle has
+ * grown it further already, this handle catches up to that size instead
+ * of cutting the other handle's pages off.
+ */
+static RC growFile(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (newNumPages <= NUM_PAGES(fHandle))
+        return RC_OK;
+
+    pthread_mutex_lock(&mgmt->shared->lock);
+    PageNumber numPages = sharedNumPages(fHandle);
+    RC rc = resizeFile(fHandle, newNumPages > numPages ? newNumPages : numPages);
+    if (rc == RC_OK && newNumPages > numPages)
+        __atomic_add_fetch(&mgmt->stats.extensions, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&mgmt->shared->lock);
+    return rc;
+}
+
+/*
+ * Adds one zero page after the last page of the file, whichever handle
+ * added that. The caller holds the shared lock.
+ */
+static RC appendPage(SM_FileHandle *fHandle, PageNumber *pageNum) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    PageNumber numPages = sharedNumPages(fHandle);
+    RC rc = resizeFile(fHandle, numPages + 1);
+    if (rc == RC_OK) {
+        __atomic_add_fetch(&mgmt->stats.extensions, 1, __ATOMIC_RELAXED);
+        *pageNum = numPages;
+    }
+    return rc;
+}
+
+/*
+ * Cuts the file back to newNumPages pages (used when trailing pages are
+ * freed). The caller holds the shared lock.
+ */
+static RC shrinkFile(SM_FileHandle *fHandle, PageNumber newNumPages) {
+    RC rc = resizeFile(fHandle, newNumPages);
+    if (rc != RC_OK)
+        return rc;
+    if (getBlockPos(fHandle) >= newNumPages)
+        SET_PAGE_POS(fHandle, newNumPages > 0 ? newNumPages - 1 : 0);
+    return RC_OK;
+}
+
+/* --- I/O statistics helpers --- */
+
+static int64_t nowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Start of a timed read or write call, or 0 while latency timing is off */
+static int64_t startTiming(void) {
+    return __atomic_load_n(&ioTiming, __ATOMIC_RELAXED) ? nowNanos() : 0;
+}
+
+/* Histogram bucket of a duration: floor(log2(nanos)), the last bucket open-ended */
+static int latencyBucket(int64_t nanos) {
+    int bucket = 63 - __builtin_clzll((unsigned long long) (nanos | 1));
+    return bucket < SM_LATENCY_BUCKETS ? bucket : SM_LATENCY_BUCKETS - 1;
+}
+
+/*
+ * Counts one completed read or write call of numPages pages that took
+ * nanos, or was not timed when nanos is negative. Byte counts follow
+ * from the page counts when the stats are read.
+ */
+static void countIO(SM_FileMgmt *mgmt, int isWrite, int numPages, int64_t nanos) {
+    SM_IOStats *stats = &mgmt->stats;
+    __atomic_add_fetch(isWrite ? &stats->writes : &stats->reads, numPages, __ATOMIC_RELAXED);
+    if (nanos >= 0) {
+        int64_t *histogram = isWrite ? stats->writeLatency : stats->readLatency;
+        __atomic_add_fetch(&histogram[latencyBucket(nanos)], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* Duration of a call begun at start (from startTiming), or -1 if it was not timed */
+static int64_t elapsedSince(int64_t start) {
+    return start != 0 ? nowNanos() - start : -1;
+}
+
+/* Smallest bucket bound (in nanoseconds) at or below which a fraction of the calls finished */
+static int64_t latencyPercentile(const int64_t histogram[], double fraction) {
+    int64_t total = 0;
+    for (int b = 0; b < SM_LATENCY_BUCKETS; b++)
+        total += histogram[b];
+    if (total == 0)
+        return 0;
+    int64_t seen = 0;
+    for (int b = 0; b < SM_LATENCY_BUCKETS; b++) {
+        seen += histogram[b];
+        if ((double) seen >= fraction * (double) total)
+            return (int64_t) 1 << (b + 1);
+    }
+    return (int64_t) 1 << SM_LATENCY_BUCKETS;
+}
+
+/* --- Durability --- */
+
+/* Flushes a descriptor's data (and the metadata needed to read it) to stable storage */
+static int syncDescriptor(int fd) {
+#if defined(__APPLE__)
+    /* fsync alone leaves data in the drive cache on macOS */
+    if (fcntl(fd, F_FULLFSYNC) == 0)
+        return 0;
+    return fsync(fd);
+#else
+    int result;
+    while ((result = fdatasync(fd)) != 0 && errno == EINTR)
+        ;
+    return result;
+#endif
+}
+
+/* Makes every write so far to the file and its free-page map durable */
+static RC syncFileData(SM_FileMgmt *mgmt) {
+    int fd = (mgmt->mode == SM_IO_STDIO) ? fileno(mgmt->fp) : mgmt->fd;
+    if (syncDescriptor(fd) != 0)
+        return RC_WRITE_FAILED;
+    pthread_mutex_lock(&mgmt->shared->lock);
+    int fsmFd = mgmt->shared->fsmFd;
+    pthread_mutex_unlock(&mgmt->shared->lock);
+    if (fsmFd >= 0 && syncDescriptor(fsmFd) != 0)
+        return RC_WRITE_FAILED;
+    __atomic_add_fetch(&mgmt->stats.syncs, 1, __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/* Monotonic clock in microseconds */
+static int64_t nowMicros(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Group commit. The first force to find no sync under way leads: it
+ * waits out what is left of the interval since the previous sync, then
+ * issues one sync covering every force that arrived meanwhile. The
+ * others sleep until a sync that began after they arrived has finished.
+ */
+static RC groupCommit(SM_FileMgmt *mgmt) {
+    SM_SyncGroup *group = &mgmt->shared->group;
+    pthread_mutex_lock(&group->lock);
+    uint64_t ticket = ++group->requested;
+    while (group->synced < ticket && group->error == RC_OK) {
+        if (group->leading) {
+            pthread_cond_wait(&group->done, &group->lock);
+            continue;
+        }
+        group->leading = 1;
+        int64_t wait = group->lastSync + mgmt->groupIntervalUs - nowMicros();
+        pthread_mutex_unlock(&group->lock);
+        if (wait > 0) {
+            struct timespec ts = { (time_t) (wait / 1000000), (long) (wait % 1000000) * 1000 };
+            while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+                ;
+        }
+
+        pthread_mutex_lock(&group->lock);
+        uint64_t covered = group->requested;
+        pthread_mutex_unlock(&group->lock);
+        RC rc = syncFileData(mgmt);
+        pthread_mutex_lock(&group->lock);
+
+        group->lastSync = nowMicros();
+        if (rc == RC_OK)
+            group->synced = covered;
+        else
+            group->error = rc;
+        group->leading = 0;
+        pthread_cond_broadcast(&group->done);
+    }
+    RC rc = (group->synced >= ticket) ? RC_OK : group->error;
+    pthread_mutex_unlock(&group->lock);
+    return rc;
+}
+
+/* Makes a force durable as the file's durability mode asks */
+static RC applyDurability(SM_FileMgmt *mgmt) {
+    /* In-memory files have nothing to make durable */
+    if (mgmt->mode == SM_IO_MEMORY)
+        return RC_OK;
+    if (mgmt->durability == SM_DURABILITY_SYNC_ON_FORCE)
+        return syncFileData(mgmt);
+    if (mgmt->durability == SM_DURABILITY_GROUP_COMMIT)
+        return groupCommit(mgmt);
+    return RC_OK;
+}
+
+/* --- Free-page map helpers --- */
+
+#define FSM_BIT(shared, p)  (((shared)->freeMap[(p) >> 3] >> ((p) & 7)) & 1)
+
+/* Builds "<fileName>.fsm" */
+static char *fsmNameFor(const char *fileName) {
+    size_t len = strlen(fileName);
+    char *name = (char *) malloc(len + sizeof(FSM_SUFFIX));
+    if (name != NULL) {
+        memcpy(name, fileName, len);
+        memcpy(name + len, FSM_SUFFIX, sizeof(FSM_SUFFIX));
+    }
+    return name;
+}
+
+/* Grows the in-memory bitmap to cover numPages pages; the caller holds the shared lock */
+static RC growFreeMap(SM_SharedFile *shared, PageNumber numPages) {
+    if (numPages <= shared->freeMapPages)
+        return RC_OK;
+    size_t oldBytes = (size_t) ((shared->freeMapPages + 7) / 8);
+    size_t newBytes = (size_t) ((numPages + 7) / 8);
+    uint8_t *map = (uint8_t *) realloc(shared->freeMap, newBytes);
+    if (map == NULL)
+        return RC_MALLOC_FAILED;
+    memset(map + oldBytes, 0, newBytes - oldBytes);
+    shared->freeMap = map;
+    shared->freeMapPages = numPages;
+    return RC_OK;
+}
+
+/*
+ * Loads the fork, if the file has one, into the shared entry the first
+ * time the file is opened. Bits for pages past end of file (e.g. after
+ * an external truncate) are dropped. In-memory files have no fork; their
+ * bitmap lives in the SM_MemFile. The caller holds the shared lock.
+ */
+static RC loadFreeMap(SM_FileMgmt *mgmt) {
+    SM_SharedFile *shared = mgmt->shared;
+    if (shared->freeMapLoaded || mgmt->memFile != NULL)
+        return RC_OK;
+    shared->freeMapLoaded = 1;
+    shared->fsmFd = open(mgmt->fsmName, O_RDWR);
+    if (shared->fsmFd < 0)
+        return RC_OK;
+
+    FSM_Header header;
+    if (preadFull(shared->fsmFd, (char *) &header, sizeof(header), 0) != RC_OK ||
+        memcmp(header.magic, FSM_MAGIC, sizeof(header.magic)) != 0)
+        return RC_OK;     /* Not a map we wrote; it is rewritten on the next free */
+
+    PageNumber numPages = header.numPages < shared->numPages ? header.numPages : shared->numPages;
+    RC rc = growFreeMap(shared, numPages);
+    if (rc != RC_OK)
+        return rc;
+    if (numPages > 0)
+        preadFull(shared->fsmFd, (char *) shared->freeMap, (size_t) ((numPages + 7) / 8), PAGE_SIZE);
+
+    /* Clear stray bits in the last byte, then count */
+    for (PageNumber p = numPages; p < (numPages + 7) / 8 * 8; p++)
+        shared->freeMap[p >> 3] &= (uint8_t) ~(1u << (p & 7));
+    shared->numFree = 0;
+    shared->freeHint = numPages;
+    for (size_t i = 0; i < (size_t) ((numPages + 7) / 8); i++) {
+        if (shared->freeMap[i] == 0)
+            continue;
+        if (shared->freeHint == numPages)
+            shared->freeHint = (PageNumber) i * 8;
+        shared->numFree += __builtin_popcount(shared->freeMap[i]);
+    }
+    return RC_OK;
+}
+
+/*
+ * Writes the header and the bitmap bytes covering pages [from, to) to
+ * the fork. The caller holds the shared lock.
+ */
+static RC saveFreeMap(SM_FileMgmt *mgmt, PageNumber from, PageNumber to) {
+    SM_SharedFile *shared = mgmt->shared;
+    if (mgmt->memFile != NULL)
+        return RC_OK;
+    if (shared->fsmFd < 0) {
+        shared->fsmFd = open(mgmt->fsmName, O_RDWR | O_CREAT, 0644);
+        if (shared->fsmFd < 0)
+            return RC_WRITE_FAILED;
+        from = 0;
+        to = shared->freeMapPages;
+    }
+
+    FSM_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FSM_MAGIC, sizeof(header.magic));
+    header.numPages = shared->freeMapPages;
+    header.numFree = shared->numFree;
+    RC rc = pwriteFull(shared->fsmFd, (const char *) &header, sizeof(header), 0);
+    if (rc != RC_OK || from >= to)
+        return rc;
+
+    size_t firstByte = (size_t) (from / 8);
+    size_t lastByte = (size_t) ((to - 1) / 8);
+    return pwriteFull(shared->fsmFd, (const char *) shared->freeMap + firstByte,
+                      lastByte - firstByte + 1, PAGE_SIZE + (off_t) firstByte);
+}
 
 /*
  * Initializes the Storage Manager.
@@ -18,49 +1975,318 @@ void initStorageManager(void) {
 }
 
 /*
- * Creates a new page file with one empty page.
+ * Selects the I/O backend used by subsequent openPageFile calls.
+ */
+void setStorageIOMode(SM_IOMode mode) {
+    defaultIOMode = mode;
+}
+
+/*
+ * Returns the I/O backend used by openPageFile.
+ */
+SM_IOMode getStorageIOMode(void) {
+    return defaultIOMode;
+}
+
+/*
+ * Selects the page size of files created by createPageFile.
+ */
+RC setStoragePageSize(int pageSize) {
+    if (!isValidPageSize(pageSize))
+        return RC_PARAMS_ERROR;
+    defaultPageSize = pageSize;
+    return RC_OK;
+}
+
+/*
+ * Returns the page size createPageFile gives new files.
+ */
+int getStoragePageSize(void) {
+    return defaultPageSize;
+}
+
+/*
+ * Creates a new page file with one empty page, using the default page size.
  */
 RC createPageFile(char *fileName) {
+    return createPageFileWithPageSize(fileName, defaultPageSize);
+}
+
+/*
+ * Creates a new page file with one empty page of pageSize bytes, after a
+ * header page recording the size. While the default mode is
+ * SM_IO_COMPRESSED the file is a compressed one: a header page whose
+ * single logical page is a zero page taking no space. While it is
+ * SM_IO_MEMORY the file is created in memory instead of on disk.
+ */
+RC createPageFileWithPageSize(char *fileName, int pageSize) {
     if (fileName == NULL)
         return RC_FILE_NOT_FOUND;
+    if (!isValidPageSize(pageSize))
+        return RC_PARAMS_ERROR;
+    if (defaultIOMode == SM_IO_MEMORY)
+        return createMemFile(fileName, pageSize);
 
-    FILE *fp = fopen(fileName, "w+");
-    if (fp == NULL)
+    int compressed = (defaultIOMode == SM_IO_COMPRESSED);
+    size_t fileSize = (size_t) pageSize * (compressed ? 1 : 2);
+    char *pages = (char *) calloc(fileSize, sizeof(char));
+    if (!pages)
+        return RC_MALLOC_FAILED;
+
+    if (compressed) {
+        CP_Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CP_MAGIC, sizeof(header.magic));
+        header.numPages = 1;
+        header.dataEnd = pageSize;
+        header.pageSize = pageSize;
+        memcpy(pages, &header, sizeof(header));
+    } else {
+        SM_FileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+        header.version = SM_FILE_VERSION;
+        header.pageSize = pageSize;
+        memcpy(pages, &header, sizeof(header));
+    }
+
+    /* The new file replaces any cached one of that name, and is cached in turn */
+    forgetCachedFile(fileName);
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        free(pages);
         return RC_FILE_NOT_FOUND;
+    }
+    RC rc = pwriteFull(fd, pages, fileSize, 0);
+    free(pages);
+    if (rc != RC_OK) {
+        close(fd);
+        return RC_WRITE_FAILED;
+    }
+    pthread_mutex_lock(&fileCacheLock);
+    if (fileCacheBudget > 0)
+        insertCachedFile(fileName, fd, compressed ? SM_FORMAT_COMPRESSED : SM_FORMAT_PAGED, pageSize, 1, 0);
+    else
+        close(fd);
+    pthread_mutex_unlock(&fileCacheLock);
 
-    char *emptyPage = (char *) calloc(PAGE_SIZE, sizeof(char));
-    if (!emptyPage) {
-        fclose(fp);
-        return RC_MALLOC_FAILED;
+    /* A free-page map left by an earlier file of this name no longer applies */
+    char *fsmName = fsmNameFor(fileName);
+    if (fsmName != NULL) {
+        unlink(fsmName);
+        free(fsmName);
     }
+    return RC_OK;
+}
+
+/*
+ * Selects the growth policy given to subsequently opened files.
+ */
+void setStorageGrowthPolicy(SM_GrowthPolicy policy, int amount) {
+    defaultGrowth = policy;
+    defaultGrowthAmount = amount;
+}
+
+/*
+ * Changes the growth policy of one open file.
+ */
+RC setFileGrowthPolicy(SM_FileHandle *fHandle, SM_GrowthPolicy policy, int amount) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (amount < 0)
+        return RC_PARAMS_ERROR;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    mgmt->growth = policy;
+    mgmt->growthAmount = amount;
+    return RC_OK;
+}
+
+/*
+ * Returns how many pages the file can reach before it reserves more space.
+ */
+PageNumber getReservedPages(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    pthread_mutex_lock(&mgmt->shared->lock);
+    PageNumber reserved = mgmt->shared->reservedPages;
+    pthread_mutex_unlock(&mgmt->shared->lock);
+    PageNumber numPages = NUM_PAGES(fHandle);
+    return reserved > numPages ? reserved : numPages;
+}
+
+/*
+ * Selects the durability mode given to subsequently opened files.
+ */
+void setStorageDurability(SM_Durability mode, int groupIntervalUs) {
+    defaultDurability = mode;
+    defaultGroupIntervalUs = groupIntervalUs;
+}
+
+/*
+ * Changes the durability mode of one open file. groupIntervalUs is the
+ * shortest time between two syncs in SM_DURABILITY_GROUP_COMMIT mode.
+ */
+RC setFileDurability(SM_FileHandle *fHandle, SM_Durability mode, int groupIntervalUs) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (mode < SM_DURABILITY_NONE || mode > SM_DURABILITY_GROUP_COMMIT || groupIntervalUs < 0)
+        return RC_PARAMS_ERROR;
 
-    fwrite(emptyPage, sizeof(char), PAGE_SIZE, fp);
-    fclose(fp);
-    free(emptyPage);
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    mgmt->durability = mode;
+    mgmt->groupIntervalUs = groupIntervalUs;
     return RC_OK;
 }
 
 /*
- * Opens an existing page file and populates the file handle.
+ * Returns the durability mode of an open file.
+ */
+SM_Durability getFileDurability(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return mgmt->durability;
+}
+
+/*
+ * Returns how many syncs have been issued on an open file.
+ */
+int64_t getFileSyncCount(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return __atomic_load_n(&mgmt->stats.syncs, __ATOMIC_RELAXED);
+}
+
+/*
+ * Sets how many descriptors the open-file cache may hold. Idle ones past
+ * the budget are closed at once; 0 closes every file on its last close.
+ */
+void setFileCacheBudget(int maxOpenFiles) {
+    pthread_mutex_lock(&fileCacheLock);
+    fileCacheBudget = maxOpenFiles > 0 ? maxOpenFiles : 0;
+    trimFileCache(fileCacheBudget);
+    pthread_mutex_unlock(&fileCacheLock);
+}
+
+/*
+ * Returns the descriptor budget of the open-file cache.
+ */
+int getFileCacheBudget(void) {
+    pthread_mutex_lock(&fileCacheLock);
+    int budget = fileCacheBudget;
+    pthread_mutex_unlock(&fileCacheLock);
+    return budget;
+}
+
+/*
+ * Closes every cached descriptor no handle is using, e.g. before the
+ * files are changed by something other than the storage manager.
+ */
+void flushFileCache(void) {
+    pthread_mutex_lock(&fileCacheLock);
+    trimFileCache(0);
+    pthread_mutex_unlock(&fileCacheLock);
+}
+
+/*
+ * Copies the open-file cache counters into stats.
+ */
+void getFileCacheStats(SM_FileCacheStats *stats) {
+    if (stats == NULL)
+        return;
+    pthread_mutex_lock(&fileCacheLock);
+    *stats = fileCacheStats;
+    stats->openFiles = numCachedFiles;
+    pthread_mutex_unlock(&fileCacheLock);
+}
+
+/*
+ * Opens an existing page file and populates the file handle,
+ * using the default I/O mode.
  */
 RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
+    return openPageFileWithMode(fileName, fHandle, defaultIOMode);
+}
+
+/*
+ * Opens an existing page file with an explicit I/O backend.
+ * In-memory files are found by name and always open in SM_IO_MEMORY.
+ * On disk, the file's header decides the page size and whether it is
+ * compressed; modes meant for other kinds of file fall back to
+ * positional I/O. Header and size come from the open-file cache when
+ * the file is already in it.
+ */
+RC openPageFileWithMode(char *fileName, SM_FileHandle *fHandle, SM_IOMode mode) {
     if (fileName == NULL || fHandle == NULL)
         return RC_FILE_NOT_FOUND;
 
-    FILE *fp = fopen(fileName, "r+");
-    if (fp == NULL)
-        return RC_FILE_NOT_FOUND;
+    SM_FileFormat format = SM_FORMAT_MEMORY;
+    SM_CachedFile *cached = NULL;
+    int pageSize = memFilePageSize(fileName);
+    RC rc = RC_OK;
+    if (pageSize != 0)
+        mode = SM_IO_MEMORY;
+    else {
+        rc = acquireCachedFile(fileName, &cached);
+        if (rc != RC_OK)
+            return rc;
+        format = cached->format;
+        pageSize = cached->pageSize;
+        if (format == SM_FORMAT_COMPRESSED)
+            mode = SM_IO_COMPRESSED;
+        else if (mode == SM_IO_COMPRESSED || mode == SM_IO_MEMORY ||
+                 (int) mode < 0 || (int) mode >= NUM_BACKENDS)
+            mode = SM_IO_POSITIONAL;
+    }
 
-    if (fseek(fp, 0, SEEK_END) != 0) {
-        fclose(fp);
-        return RC_READ_NON_EXISTING_PAGE;
+    SM_FileMgmt *mgmt = (SM_FileMgmt *) calloc(1, sizeof(SM_FileMgmt));
+    if (mgmt == NULL) {
+        if (cached != NULL)
+            releaseCachedFile(cached);
+        return RC_MALLOC_FAILED;
     }
+    mgmt->mode = mode;
+    mgmt->cached = cached;
+    mgmt->shared = (cached != NULL) ? &cached->shared : NULL;
+    mgmt->ops = backends[mode];
+    mgmt->pageSize = pageSize;
+    mgmt->dataStart = (format == SM_FORMAT_PAGED) ? pageSize : 0;
+    mgmt->fd = -1;
+    mgmt->growth = defaultGrowth;
+    mgmt->growthAmount = defaultGrowthAmount;
+    mgmt->durability = defaultDurability;
+    mgmt->groupIntervalUs = defaultGroupIntervalUs;
+    pthread_mutex_init(&mgmt->ioLock, NULL);
 
-    fHandle->mgmtInfo = fp;
+    fHandle->mgmtInfo = mgmt;
     fHandle->fileName = fileName;
     fHandle->curPagePos = 0;
-    long fileSize = ftell(fp);
-    fHandle->totalNumPages = (int)(fileSize / PAGE_SIZE);
+    fHandle->pageSize = pageSize;
+    fHandle->totalNumPages = 0;
+    rc = mgmt->ops->open(fHandle, fileName);
+    if (rc == RC_OK) {
+        pthread_mutex_lock(&mgmt->shared->lock);
+        mgmt->shared->numHandles++;
+        pthread_mutex_unlock(&mgmt->shared->lock);
+    }
+    if (rc != RC_OK) {
+        pthread_mutex_destroy(&mgmt->ioLock);
+        if (cached != NULL)
+            releaseCachedFile(cached);
+        free(mgmt);
+        fHandle->mgmtInfo = NULL;
+        return rc;
+    }
+
+    /* In-memory files keep their free-page map in memory too */
+    if (format != SM_FORMAT_MEMORY && (mgmt->fsmName = fsmNameFor(fileName)) == NULL)
+        rc = RC_MALLOC_FAILED;
+    if (rc == RC_OK) {
+        pthread_mutex_lock(&mgmt->shared->lock);
+        rc = loadFreeMap(mgmt);
+        pthread_mutex_unlock(&mgmt->shared->lock);
+    }
+    if (rc != RC_OK) {
+        closePageFile(fHandle);
+        return rc;
+    }
     return RC_OK;
 }
 
@@ -68,55 +2294,85 @@ RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
  * Closes an open page file.
  */
 RC closePageFile(SM_FileHandle *fHandle) {
-    if (fHandle == NULL)
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
 
-    FILE *fp = fHandle->mgmtInfo;
-    fclose(fp);
-    return RC_OK;
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    pthread_mutex_lock(&mgmt->shared->lock);
+    mgmt->shared->numHandles--;
+    pthread_mutex_unlock(&mgmt->shared->lock);
+    RC rc = mgmt->ops->close(fHandle);
+    free(mgmt->fsmName);
+    pthread_mutex_destroy(&mgmt->ioLock);
+    if (mgmt->cached != NULL)
+        releaseCachedFile(mgmt->cached);
+    free(mgmt);
+    fHandle->mgmtInfo = NULL;
+    return rc;
 }
 
 /*
- * Destroys (deletes) a page file.
+ * Destroys (deletes) a page file, in memory or on disk.
  */
 RC destroyPageFile(char *fileName) {
     if (fileName == NULL)
         return RC_FILE_NOT_FOUND;
+    if (destroyMemFile(fileName))
+        return RC_OK;
+    forgetCachedFile(fileName);
     if (remove(fileName) != 0)
         return RC_FILE_NOT_FOUND;
+
+    char *fsmName = fsmNameFor(fileName);
+    if (fsmName != NULL) {
+        unlink(fsmName);
+        free(fsmName);
+    }
     return RC_OK;
 }
 
+/*
+ * Tells whether a page file of this name exists, in memory or on disk.
+ */
+int pageFileExists(char *fileName) {
+    if (fileName == NULL)
+        return 0;
+    return memFilePageSize(fileName) != 0 || isFileCached(fileName) || access(fileName, F_OK) == 0;
+}
+
 /*
  * Reads the specified page from the file into memPage.
+ * In positional mode this is a single pread and is safe to call from
+ * several threads on the same handle.
  */
-RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+RC readBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     if (fHandle == NULL || memPage == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
 
-    if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+    if (pageNum < 0 || pageNum >= NUM_PAGES(fHandle))
         return RC_READ_NON_EXISTING_PAGE;
 
-    FILE *fp = fHandle->mgmtInfo;
-    if (fp == NULL)
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (mgmt == NULL)
         return RC_FILE_NOT_FOUND;
 
-    int offset = pageNum * PAGE_SIZE;
-    if (fseek(fp, offset, SEEK_SET) != 0)
-        return RC_READ_NON_EXISTING_PAGE;
+    int64_t start = startTiming();
+    RC rc = mgmt->ops->read(fHandle, pageNum, 1, &memPage);
+    if (rc != RC_OK)
+        return rc;
+    countIO(mgmt, 0, 1, elapsedSince(start));
 
-    fread(memPage, sizeof(char), PAGE_SIZE, fp);
-    fHandle->curPagePos = pageNum;
+    SET_PAGE_POS(fHandle, pageNum);
     return RC_OK;
 }
 
 /*
  * Returns the current page position.
  */
-int getBlockPos(SM_FileHandle *fHandle) {
+PageNumber getBlockPos(SM_FileHandle *fHandle) {
     if (fHandle == NULL)
         return -1;
-    return fHandle->curPagePos;
+    return __atomic_load_n(&fHandle->curPagePos, __ATOMIC_RELAXED);
 }
 
 /*
@@ -130,7 +2386,7 @@ RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
  * Reads the previous block relative to the current page position.
  */
 RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    int pageNum = getBlockPos(fHandle);
+    PageNumber pageNum = getBlockPos(fHandle);
     if (pageNum <= 0)
         return RC_READ_NON_EXISTING_PAGE;
     return readBlock(pageNum - 1, fHandle, memPage);
@@ -140,7 +2396,7 @@ RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
  * Reads the current block.
  */
 RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    int pageNum = getBlockPos(fHandle);
+    PageNumber pageNum = getBlockPos(fHandle);
     if (pageNum < 0)
         return RC_FILE_HANDLE_NOT_INIT;
     return readBlock(pageNum, fHandle, memPage);
@@ -150,8 +2406,8 @@ RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
  * Reads the next block relative to the current page position.
  */
 RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    int pageNum = getBlockPos(fHandle);
-    if (pageNum < 0 || pageNum + 1 >= fHandle->totalNumPages)
+    PageNumber pageNum = getBlockPos(fHandle);
+    if (pageNum < 0 || pageNum + 1 >= NUM_PAGES(fHandle))
         return RC_READ_NON_EXISTING_PAGE;
     return readBlock(pageNum + 1, fHandle, memPage);
 }
@@ -162,31 +2418,30 @@ RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
 RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
     if (fHandle == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
-    int lastPage = fHandle->totalNumPages - 1;
+    PageNumber lastPage = NUM_PAGES(fHandle) - 1;
     return readBlock(lastPage, fHandle, memPage);
 }
 
 /*
  * Writes a specific page (block) from memPage to the file.
  */
-RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+RC writeBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     if (fHandle == NULL || memPage == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
-    if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+    if (pageNum < 0 || pageNum >= NUM_PAGES(fHandle))
         return RC_READ_NON_EXISTING_PAGE;
 
-    FILE *fp = fHandle->mgmtInfo;
-    if (fp == NULL)
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (mgmt == NULL)
         return RC_FILE_NOT_FOUND;
 
-    int offset = pageNum * PAGE_SIZE;
-    if (fseek(fp, offset, SEEK_SET) != 0)
-        return RC_READ_NON_EXISTING_PAGE;
+    int64_t start = startTiming();
+    RC rc = mgmt->ops->write(fHandle, pageNum, 1, &memPage);
+    if (rc != RC_OK)
+        return rc;
+    countIO(mgmt, 1, 1, elapsedSince(start));
 
-    /* Write the page content.
-       Note: Here we write PAGE_SIZE bytes; adjust if needed. */
-    fwrite(memPage, sizeof(char), PAGE_SIZE, fp);
-    fHandle->curPagePos = pageNum;
+    SET_PAGE_POS(fHandle, pageNum);
     return RC_OK;
 }
 
@@ -194,41 +2449,377 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
  * Writes the current block.
  */
 RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    int curPage = fHandle->curPagePos;
+    PageNumber curPage = getBlockPos(fHandle);
     return writeBlock(curPage, fHandle, memPage);
 }
 
+/* --- Vectored Multi-Page I/O --- */
+
+/*
+ * Reads count consecutive pages starting at startPage, page i into bufs[i].
+ * Descriptor-based files move the whole run with preadv; compressed files
+ * read adjacent extents together.
+ */
+RC readBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle bufs[]) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || bufs == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (startPage < 0 || count < 0 || startPage + count > NUM_PAGES(fHandle))
+        return RC_READ_NON_EXISTING_PAGE;
+    if (count == 0)
+        return RC_OK;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    int64_t start = startTiming();
+    RC rc = mgmt->ops->read(fHandle, startPage, count, bufs);
+    if (rc != RC_OK)
+        return rc;
+    countIO(mgmt, 0, count, elapsedSince(start));
+    SET_PAGE_POS(fHandle, startPage + count - 1);
+    return RC_OK;
+}
+
+/*
+ * Writes count consecutive pages starting at startPage, page i from bufs[i].
+ * Descriptor-based files move the whole run with pwritev.
+ */
+RC writeBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle bufs[]) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || bufs == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (startPage < 0 || count < 0 || startPage + count > NUM_PAGES(fHandle))
+        return RC_READ_NON_EXISTING_PAGE;
+    if (count == 0)
+        return RC_OK;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    int64_t start = startTiming();
+    RC rc = mgmt->ops->write(fHandle, startPage, count, bufs);
+    if (rc != RC_OK)
+        return rc;
+    countIO(mgmt, 1, count, elapsedSince(start));
+    SET_PAGE_POS(fHandle, startPage + count - 1);
+    return RC_OK;
+}
+
 /*
  * Appends an empty block (page) to the file.
  */
 RC appendEmptyBlock(SM_FileHandle *fHandle) {
-    FILE *fp = (FILE *) fHandle->mgmtInfo;
-    if (!fp)
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
-    char *emptyPage = calloc(PAGE_SIZE, sizeof(char));
-    if (!emptyPage)
-        return RC_MALLOC_FAILED;
-    fseek(fp, 0, SEEK_END);
-    fwrite(emptyPage, sizeof(char), PAGE_SIZE, fp);
-    free(emptyPage);
-    fHandle->totalNumPages++;
-    return RC_OK;
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    PageNumber pageNum;
+    pthread_mutex_lock(&mgmt->shared->lock);
+    RC rc = appendPage(fHandle, &pageNum);
+    pthread_mutex_unlock(&mgmt->shared->lock);
+    return rc;
 }
 
 /*
  * Ensures that the file has at least the specified number of pages.
  */
-RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
-    if (fHandle == NULL)
+RC ensureCapacity(PageNumber numberOfPages, SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
     if (numberOfPages < 1)
         return RC_READ_NON_EXISTING_PAGE;
 
-    int currentPages = fHandle->totalNumPages;
-    for (int i = 0; i < numberOfPages - currentPages; i++) {
-        appendEmptyBlock(fHandle);
-    }
-    if (fHandle->totalNumPages < numberOfPages)
+    RC rc = growFile(fHandle, numberOfPages);
+    if (rc != RC_OK)
+        return rc;
+    if (NUM_PAGES(fHandle) < numberOfPages)
         return RC_WRITE_FAILED;
     return RC_OK;
-}
\ No newline at end of file
+}
+
+/* --- Free-Page Map --- */
+
+/*
+ * Hands out a zero-filled page: the lowest free page if there is one,
+ * otherwise a page appended to the file. The map is shared by every
+ * handle on the file, so no two of them hand out the same page.
+ */
+RC allocatePage(SM_FileHandle *fHandle, PageNumber *pageNum) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || pageNum == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_SharedFile *shared = mgmt->shared;
+    pthread_mutex_lock(&shared->lock);
+    if (shared->numFree == 0) {
+        RC rc = appendPage(fHandle, pageNum);
+        pthread_mutex_unlock(&shared->lock);
+        return rc;
+    }
+
+    /* Skip whole zero bytes, then find the bit */
+    PageNumber p = shared->freeHint;
+    while (p < shared->freeMapPages && (p & 7) == 0 && shared->freeMap[p >> 3] == 0)
+        p += 8;
+    while (p < shared->freeMapPages && !FSM_BIT(shared, p)) {
+        p++;
+        while (p < shared->freeMapPages && (p & 7) == 0 && shared->freeMap[p >> 3] == 0)
+            p += 8;
+    }
+    RC rc = (p >= shared->freeMapPages) ? RC_ERROR : RC_OK;
+
+    /* Another handle may have freed a page this one has not seen yet */
+    if (rc == RC_OK && p >= fHandle->totalNumPages)
+        rc = resizeFile(fHandle, sharedNumPages(fHandle));
+
+    /* The old content must not leak into the new owner */
+    if (rc == RC_OK)
+        rc = writeBlock(p, fHandle, (SM_PageHandle) zeroPage);
+    if (rc == RC_OK) {
+        shared->freeMap[p >> 3] &= (uint8_t) ~(1u << (p & 7));
+        shared->numFree--;
+        shared->freeHint = p + 1;
+        *pageNum = p;
+        rc = saveFreeMap(mgmt, p, p + 1);
+    }
+    pthread_mutex_unlock(&shared->lock);
+    return rc;
+}
+
+/*
+ * Returns a page to the free-page map. If it leaves free pages at the
+ * end of the file, the file is truncated to drop them when that is safe.
+ */
+RC freePage(SM_FileHandle *fHandle, PageNumber pageNum) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum < 0 || pageNum >= NUM_PAGES(fHandle))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    SM_SharedFile *shared = mgmt->shared;
+    pthread_mutex_lock(&shared->lock);
+    PageNumber numPages = sharedNumPages(fHandle);
+    RC rc = growFreeMap(shared, numPages);
+    if (rc == RC_OK && FSM_BIT(shared, pageNum))
+        rc = RC_PAGE_ALREADY_FREE;
+    if (rc != RC_OK) {
+        pthread_mutex_unlock(&shared->lock);
+        return rc;
+    }
+
+    shared->freeMap[pageNum >> 3] |= (uint8_t) (1u << (pageNum & 7));
+    shared->numFree++;
+    if (pageNum < shared->freeHint)
+        shared->freeHint = pageNum;
+
+    /*
+     * Hand trailing free pages back to the file system. Only a handle
+     * alone on the file does: other handles still check against their
+     * old page count, and pages cut off a mapping fault on access, so a
+     * mapped or shared file keeps its trailing free pages in the map.
+     */
+    PageNumber newNumPages = numPages;
+    int mayShrink = (shared->numHandles == 1 && mgmt->mode != SM_IO_MMAP);
+    while (mayShrink && newNumPages > 0 && FSM_BIT(shared, newNumPages - 1)) {
+        newNumPages--;
+        shared->freeMap[newNumPages >> 3] &= (uint8_t) ~(1u << (newNumPages & 7));
+        shared->numFree--;
+    }
+    if (newNumPages < numPages)
+        rc = shrinkFile(fHandle, newNumPages);
+    if (rc == RC_OK)
+        rc = saveFreeMap(mgmt, pageNum < newNumPages ? pageNum : newNumPages, numPages);
+    pthread_mutex_unlock(&shared->lock);
+    return rc;
+}
+
+/*
+ * Returns the number of free pages waiting to be reused.
+ */
+PageNumber getFreePageCount(SM_FileHandle *fHandle) {
+    SM_SharedFile *shared = ((SM_FileMgmt *) fHandle->mgmtInfo)->shared;
+    pthread_mutex_lock(&shared->lock);
+    PageNumber numFree = shared->numFree;
+    pthread_mutex_unlock(&shared->lock);
+    return numFree;
+}
+
+/* --- Memory-Mapped Access --- */
+
+/*
+ * Returns the I/O backend a file handle was opened with.
+ */
+SM_IOMode getFileIOMode(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return mgmt->mode;
+}
+
+/* --- I/O Statistics --- */
+
+/*
+ * Turns latency timing of reads and writes on or off for every file.
+ * Counters are always kept; timing costs two clock reads per call.
+ */
+void setStorageIOTiming(int enabled) {
+    __atomic_store_n(&ioTiming, enabled != 0, __ATOMIC_RELAXED);
+}
+
+/*
+ * Copies the I/O counters and latency histograms of an open file.
+ */
+RC getStorageStats(SM_FileHandle *fHandle, SM_IOStats *stats) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (stats == NULL)
+        return RC_PARAMS_ERROR;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    const int64_t *src = (const int64_t *) &mgmt->stats;
+    int64_t *dst = (int64_t *) stats;
+    for (size_t i = 0; i < sizeof(SM_IOStats) / sizeof(int64_t); i++)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    stats->bytesRead = stats->reads * mgmt->pageSize;
+    stats->bytesWritten = stats->writes * mgmt->pageSize;
+    return RC_OK;
+}
+
+/*
+ * Zeroes the I/O counters and latency histograms of an open file.
+ */
+RC resetStorageStats(SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    int64_t *counters = (int64_t *) &mgmt->stats;
+    for (size_t i = 0; i < sizeof(SM_IOStats) / sizeof(int64_t); i++)
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/*
+ * Counts I/O a companion module (the async queue) issued on the file's
+ * descriptor itself, so it shows up like readBlocks / writeBlocks.
+ */
+void recordStorageIO(SM_FileHandle *fHandle, int isWrite, int numPages, int64_t nanos) {
+    if (fHandle != NULL && fHandle->mgmtInfo != NULL && numPages > 0)
+        countIO(fHandle->mgmtInfo, isWrite, numPages,
+                __atomic_load_n(&ioTiming, __ATOMIC_RELAXED) ? nanos : -1);
+}
+
+/*
+ * Prints the counters of an open file, with read and write latency
+ * percentiles (upper bounds of their histogram buckets) and the
+ * non-empty buckets of each histogram.
+ */
+void printStorageStats(SM_FileHandle *fHandle) {
+    SM_IOStats stats;
+    if (getStorageStats(fHandle, &stats) != RC_OK) {
+        printf("File handle is not initialized.\n");
+        return;
+    }
+
+    printf("[%s] reads %lld (%lld bytes), writes %lld (%lld bytes), extensions %lld, syncs %lld\n",
+           fHandle->fileName, (long long) stats.reads, (long long) stats.bytesRead,
+           (long long) stats.writes, (long long) stats.bytesWritten,
+           (long long) stats.extensions, (long long) stats.syncs);
+
+    const int64_t *histograms[] = { stats.readLatency, stats.writeLatency };
+    const char *labels[] = { "read", "write" };
+    for (int h = 0; h < 2; h++) {
+        printf("  %-5s p50 <= %lld ns, p99 <= %lld ns, max <= %lld ns:", labels[h],
+               (long long) latencyPercentile(histograms[h], 0.50),
+               (long long) latencyPercentile(histograms[h], 0.99),
+               (long long) latencyPercentile(histograms[h], 1.0));
+        for (int b = 0; b < SM_LATENCY_BUCKETS; b++) {
+            if (histograms[h][b] > 0)
+                printf(" [%lld ns: %lld]", (long long) 1 << b, (long long) histograms[h][b]);
+        }
+        printf("\n");
+    }
+}
+
+/*
+ * Returns the raw descriptor behind a descriptor-based handle, or -1 for
+ * stdio streams, in-memory files and compressed files, whose pages are
+ * not at fixed offsets. Meant for companion modules such as the async queue.
+ */
+int getFileDescriptor(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return mgmt->mode == SM_IO_COMPRESSED ? -1 : mgmt->fd;
+}
+
+/*
+ * Returns the byte offset of a page in the file, past the header page,
+ * or -1 for compressed and in-memory files.
+ */
+int64_t getPageOffset(SM_FileHandle *fHandle, PageNumber pageNum) {
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (mgmt->mode == SM_IO_COMPRESSED || mgmt->mode == SM_IO_MEMORY)
+        return -1;
+    return (int64_t) pageOffset(mgmt, pageNum);
+}
+
+/*
+ * Hands out a pointer to the page inside the mapping (or the in-memory
+ * file) instead of copying it. The pointer stays valid until the file is
+ * closed; edits through it reach the file and are made durable by
+ * flushBlocks.
+ */
+RC getPagePointer(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle *pagePtr) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || pagePtr == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum < 0 || pageNum >= NUM_PAGES(fHandle))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    if (mgmt->ops->pagePointer == NULL)
+        return RC_ERROR;
+
+    *pagePtr = mgmt->ops->pagePointer(fHandle, pageNum);
+    SET_PAGE_POS(fHandle, pageNum);
+    return RC_OK;
+}
+
+/*
+ * Forces numPages pages starting at startPage. First they reach the
+ * kernel: mapped files use msync, stdio streams fflush, and compressed
+ * files write out their extent table; positional and direct writes are
+ * there already and in-memory files have nowhere to go. Then the file's
+ * durability mode decides whether to wait for stable storage: not at
+ * all, with an fdatasync per force, or with one fdatasync shared by the
+ * forces of a group-commit interval.
+ */
+RC flushBlocks(PageNumber startPage, PageNumber numPages, SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (startPage < 0 || numPages < 0 || startPage + numPages > NUM_PAGES(fHandle))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    RC rc = mgmt->ops->sync(fHandle, startPage, numPages);
+    if (rc != RC_OK)
+        return rc;
+    return applyDurability(mgmt);
+}
+
+/* --- Access-Pattern Hints --- */
+
+/*
+ * Tells the kernel how pages [startPage, startPage + numPages) will be
+ * read; numPages 0 means through the end of the file. SM_ADVICE_SEQUENTIAL
+ * deepens kernel read-ahead, SM_ADVICE_RANDOM turns it off, and
+ * SM_ADVICE_WILLNEED / SM_ADVICE_DONTNEED start reading the range in or
+ * drop it from the page cache. Hints never change what reads return.
+ */
+RC adviseBlocks(PageNumber startPage, PageNumber numPages, SM_FileHandle *fHandle, SM_Advice advice) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (advice < SM_ADVICE_NORMAL || advice > SM_ADVICE_DONTNEED)
+        return RC_PARAMS_ERROR;
+    PageNumber totalPages = NUM_PAGES(fHandle);
+    if (startPage < 0 || numPages < 0 || startPage > totalPages || numPages > totalPages - startPage)
+        return RC_READ_NON_EXISTING_PAGE;
+    if (numPages == 0)
+        numPages = totalPages - startPage;
+    if (numPages == 0)
+        return RC_OK;
+
+    SM_FileMgmt *mgmt = fHandle->mgmtInfo;
+    return mgmt->ops->advise(fHandle, startPage, numPages, advice);
+}
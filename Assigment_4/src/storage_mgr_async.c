@@ -0,0 +1,511 @@
+/************************************************************
+ *     File name:                storage_mgr_async.c
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ *
+ *  Asynchronous submission/completion queue for page I/O.
+ *  A queue is driven by one thread at a time; the requests it
+ *  runs proceed concurrently underneath it.
+ ************************************************************/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE             /* syscall() */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <time.h>
+#include "storage_mgr_async.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SM_HAVE_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/* Upper bound on worker threads for the thread-pool backend */
+#define MAX_ASYNC_WORKERS 64
+
+struct SM_AsyncQueue {
+    SM_FileHandle *fHandle;       /* File every request targets */
+    SM_AsyncBackend backend;      /* SM_ASYNC_IO_URING or SM_ASYNC_THREADS */
+    int depth;                    /* Maximum requests in flight */
+    int inFlight;                 /* Submitted and not yet completed */
+    SM_AsyncRequest *doneHead;    /* Completed, not yet collected (FIFO) */
+    SM_AsyncRequest *doneTail;
+    int numDone;
+
+    /* Thread-pool backend */
+    pthread_mutex_t lock;         /* Guards every field above and below */
+    pthread_cond_t workReady;     /* Signalled when pending work arrives */
+    pthread_cond_t workDone;      /* Signalled when a request completes */
+    SM_AsyncRequest *pendingHead; /* Submitted, not yet picked by a worker */
+    SM_AsyncRequest *pendingTail;
+    pthread_t *workers;
+    int numWorkers;
+    int stopping;
+
+#ifdef SM_HAVE_IO_URING
+    /* io_uring backend */
+    int ringFd;
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+#endif
+};
+
+/* Runs a request with the blocking storage manager calls */
+static RC runRequestSync(SM_AsyncQueue *queue, SM_AsyncRequest *request) {
+    if (request->op == SM_ASYNC_READ)
+        return readBlocks(request->pageNum, request->numPages, queue->fHandle, request->bufs);
+    return writeBlocks(request->pageNum, request->numPages, queue->fHandle, request->bufs);
+}
+
+/* Appends a finished request to the completion list (lock held for threads) */
+static void pushDone(SM_AsyncQueue *queue, SM_AsyncRequest *request) {
+    request->next = NULL;
+    if (queue->doneTail)
+        queue->doneTail->next = request;
+    else
+        queue->doneHead = request;
+    queue->doneTail = request;
+    queue->numDone++;
+    queue->inFlight--;
+}
+
+/* Moves up to max completed requests into done (lock held for threads) */
+static int popDone(SM_AsyncQueue *queue, SM_AsyncRequest **done, int max) {
+    int n = 0;
+    while (n < max && queue->doneHead != NULL) {
+        SM_AsyncRequest *request = queue->doneHead;
+        queue->doneHead = request->next;
+        if (queue->doneHead == NULL)
+            queue->doneTail = NULL;
+        request->next = NULL;
+        done[n++] = request;
+        queue->numDone--;
+    }
+    return n;
+}
+
+/* ------------------------------------------------------------
+ * Thread-pool backend
+ * ------------------------------------------------------------ */
+
+static void *asyncWorker(void *arg) {
+    SM_AsyncQueue *queue = (SM_AsyncQueue *) arg;
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (queue->pendingHead == NULL && !queue->stopping)
+            pthread_cond_wait(&queue->workReady, &queue->lock);
+        if (queue->pendingHead == NULL)
+            break;
+
+        SM_AsyncRequest *request = queue->pendingHead;
+        queue->pendingHead = request->next;
+        if (queue->pendingHead == NULL)
+            queue->pendingTail = NULL;
+
+        pthread_mutex_unlock(&queue->lock);
+        request->result = runRequestSync(queue, request);
+        pthread_mutex_lock(&queue->lock);
+
+        pushDone(queue, request);
+        pthread_cond_broadcast(&queue->workDone);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static RC startWorkers(SM_AsyncQueue *queue) {
+    /*
+     * A stdio stream (one shared position) and a compressed file (one
+     * extent table) serialise every transfer under a lock, so more
+     * workers would only wait on each other
+     */
+    int numWorkers = queue->depth < MAX_ASYNC_WORKERS ? queue->depth : MAX_ASYNC_WORKERS;
+    SM_IOMode mode = getFileIOMode(queue->fHandle);
+    if (mode == SM_IO_STDIO || mode == SM_IO_COMPRESSED)
+        numWorkers = 1;
+
+    queue->workers = (pthread_t *) malloc(numWorkers * sizeof(pthread_t));
+    if (queue->workers == NULL)
+        return RC_MALLOC_FAILED;
+    for (int i = 0; i < numWorkers; i++) {
+        if (pthread_create(&queue->workers[i], NULL, asyncWorker, queue) != 0)
+            return RC_ERROR;
+        queue->numWorkers++;
+    }
+    return RC_OK;
+}
+
+static void stopWorkers(SM_AsyncQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    pthread_cond_broadcast(&queue->workReady);
+    pthread_mutex_unlock(&queue->lock);
+    for (int i = 0; i < queue->numWorkers; i++)
+        pthread_join(queue->workers[i], NULL);
+    free(queue->workers);
+    queue->workers = NULL;
+    queue->numWorkers = 0;
+}
+
+/* ------------------------------------------------------------
+ * io_uring backend (raw syscalls)
+ * ------------------------------------------------------------ */
+
+#ifdef SM_HAVE_IO_URING
+
+/* Clock for the submit-to-completion latency reported to the storage manager */
+static int64_t monotonicNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int ioUringSetup(unsigned entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static void closeRing(SM_AsyncQueue *queue) {
+    if (queue->sqes != NULL && queue->sqes != MAP_FAILED)
+        munmap(queue->sqes, queue->sqesSize);
+    if (queue->cqRing != NULL && queue->cqRing != MAP_FAILED && queue->cqRing != queue->sqRing)
+        munmap(queue->cqRing, queue->cqRingSize);
+    if (queue->sqRing != NULL && queue->sqRing != MAP_FAILED)
+        munmap(queue->sqRing, queue->sqRingSize);
+    if (queue->ringFd >= 0)
+        close(queue->ringFd);
+    queue->ringFd = -1;
+}
+
+static RC openRing(SM_AsyncQueue *queue) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    queue->ringFd = ioUringSetup((unsigned) queue->depth, &params);
+    if (queue->ringFd < 0)
+        return RC_ERROR;
+
+    queue->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    queue->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (queue->cqRingSize > queue->sqRingSize)
+            queue->sqRingSize = queue->cqRingSize;
+        queue->cqRingSize = queue->sqRingSize;
+    }
+
+    queue->sqRing = mmap(NULL, queue->sqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, queue->ringFd, IORING_OFF_SQ_RING);
+    if (queue->sqRing == MAP_FAILED) {
+        closeRing(queue);
+        return RC_ERROR;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        queue->cqRing = queue->sqRing;
+    } else {
+        queue->cqRing = mmap(NULL, queue->cqRingSize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, queue->ringFd, IORING_OFF_CQ_RING);
+        if (queue->cqRing == MAP_FAILED) {
+            closeRing(queue);
+            return RC_ERROR;
+        }
+    }
+    queue->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    queue->sqes = mmap(NULL, queue->sqesSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, queue->ringFd, IORING_OFF_SQES);
+    if (queue->sqes == MAP_FAILED) {
+        closeRing(queue);
+        return RC_ERROR;
+    }
+
+    char *sq = (char *) queue->sqRing;
+    char *cq = (char *) queue->cqRing;
+    queue->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    queue->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    queue->sqArray = (unsigned *) (sq + params.sq_off.array);
+    queue->cqHead = (unsigned *) (cq + params.cq_off.head);
+    queue->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    queue->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    queue->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return RC_OK;
+}
+
+/* Drains the completion ring into the done list */
+static void reapRing(SM_AsyncQueue *queue) {
+    unsigned head = *queue->cqHead;
+    unsigned tail = __atomic_load_n(queue->cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &queue->cqes[head & *queue->cqMask];
+        SM_AsyncRequest *request = (SM_AsyncRequest *) (uintptr_t) cqe->user_data;
+        long expected = (long) request->numPages * queue->fHandle->pageSize;
+
+        /* Errors and short transfers are redone synchronously; this also
+           covers unaligned buffers on an O_DIRECT file and reads past EOF */
+        if (cqe->res == expected) {
+            request->result = RC_OK;
+            recordStorageIO(queue->fHandle, request->op == SM_ASYNC_WRITE, request->numPages,
+                            monotonicNanos() - request->submitNanos);
+        } else
+            request->result = runRequestSync(queue, request);
+
+        free(request->iov);
+        request->iov = NULL;
+        pushDone(queue, request);
+        head++;
+    }
+    __atomic_store_n(queue->cqHead, head, __ATOMIC_RELEASE);
+}
+
+/* Blocks until at least one in-flight request completes */
+static void waitRing(SM_AsyncQueue *queue) {
+    if (queue->inFlight == 0)
+        return;
+    while (ioUringEnter(queue->ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR)
+        ;
+    reapRing(queue);
+}
+
+static RC submitRing(SM_AsyncQueue *queue, SM_AsyncRequest *request) {
+    struct iovec *iov = (struct iovec *) malloc(request->numPages * sizeof(struct iovec));
+    if (iov == NULL)
+        return RC_MALLOC_FAILED;
+    for (int i = 0; i < request->numPages; i++) {
+        iov[i].iov_base = request->bufs[i];
+        iov[i].iov_len = (size_t) queue->fHandle->pageSize;
+    }
+    request->iov = iov;
+
+    unsigned tail = *queue->sqTail;
+    unsigned index = tail & *queue->sqMask;
+    struct io_uring_sqe *sqe = &queue->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (request->op == SM_ASYNC_READ) ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = getFileDescriptor(queue->fHandle);
+    sqe->off = (uint64_t) getPageOffset(queue->fHandle, request->pageNum);
+    sqe->addr = (uint64_t) (uintptr_t) iov;
+    sqe->len = (unsigned) request->numPages;
+    sqe->user_data = (uint64_t) (uintptr_t) request;
+    request->submitNanos = monotonicNanos();
+    queue->sqArray[index] = index;
+    __atomic_store_n(queue->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    queue->inFlight++;
+    int submitted;
+    while ((submitted = ioUringEnter(queue->ringFd, 1, 0, 0)) < 0 && errno == EINTR)
+        ;
+    if (submitted < 0) {
+        /* The kernel refused the entry: roll it back and run it inline */
+        __atomic_store_n(queue->sqTail, tail, __ATOMIC_RELEASE);
+        free(iov);
+        request->iov = NULL;
+        request->result = runRequestSync(queue, request);
+        pushDone(queue, request);
+    }
+    return RC_OK;
+}
+
+#endif /* SM_HAVE_IO_URING */
+
+/* ------------------------------------------------------------
+ * Public interface
+ * ------------------------------------------------------------ */
+
+/*
+ * Creates a queue that keeps up to depth requests in flight on fHandle.
+ * SM_ASYNC_AUTO picks io_uring for descriptor-based files when the
+ * kernel allows it and falls back to worker threads otherwise.
+ */
+RC createAsyncQueue(SM_FileHandle *fHandle, int depth, SM_AsyncBackend backend,
+                    SM_AsyncQueue **queue) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || queue == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (depth < 1)
+        return RC_PARAMS_ERROR;
+
+    SM_AsyncQueue *q = (SM_AsyncQueue *) calloc(1, sizeof(SM_AsyncQueue));
+    if (q == NULL)
+        return RC_MALLOC_FAILED;
+    q->fHandle = fHandle;
+    q->depth = depth;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->workReady, NULL);
+    pthread_cond_init(&q->workDone, NULL);
+
+    SM_IOMode mode = getFileIOMode(fHandle);
+    int ringCapable = (mode == SM_IO_POSITIONAL || mode == SM_IO_DIRECT);
+    RC rc = RC_ERROR;
+
+#ifdef SM_HAVE_IO_URING
+    q->ringFd = -1;
+    if (ringCapable && backend != SM_ASYNC_THREADS) {
+        rc = openRing(q);
+        if (rc == RC_OK)
+            q->backend = SM_ASYNC_IO_URING;
+    }
+#else
+    (void) ringCapable;
+#endif
+
+    if (rc != RC_OK) {
+        if (backend == SM_ASYNC_IO_URING) {
+            destroyAsyncQueue(q);
+            return RC_ERROR;
+        }
+        q->backend = SM_ASYNC_THREADS;
+        rc = startWorkers(q);
+        if (rc != RC_OK) {
+            destroyAsyncQueue(q);
+            return rc;
+        }
+    }
+
+    *queue = q;
+    return RC_OK;
+}
+
+/*
+ * Waits for every in-flight request and releases the queue. Completed
+ * requests that were never collected are simply dropped.
+ */
+RC destroyAsyncQueue(SM_AsyncQueue *queue) {
+    if (queue == NULL)
+        return RC_PARAMS_ERROR;
+
+    if (queue->backend == SM_ASYNC_THREADS) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->inFlight > 0)
+            pthread_cond_wait(&queue->workDone, &queue->lock);
+        pthread_mutex_unlock(&queue->lock);
+        stopWorkers(queue);
+    }
+#ifdef SM_HAVE_IO_URING
+    else {
+        while (queue->inFlight > 0)
+            waitRing(queue);
+    }
+    closeRing(queue);
+#endif
+
+    pthread_cond_destroy(&queue->workDone);
+    pthread_cond_destroy(&queue->workReady);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+    return RC_OK;
+}
+
+/*
+ * Returns the mechanism the queue ended up using.
+ */
+SM_AsyncBackend getAsyncBackend(SM_AsyncQueue *queue) {
+    return queue->backend;
+}
+
+/*
+ * Returns the number of submitted requests that have not completed yet.
+ */
+int getAsyncInFlight(SM_AsyncQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    int n = queue->inFlight;
+    pthread_mutex_unlock(&queue->lock);
+    return n;
+}
+
+/*
+ * Queues a request. Returns as soon as it is handed to the kernel or a
+ * worker; blocks only while depth requests are already in flight.
+ */
+RC submitAsync(SM_AsyncQueue *queue, SM_AsyncRequest *request) {
+    if (queue == NULL || request == NULL || request->bufs == NULL)
+        return RC_PARAMS_ERROR;
+    if (request->pageNum < 0 || request->numPages < 1 ||
+        request->pageNum + request->numPages >
+        __atomic_load_n(&queue->fHandle->totalNumPages, __ATOMIC_ACQUIRE))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    request->next = NULL;
+    request->iov = NULL;
+    request->result = RC_OK;
+
+    if (queue->backend == SM_ASYNC_THREADS) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->inFlight >= queue->depth)
+            pthread_cond_wait(&queue->workDone, &queue->lock);
+        if (queue->pendingTail)
+            queue->pendingTail->next = request;
+        else
+            queue->pendingHead = request;
+        queue->pendingTail = request;
+        queue->inFlight++;
+        pthread_cond_signal(&queue->workReady);
+        pthread_mutex_unlock(&queue->lock);
+        return RC_OK;
+    }
+
+#ifdef SM_HAVE_IO_URING
+    while (queue->inFlight >= queue->depth)
+        waitRing(queue);
+    return submitRing(queue, request);
+#else
+    return RC_ERROR;
+#endif
+}
+
+/*
+ * Collects up to max completed requests without blocking.
+ */
+RC pollAsync(SM_AsyncQueue *queue, SM_AsyncRequest **done, int max, int *numDone) {
+    return waitAsync(queue, done, 0, max, numDone);
+}
+
+/*
+ * Collects between min and max completed requests, blocking until at
+ * least min are available. min is capped by what is actually outstanding.
+ */
+RC waitAsync(SM_AsyncQueue *queue, SM_AsyncRequest **done, int min, int max, int *numDone) {
+    if (queue == NULL || done == NULL || numDone == NULL || max < 0)
+        return RC_PARAMS_ERROR;
+    if (min > max)
+        min = max;
+
+    if (queue->backend == SM_ASYNC_THREADS) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->numDone < min && queue->inFlight > 0)
+            pthread_cond_wait(&queue->workDone, &queue->lock);
+        *numDone = popDone(queue, done, max);
+        pthread_mutex_unlock(&queue->lock);
+        return RC_OK;
+    }
+
+#ifdef SM_HAVE_IO_URING
+    reapRing(queue);
+    while (queue->numDone < min && queue->inFlight > 0)
+        waitRing(queue);
+#endif
+    *numDone = popDone(queue, done, max);
+    return RC_OK;
+}
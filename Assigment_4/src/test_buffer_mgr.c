@@ -0,0 +1,992 @@
+/************************************************************
+ *     File name:                test_buffer_mgr.c
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ ************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_policy.h"
+#include "buffer_mgr_stat.h"
+#include "record_mgr.h"
+#include "rm_serializer.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// Test name
+char *testName;
+
+// Test output file
+#define TESTPF "test_buffer.bin"
+#define TESTTABLE "test_table.bin"
+
+// Prototypes for test functions
+static void createDummyPages(int num);
+static void checkDummyPage(BM_BufferPool *bm, BM_PageHandle *h, int pageNum);
+static void testPrefetch(void);
+static void testFlushRuns(void);
+static void testSortedFlush(void);
+static void testPageTable(void);
+static void testLRUList(void);
+static void testStrategies(void);
+static void testARC(void);
+static void testTwoQueue(void);
+static void testPolicyConfig(void);
+static void testWriteBack(void);
+static void testPageCleaner(void);
+static void testConcurrentPins(void);
+static void testPageReuse(void);
+
+int main(void) {
+    testName = "";
+
+    initStorageManager();
+
+    testPrefetch();
+    testFlushRuns();
+    testSortedFlush();
+    testPageTable();
+    testLRUList();
+    testStrategies();
+    testARC();
+    testTwoQueue();
+    testPolicyConfig();
+    testWriteBack();
+    testPageCleaner();
+    testConcurrentPins();
+    testPageReuse();
+
+    return 0;
+}
+
+// Create a page file whose page i holds the string "Page-i"
+static void createDummyPages(int num) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+    for (int i = 0; i < num; i++) {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+    free(h);
+}
+
+static void checkDummyPage(BM_BufferPool *bm, BM_PageHandle *h, int pageNum) {
+    char expected[16];
+    sprintf(expected, "Page-%i", pageNum);
+    TEST_CHECK(pinPage(bm, h, pageNum));
+    ASSERT_EQUALS_STRING(expected, h->data, "page content matches");
+    TEST_CHECK(unpinPage(bm, h));
+}
+
+// Prefetched pages are cached unpinned and later pins hit without I/O
+void testPrefetch(void) {
+    ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+    testName = "test prefetching a run of pages";
+
+    createDummyPages(10);
+    for (int s = 0; s < 7; s++) {
+        BM_BufferPool *bm = MAKE_POOL();
+        TEST_CHECK(initBufferPool(bm, TESTPF, 5, strategies[s], NULL));
+
+        // the reads are still in flight when prefetchPages returns
+        TEST_CHECK(prefetchPages(bm, 2, 4));
+        ASSERT_EQUALS_INT(4, getNumReadIO(bm), "four pages read ahead");
+
+        for (int i = 2; i < 6; i++)
+            checkDummyPage(bm, h, i);
+        ASSERT_EQUALS_INT(4, getNumReadIO(bm), "pins of prefetched pages hit the cache");
+        int *fixCounts = getFixCounts(bm);
+        for (int i = 0; i < 5; i++)
+            ASSERT_EQUALS_INT(0, fixCounts[i], "prefetched pages are not left pinned");
+        free(fixCounts);
+
+        // overlaps cached pages and runs past end of file
+        TEST_CHECK(prefetchPages(bm, 4, 20));
+        ASSERT_EQUALS_INT(8, getNumReadIO(bm), "only missing pages before end of file are read");
+        checkDummyPage(bm, h, 9);
+
+        // a pinned frame is never claimed, so at most 4 pages fit
+        TEST_CHECK(pinPage(bm, h, 9));
+        TEST_CHECK(prefetchPages(bm, 0, 10));
+        ASSERT_EQUALS_INT(12, getNumReadIO(bm), "read-ahead is bounded by unpinned frames");
+        ASSERT_EQUALS_INT(9, (int) h->pageNum, "pinned page stays in place");
+        TEST_CHECK(unpinPage(bm, h));
+        checkDummyPage(bm, h, 0);
+
+        TEST_CHECK(shutdownBufferPool(bm));
+    }
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// Dirty pages in consecutive frames are flushed together and land correctly
+void testFlushRuns(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+    testName = "test flushing runs of dirty pages";
+
+    createDummyPages(8);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 8, RS_FIFO, NULL));
+    for (int i = 0; i < 8; i++) {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "New-%i", i);
+        // leave page 5 pinned so it splits the run
+        if (i != 5) {
+            TEST_CHECK(markDirty(bm, h));
+            TEST_CHECK(unpinPage(bm, h));
+        }
+    }
+    TEST_CHECK(forceFlushPool(bm));
+    bool *dirty = getDirtyFlags(bm);
+    for (int i = 0; i < 8; i++)
+        ASSERT_TRUE(!dirty[i], "no dirty pages left after flush");
+    free(dirty);
+    h->pageNum = 5;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+    for (int i = 0; i < 8; i++) {
+        char expected[16];
+        sprintf(expected, i == 5 ? "Page-%i" : "New-%i", i);
+        TEST_CHECK(pinPage(bm, h, i));
+        ASSERT_EQUALS_STRING(expected, h->data, "flushed content reached the file");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// Sums the write calls recorded beneath a pool
+static int64_t poolWriteCalls(BM_BufferPool *bm) {
+    SM_IOStats stats;
+    int64_t calls = 0;
+    TEST_CHECK(getPoolStorageStats(bm, &stats));
+    for (int b = 0; b < SM_LATENCY_BUCKETS; b++)
+        calls += stats.writeLatency[b];
+    return calls;
+}
+
+// Dirty pages scattered over the frames are flushed in page order, one write per run
+void testSortedFlush(void) {
+    int order[] = { 6, 2, 7, 0, 3, 1, 5, 4 };
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+    testName = "test sorted, coalesced flush";
+
+    createDummyPages(8);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 8, RS_FIFO, NULL));
+    for (int i = 0; i < 8; i++) {
+        TEST_CHECK(pinPage(bm, h, order[i]));
+        sprintf(h->data, "Sorted-%i", order[i]);
+        TEST_CHECK(markDirty(bm, h));
+        // page 5 stays pinned, splitting pages 0-7 into two runs
+        if (order[i] != 5)
+            TEST_CHECK(unpinPage(bm, h));
+    }
+
+    int writesBefore = getNumWriteIO(bm);
+    int64_t callsBefore = poolWriteCalls(bm);
+    TEST_CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(7, getNumWriteIO(bm) - writesBefore, "every unpinned dirty page written");
+    ASSERT_EQUALS_INT(5, getNumWriteIOSaved(bm), "seven pages in two writes save five");
+    ASSERT_EQUALS_INT(2, (int) (poolWriteCalls(bm) - callsBefore), "one storage write per run");
+
+    h->pageNum = 5;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(5, getNumWriteIOSaved(bm), "a lone page saves nothing");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+    for (int i = 0; i < 8; i++) {
+        char expected[16];
+        sprintf(expected, "Sorted-%i", i);
+        TEST_CHECK(pinPage(bm, h, i));
+        ASSERT_EQUALS_STRING(expected, h->data, "flushed content reached the file");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// Returns whether pageNum is one of the pool's frame contents
+static bool poolHolds(BM_BufferPool *bm, int pageNum) {
+    PageNumber *frames = getFrameContents(bm);
+    bool found = false;
+    for (int i = 0; i < bm->numPages; i++)
+        found = found || frames[i] == pageNum;
+    free(frames);
+    return found;
+}
+
+// Lookups through the page table agree with the frame contents while pages
+// are evicted and reloaded, including pages that share a probe run
+void testPageTable(void) {
+    ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    unsigned int seed = 12345;
+
+    testName = "test page table lookups under eviction";
+
+    createDummyPages(200);
+    for (int s = 0; s < 7; s++) {
+        TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategies[s], NULL));
+        for (int i = 0; i < 500; i++) {
+            seed = seed * 1103515245u + 12345u;
+            // most pins go to a small hot set, so both hits and misses occur
+            int pageNum = (int) ((seed >> 8) % ((seed >> 30) ? 12 : 200));
+            bool cached = poolHolds(bm, pageNum);
+            int readsBefore = getNumReadIO(bm);
+            checkDummyPage(bm, h, pageNum);
+            ASSERT_EQUALS_INT(cached ? 0 : 1, getNumReadIO(bm) - readsBefore,
+                              "a page is read only when no frame holds it");
+        }
+        TEST_CHECK(shutdownBufferPool(bm));
+        bm = MAKE_POOL();
+    }
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// LRU evicts the page unpinned longest ago, passing over pinned pages
+void testLRUList(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *held = MAKE_PAGE_HANDLE();
+
+    testName = "test LRU list of unpinned frames";
+
+    createDummyPages(8);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+    for (int i = 0; i < 3; i++)
+        checkDummyPage(bm, h, i);
+
+    // a hit makes page 0 the most recently used, so page 1 goes first
+    checkDummyPage(bm, h, 0);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(!poolHolds(bm, 1) && poolHolds(bm, 0), "least recently used page evicted");
+
+    // page 2 is now the oldest, but while pinned it is passed over
+    TEST_CHECK(pinPage(bm, held, 2));
+    checkDummyPage(bm, h, 4);
+    ASSERT_TRUE(poolHolds(bm, 2) && !poolHolds(bm, 0), "pinned page kept, next oldest evicted");
+
+    // once unpinned it counts as just used
+    TEST_CHECK(unpinPage(bm, held));
+    checkDummyPage(bm, h, 5);
+    ASSERT_TRUE(poolHolds(bm, 2) && !poolHolds(bm, 3), "unpinning refreshes a page");
+
+    // with every frame pinned no page can be loaded
+    BM_PageHandle pins[3];
+    int resident[] = { 2, 4, 5 };
+    for (int i = 0; i < 3; i++)
+        TEST_CHECK(pinPage(bm, &pins[i], resident[i]));
+    ASSERT_TRUE(pinPage(bm, h, 6) != RC_OK, "no victim while every frame is pinned");
+    for (int i = 0; i < 3; i++)
+        TEST_CHECK(unpinPage(bm, &pins[i]));
+    checkDummyPage(bm, h, 6);
+    ASSERT_TRUE(!poolHolds(bm, 2), "first page unpinned is evicted first");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    free(held);
+    TEST_DONE();
+}
+
+// Pins each page of pages[] once and unpins it
+static void touchPages(BM_BufferPool *bm, BM_PageHandle *h, const int pages[], int count) {
+    for (int i = 0; i < count; i++)
+        checkDummyPage(bm, h, pages[i]);
+}
+
+// CLOCK, LFU and LRU-K each choose the victim their ranking names
+void testStrategies(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int load[] = { 0, 1, 2 };
+
+    testName = "test CLOCK, LFU and LRU-K victims";
+
+    createDummyPages(8);
+    ASSERT_TRUE(initBufferPool(bm, TESTPF, 3, (ReplacementStrategy) 42, NULL) != RC_OK,
+                "unknown strategy rejected");
+
+    // CLOCK: the first sweep clears every use bit and takes frame 0; page 1
+    // is used again, so the hand passes it and takes page 2
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_CLOCK, NULL));
+    touchPages(bm, h, load, 3);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(!poolHolds(bm, 0), "CLOCK evicts page 0 after a full sweep");
+    checkDummyPage(bm, h, 1);
+    checkDummyPage(bm, h, 4);
+    ASSERT_TRUE(poolHolds(bm, 1) && !poolHolds(bm, 2), "CLOCK gives a used page a second chance");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // LFU: the page used least often goes, however recently
+    int lfuUses[] = { 0, 0, 0, 1, 1 };
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LFU, NULL));
+    touchPages(bm, h, load, 3);
+    touchPages(bm, h, lfuUses, 5);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(!poolHolds(bm, 2), "LFU evicts the page used once");
+    checkDummyPage(bm, h, 4);
+    ASSERT_TRUE(!poolHolds(bm, 3) && poolHolds(bm, 0) && poolHolds(bm, 1),
+                "LFU evicts the newly loaded page before frequently used ones");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // LRU-K: pages used once go first; then the oldest second-to-last use
+    int lruKUses[] = { 2, 0 };
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU_K, NULL));
+    touchPages(bm, h, load, 3);
+    touchPages(bm, h, lruKUses, 2);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(!poolHolds(bm, 1), "LRU-K evicts the page used once");
+    checkDummyPage(bm, h, 4);
+    ASSERT_TRUE(!poolHolds(bm, 3), "LRU-K evicts the newly loaded page");
+    checkDummyPage(bm, h, 4);
+    checkDummyPage(bm, h, 5);
+    ASSERT_TRUE(!poolHolds(bm, 0) && poolHolds(bm, 2),
+                "LRU-K evicts the page whose second-to-last use is oldest");
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// A scan of pages used once passes through ARC's T1 without evicting pages
+// used twice, which LRU loses
+void testARC(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int hot[] = { 0, 1, 0, 1 };
+    int scan[] = { 2, 3, 4, 5, 6, 7 };
+
+    testName = "test ARC scan resistance";
+
+    createDummyPages(8);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU, NULL));
+    touchPages(bm, h, hot, 4);
+    touchPages(bm, h, scan, 6);
+    ASSERT_TRUE(!poolHolds(bm, 0) && !poolHolds(bm, 1), "LRU loses the hot pages to a scan");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_ARC, NULL));
+    touchPages(bm, h, hot, 4);
+    touchPages(bm, h, scan, 6);
+    ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1), "ARC keeps the hot pages through a scan");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// Pages used again after they left 2Q's probation queue reach the main
+// queue, where a later scan cannot reach them; under LRU the scan evicts them
+void testTwoQueue(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int load[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    int hot[] = { 0, 1 };
+    int scan[] = { 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+
+    testName = "test 2Q scan resistance";
+
+    createDummyPages(20);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 8, RS_LRU, NULL));
+    touchPages(bm, h, load, 10);
+    touchPages(bm, h, hot, 2);
+    touchPages(bm, h, scan, 10);
+    ASSERT_TRUE(!poolHolds(bm, 0) && !poolHolds(bm, 1), "LRU loses the hot pages to a scan");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // a pool of 8 keeps 2 pages in A1in: pages 0 and 1 are pushed out to
+    // A1out by pages 8 and 9, and their next use moves them to the main queue
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 8, RS_2Q, NULL));
+    touchPages(bm, h, load, 10);
+    ASSERT_TRUE(!poolHolds(bm, 0) && !poolHolds(bm, 1) && poolHolds(bm, 2),
+                "2Q evicts the oldest pages of A1in first");
+    touchPages(bm, h, hot, 2);
+    touchPages(bm, h, scan, 10);
+    ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1), "2Q keeps the hot pages through a scan");
+    ASSERT_TRUE(!poolHolds(bm, 9) && poolHolds(bm, 19), "2Q replaces scanned pages in load order");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// A policy that replaces the page unpinned most recently
+static Frame *mruVictim(PageCache *pageCache, PageNumber pageNum) {
+    (void) pageNum;
+    return pageCache->lruTail;
+}
+
+static const BM_ReplacementPolicy mruPolicy = { "MRU", NULL, NULL, NULL, NULL, NULL, mruVictim, NULL };
+
+// stratData tunes the built-in policies, or plugs in a policy of its own
+void testPolicyConfig(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_StrategyConfig config;
+    int early[] = { 0, 0, 0, 1, 1, 2, 2 };
+    int load[] = { 0, 1, 2 };
+
+    testName = "test replacement policy configuration";
+
+    createDummyPages(8);
+    memset(&config, 0, sizeof(config));
+    config.k = -1;
+    ASSERT_TRUE(initBufferPool(bm, TESTPF, 3, RS_LRU_K, &config) != RC_OK, "negative K rejected");
+    memset(&config, 0, sizeof(config));
+    config.arcTarget = 4;
+    ASSERT_TRUE(initBufferPool(bm, TESTPF, 3, RS_ARC, &config) != RC_OK,
+                "ARC target larger than the pool rejected");
+
+    // a file the storage manager cannot open gives no pool, not a crash
+    FILE *corrupt = fopen(TESTTABLE, "wb");
+    const int32_t badHeader[2] = { 1, 3 };
+    fwrite("SMPGFILE", 1, 8, corrupt);
+    fwrite(badHeader, sizeof(badHeader), 1, corrupt);
+    fclose(corrupt);
+    ASSERT_TRUE(initBufferPool(bm, TESTTABLE, 3, RS_LRU, NULL) == RC_PAGE_CORRUPT,
+                "pool over a file with a corrupt header rejected");
+    remove(TESTTABLE);
+
+    // page 0 was used three times, but long ago: K = 2 ranks it by its
+    // second-to-last use and evicts it, K = 3 keeps it over pages used twice
+    memset(&config, 0, sizeof(config));
+    config.k = 2;
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU_K, &config));
+    touchPages(bm, h, early, 7);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(!poolHolds(bm, 0) && poolHolds(bm, 1), "LRU-2 evicts the page used longest ago");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    config.k = 3;
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU_K, &config));
+    touchPages(bm, h, early, 7);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(poolHolds(bm, 0) && !poolHolds(bm, 1), "LRU-3 evicts a page used fewer than 3 times");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // page 0 is in T2 and pages 1 and 2 in T1: by default ARC shrinks T1,
+    // with a target of the whole pool it shrinks T2
+    int arcUses[] = { 0, 1, 0, 2 };
+    memset(&config, 0, sizeof(config));
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_ARC, &config));
+    touchPages(bm, h, arcUses, 4);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(poolHolds(bm, 0) && !poolHolds(bm, 1), "ARC with target 0 evicts from T1");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    config.arcTarget = 3;
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_ARC, &config));
+    touchPages(bm, h, arcUses, 4);
+    checkDummyPage(bm, h, 3);
+    ASSERT_TRUE(!poolHolds(bm, 0) && poolHolds(bm, 1), "ARC with a full-pool target evicts from T2");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // a policy of the caller's own replaces the strategy's
+    memset(&config, 0, sizeof(config));
+    config.policy = &mruPolicy;
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, &config));
+    touchPages(bm, h, load, 3);
+    checkDummyPage(bm, h, 3);
+    checkDummyPage(bm, h, 4);
+    ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1) && poolHolds(bm, 4) && !poolHolds(bm, 3),
+                "a custom policy picks the victims");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// Check what the page file itself holds for pageNum, bypassing the pool
+static void checkFilePage(int pageNum, const char *expected, const char *message) {
+    SM_FileHandle fh;
+    SM_PageHandle buf = (SM_PageHandle) malloc(PAGE_SIZE);
+
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(readBlock(pageNum, &fh, buf));
+    ASSERT_EQUALS_STRING(expected, buf, message);
+    TEST_CHECK(closePageFile(&fh));
+    free(buf);
+}
+
+// A dirty page is written when it is evicted, forced or flushed, not on unpin
+void testWriteBack(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+    testName = "test deferred write-back of dirty pages";
+
+    createDummyPages(10);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+
+    // repeated updates of an unpinned page stay in its frame
+    for (int i = 0; i < 3; i++) {
+        TEST_CHECK(pinPage(bm, h, 0));
+        sprintf(h->data, "Update-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "unpinning a dirty page writes nothing");
+    checkFilePage(0, "Page-0", "the file keeps the old page until it is written back");
+
+    // forcing writes the page and leaves it clean
+    TEST_CHECK(forcePage(bm, h));
+    checkFilePage(0, "Update-2", "a forced page reaches the file");
+    bool *dirty = getDirtyFlags(bm);
+    ASSERT_TRUE(!dirty[0], "a forced page is clean");
+    free(dirty);
+
+    // evicting a dirty page writes it back once; the clean page 0 goes first
+    TEST_CHECK(pinPage(bm, h, 1));
+    sprintf(h->data, "Update-1");
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    checkDummyPage(bm, h, 2);
+    checkDummyPage(bm, h, 3);
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "evicting a clean page writes nothing");
+    checkDummyPage(bm, h, 4);
+    ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the dirty victim is written back");
+    checkFilePage(1, "Update-1", "an evicted page reaches the file");
+
+    // pages still dirty in the pool survive its shutdown
+    TEST_CHECK(pinPage(bm, h, 5));
+    sprintf(h->data, "Update-5");
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    checkFilePage(5, "Page-5", "page 5 is only in the pool");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+    TEST_CHECK(pinPage(bm, h, 5));
+    ASSERT_EQUALS_STRING("Update-5", h->data, "a dirty page is written back at shutdown");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(pinPage(bm, h, 0));
+    ASSERT_EQUALS_STRING("Update-2", h->data, "the last update of a page is kept");
+    TEST_CHECK(unpinPage(bm, h));
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// Wait up to five seconds for the page cleaner to have written numPages pages
+static void waitForCleaner(BM_BufferPool *bm, int numPages) {
+    struct timespec pause = { 0, 1000000 };
+    for (int i = 0; i < 5000 && getNumPagesCleaned(bm) < numPages; i++)
+        nanosleep(&pause, NULL);
+}
+
+// The page cleaner writes back the coldest dirty pages, so evictions need not
+void testPageCleaner(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    char expected[16];
+
+    testName = "test background page cleaner";
+
+    createDummyPages(20);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 10, RS_LRU, NULL));
+    ASSERT_TRUE(startPageCleaner(bm, 10, 1) != RC_OK, "high watermark must be below the pool size");
+    ASSERT_TRUE(startPageCleaner(bm, 4, 4) != RC_OK, "low watermark must be below the high one");
+
+    // eight dirty pages are past the high watermark of four, so the cleaner
+    // writes the seven released longest ago, leaving one
+    for (int i = 0; i < 8; i++) {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Clean-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(startPageCleaner(bm, 4, 1));
+    ASSERT_TRUE(startPageCleaner(bm, 4, 1) != RC_OK, "a pool has one cleaner");
+    waitForCleaner(bm, 7);
+    ASSERT_EQUALS_INT(7, getNumPagesCleaned(bm), "cleaned down to the low watermark");
+    ASSERT_EQUALS_INT(7, getNumWriteIO(bm), "cleaned pages count as writes");
+    bool *dirty = getDirtyFlags(bm);
+    for (int i = 0; i < 7; i++)
+        ASSERT_TRUE(!dirty[i], "the coldest pages are clean");
+    ASSERT_TRUE(dirty[7], "the page released last is still dirty");
+    free(dirty);
+    for (int i = 0; i < 7; i++) {
+        sprintf(expected, "Clean-%i", i);
+        checkFilePage(i, expected, "a cleaned page reaches the file");
+    }
+
+    // two misses fill the empty frames, five more replace cleaned pages
+    for (int i = 10; i < 17; i++)
+        checkDummyPage(bm, h, i);
+    ASSERT_EQUALS_INT(5, getNumStallsAvoided(bm), "victims were already written back");
+    ASSERT_EQUALS_INT(7, getNumWriteIO(bm), "evicting cleaned pages writes nothing");
+
+    // the page the cleaner left dirty is written at shutdown
+    TEST_CHECK(stopPageCleaner(bm));
+    TEST_CHECK(shutdownBufferPool(bm));
+    checkFilePage(7, "Clean-7", "an uncleaned page is written at shutdown");
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(h);
+    TEST_DONE();
+}
+
+// A thread of testConcurrentPins; errors counts the calls that failed
+typedef struct PinWorker {
+    pthread_t thread;
+    BM_BufferPool *bm;
+    unsigned int seed;
+    int numPages;
+    int stride;         // bumpCounters: distance between the pages it updates
+    int rounds;
+    int errors;
+} PinWorker;
+
+static pthread_mutex_t gateLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gateOpen = PTHREAD_COND_INITIALIZER;
+static bool gateOpened;
+
+// Hold the workers back until all of them exist, so their pins overlap
+static void waitAtGate(void) {
+    pthread_mutex_lock(&gateLock);
+    while (!gateOpened)
+        pthread_cond_wait(&gateOpen, &gateLock);
+    pthread_mutex_unlock(&gateLock);
+}
+
+static void runWorkers(PinWorker *workers, int numWorkers, void *(*body)(void *)) {
+    gateOpened = false;
+    for (int i = 0; i < numWorkers; i++)
+        TEST_CHECK(pthread_create(&workers[i].thread, NULL, body, &workers[i]) == 0 ? RC_OK : RC_ERROR);
+    pthread_mutex_lock(&gateLock);
+    gateOpened = true;
+    pthread_cond_broadcast(&gateOpen);
+    pthread_mutex_unlock(&gateLock);
+    for (int i = 0; i < numWorkers; i++)
+        pthread_join(workers[i].thread, NULL);
+}
+
+// Pin every page once, in the same order as every other worker
+static void *readPages(void *arg) {
+    PinWorker *w = (PinWorker *) arg;
+    BM_PageHandle h;
+    char expected[16];
+    waitAtGate();
+    for (int p = 0; p < w->numPages; p++) {
+        if (pinPage(w->bm, &h, p) != RC_OK) {
+            w->errors++;
+            continue;
+        }
+        sprintf(expected, "Page-%i", p);
+        if (strcmp(expected, h.data) != 0)
+            w->errors++;
+        if (unpinPage(w->bm, &h) != RC_OK)
+            w->errors++;
+    }
+    return NULL;
+}
+
+// Add one to the counter at the start of random pages under their
+// exclusive latch, forcing now and then and reading the pool's counters
+static void *bumpCounters(void *arg) {
+    PinWorker *w = (PinWorker *) arg;
+    BM_PageHandle h;
+    waitAtGate();
+    for (int i = 0; i < w->rounds; i++) {
+        w->seed = w->seed * 1103515245u + 12345u;
+        int page = (int) ((w->seed >> 16) % (unsigned int) w->numPages) * w->stride;
+        if (pinPage(w->bm, &h, page) != RC_OK) {
+            w->errors++;
+            continue;
+        }
+        if (latchPage(w->bm, &h, BM_LATCH_EXCLUSIVE) == RC_OK) {
+            int count;
+            memcpy(&count, h.data, sizeof(int));
+            count++;
+            memcpy(h.data, &count, sizeof(int));
+            if (markDirty(w->bm, &h) != RC_OK || unlatchPage(w->bm, &h) != RC_OK)
+                w->errors++;
+        } else {
+            w->errors++;
+        }
+        if (i % 64 == 0 && forcePage(w->bm, &h) != RC_OK)
+            w->errors++;
+        // the pool's counters may be read while other threads update them
+        if (getNumReadIO(w->bm) < 0 || getNumWriteIO(w->bm) < 0 || getNumWriteIOSaved(w->bm) < 0)
+            w->errors++;
+        if (unpinPage(w->bm, &h) != RC_OK)
+            w->errors++;
+    }
+    return NULL;
+}
+
+// Rewrite page numPages and force it
+static void *forceOnePage(void *arg) {
+    PinWorker *w = (PinWorker *) arg;
+    BM_PageHandle h;
+    waitAtGate();
+    if (pinPage(w->bm, &h, w->numPages) != RC_OK) {
+        w->errors++;
+        return NULL;
+    }
+    sprintf(h.data, "Forced-%i", w->numPages);
+    if (markDirty(w->bm, &h) != RC_OK || unpinPage(w->bm, &h) != RC_OK ||
+        forcePage(w->bm, &h) != RC_OK)
+        w->errors++;
+    return NULL;
+}
+
+// Threads share a pool: concurrent misses on a page read it once, and
+// updates made under page latches through evictions, forces and the page
+// cleaner all reach the file, whichever backend holds it
+void testConcurrentPins(void) {
+    SM_IOMode modes[] = { SM_IO_STDIO, SM_IO_POSITIONAL, SM_IO_MMAP, SM_IO_DIRECT,
+                          SM_IO_COMPRESSED, SM_IO_MEMORY };
+    int numModes = (int) (sizeof(modes) / sizeof(modes[0]));
+    SM_IOMode defaultMode = getStorageIOMode();
+    PinWorker workers[8];
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+    testName = "test concurrent pins";
+
+    createDummyPages(8);
+    BM_BufferPool *bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 16, RS_LRU, NULL));
+    memset(workers, 0, sizeof(workers));
+    for (int i = 0; i < 8; i++) {
+        workers[i].bm = bm;
+        workers[i].numPages = 8;
+    }
+    runWorkers(workers, 8, readPages);
+    for (int i = 0; i < 8; i++)
+        ASSERT_EQUALS_INT(0, workers[i].errors, "every pin saw its page");
+    ASSERT_EQUALS_INT(8, getNumReadIO(bm), "each page is read once however many threads miss on it");
+    int *fixCounts = getFixCounts(bm);
+    int pinned = 0;
+    for (int i = 0; i < 16; i++)
+        pinned += fixCounts[i];
+    free(fixCounts);
+    ASSERT_EQUALS_INT(0, pinned, "no pin is left behind");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // forces wait for their sync without the pool latch, so forces from
+    // two threads join one group commit
+    SM_IOStats stats;
+    setStorageDurability(SM_DURABILITY_GROUP_COMMIT, 200000);
+    bm = MAKE_POOL();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 16, RS_LRU, NULL));
+    setStorageDurability(SM_DURABILITY_NONE, SM_DEFAULT_GROUP_INTERVAL_US);
+    TEST_CHECK(pinPage(bm, h, 0));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(forcePage(bm, h));
+    TEST_CHECK(getPoolStorageStats(bm, &stats));
+    int64_t syncsBefore = stats.syncs;
+    memset(workers, 0, sizeof(workers));
+    for (int i = 0; i < 2; i++) {
+        workers[i].bm = bm;
+        workers[i].numPages = i + 1;
+    }
+    runWorkers(workers, 2, forceOnePage);
+    for (int i = 0; i < 2; i++)
+        ASSERT_EQUALS_INT(0, workers[i].errors, "every force went through");
+    TEST_CHECK(getPoolStorageStats(bm, &stats));
+    ASSERT_EQUALS_INT(1, (int) (stats.syncs - syncsBefore), "concurrent forces share one sync");
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    // four threads update 32 pages through 6 frames, so most pins evict.
+    // The pages lie 40 apart, so misses keep growing the file while other
+    // threads read and write pages of it with the pool latch released
+    for (int m = 0; m < numModes; m++) {
+        setStorageIOMode(modes[m]);
+        TEST_CHECK(createPageFile(TESTPF));
+        bm = MAKE_POOL();
+        TEST_CHECK(initBufferPool(bm, TESTPF, 6, RS_CLOCK, NULL));
+        TEST_CHECK(startPageCleaner(bm, 3, 1));
+        memset(workers, 0, sizeof(workers));
+        for (int i = 0; i < 4; i++) {
+            workers[i].bm = bm;
+            workers[i].seed = (unsigned int) (i + 1 + 4 * m);
+            workers[i].numPages = 32;
+            workers[i].stride = 40;
+            workers[i].rounds = 2000;
+        }
+        runWorkers(workers, 4, bumpCounters);
+        for (int i = 0; i < 4; i++)
+            ASSERT_EQUALS_INT(0, workers[i].errors, "every update went through");
+        TEST_CHECK(shutdownBufferPool(bm));
+
+        bm = MAKE_POOL();
+        TEST_CHECK(initBufferPool(bm, TESTPF, 6, RS_FIFO, NULL));
+        int total = 0;
+        for (int p = 0; p < 32; p++) {
+            int count;
+            TEST_CHECK(pinPage(bm, h, p * 40));
+            memcpy(&count, h->data, sizeof(int));
+            total += count;
+            TEST_CHECK(unpinPage(bm, h));
+        }
+        ASSERT_EQUALS_INT(4 * 2000, total, "no update was lost");
+        TEST_CHECK(shutdownBufferPool(bm));
+        TEST_CHECK(destroyPageFile(TESTPF));
+    }
+    setStorageIOMode(defaultMode);
+
+    free(h);
+    TEST_DONE();
+}
+
+// Inserts one row into the record manager's open table and returns its page
+static PageNumber insertRow(RM_TableData *table, Record *record, int key) {
+    Value *value;
+    MAKE_INT_VALUE(value, key);
+    TEST_CHECK(setAttr(record, table->schema, 0, value));
+    freeVal(value);
+    TEST_CHECK(insertRecord(table, record));
+    return record->id.page;
+}
+
+// Freed pages go back to the file's free-page map and are handed out again,
+// by the pool and by the record manager once a page loses its last record
+void testPageReuse(void) {
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    PageNumber page;
+
+    testName = "test reuse of freed pages";
+
+    createDummyPages(6);
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+    TEST_CHECK(pinPage(bm, h, 2));
+    sprintf(h->data, "Stale-2");
+    TEST_CHECK(markDirty(bm, h));
+    ASSERT_ERROR(freePoolPage(bm, 2), "a pinned page cannot be freed");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(freePoolPage(bm, 2));
+    TEST_CHECK(freePoolPage(bm, 4));
+    bool *dirty = getDirtyFlags(bm);
+    int numDirty = 0;
+    for (int i = 0; i < 3; i++)
+        numDirty += dirty[i];
+    free(dirty);
+    ASSERT_EQUALS_INT(0, numDirty, "a freed page is not written back");
+
+    TEST_CHECK(allocatePoolPage(bm, &page));
+    ASSERT_EQUALS_INT(2, (int) page, "the lowest freed page is reused");
+    TEST_CHECK(pinPage(bm, h, page));
+    ASSERT_TRUE(h->data[0] == 0, "a reused page reads back as zeros");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(allocatePoolPage(bm, &page));
+    ASSERT_EQUALS_INT(4, (int) page, "the next freed page is reused");
+    TEST_CHECK(allocatePoolPage(bm, &page));
+    ASSERT_EQUALS_INT(6, (int) page, "the file grows once no page is free");
+    checkDummyPage(bm, h, 5);
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    // a data page emptied by deletes takes the next rows before the table grows.
+    // setAttr writes an int as five bytes, so a string column follows it
+    char **names = (char **) malloc(2 * sizeof(char *));
+    DataType *types = (DataType *) malloc(2 * sizeof(DataType));
+    int *lengths = (int *) malloc(2 * sizeof(int));
+    int *keys = (int *) malloc(sizeof(int));
+    names[0] = strdup("a");
+    names[1] = strdup("b");
+    types[0] = DT_INT;
+    types[1] = DT_STRING;
+    lengths[0] = 0;
+    lengths[1] = 4;
+    keys[0] = 0;
+    Schema *schema = createSchema(2, names, types, lengths, 1, keys);
+    RM_TableData table;
+    Record *record;
+    RID rids[1000];
+    int numRids = 0;
+
+    destroyPageFile(TESTTABLE);
+    TEST_CHECK(initRecordManager(NULL));
+    TEST_CHECK(createTable(TESTTABLE, schema));
+    TEST_CHECK(openTable(&table, TESTTABLE));
+    free(table.schema);
+    table.schema = schema;
+    TEST_CHECK(createRecord(&record, table.schema));
+
+    // fill the first data page and the one after it
+    int key = 0;
+    while ((page = insertRow(&table, record, key++)) == 2)
+        rids[numRids++] = record->id;
+    while ((page = insertRow(&table, record, key++)) == 3)
+        ;
+    ASSERT_EQUALS_INT(4, (int) page, "rows spill over to a third page");
+
+    for (int i = 0; i < numRids; i++)
+        TEST_CHECK(deleteRecord(&table, rids[i]));
+    while ((page = insertRow(&table, record, key++)) == 4)
+        ;
+    ASSERT_EQUALS_INT(2, (int) page, "the emptied page is reused");
+
+    TEST_CHECK(closeTable(&table));
+    freeRecord(record);
+    TEST_CHECK(shutdownRecordManager());
+    TEST_CHECK(deleteTable(TESTTABLE));
+
+    // directory entries keep page numbers of any size whole
+    PageDirectory *dir = createPageDirectoryNode((PageNumber) 5000000000LL);
+    char *entry = serializePageDirectory(dir);
+    ASSERT_TRUE(strstr(entry, "[0000000005000000000-000-000]") != NULL, "page past 2^32 in the directory");
+    free(entry);
+    free(dir);
+
+    free(h);
+    TEST_DONE();
+}
@@ -0,0 +1,1314 @@
+/************************************************************
+ *     File name:                test_storage_mgr.c
+ *     CS 525 Advanced Database Organization (Spring 2025)
+ *     Harlee Ramos, Jisun Yun, Baozhu Xie
+ ************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "storage_mgr.h"
+#include "storage_mgr_async.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// Test name
+char *testName;
+
+// Test output file
+#define TESTPF "test_pagefile.bin"
+
+// Prototypes for test functions
+static void testCreateOpenClose(void);
+static void testPageContentAllModes(void);
+static void testMmapZeroCopy(void);
+static void testBufferPoolModes(void);
+static void testAsyncQueue(void);
+static void testGrowthPolicy(void);
+static void testLargeFile(void);
+static void testFreePages(void);
+static void testCompressedPages(void);
+static void testPageSizes(void);
+static void testMemoryBackend(void);
+static void testDurability(void);
+static void testAccessHints(void);
+static void testFileCache(void);
+static void testStorageStats(void);
+
+int main(void) {
+    testName = "";
+
+    initStorageManager();
+
+    testCreateOpenClose();
+    testPageContentAllModes();
+    testMmapZeroCopy();
+    testBufferPoolModes();
+    testAsyncQueue();
+    testGrowthPolicy();
+    testLargeFile();
+    testFreePages();
+    testCompressedPages();
+    testPageSizes();
+    testMemoryBackend();
+    testDurability();
+    testAccessHints();
+    testFileCache();
+    testStorageStats();
+
+    return 0;
+}
+
+// Test creating, opening, and closing a page file with the default backend
+void testCreateOpenClose(void) {
+    SM_FileHandle fh;
+
+    testName = "test create, open, and close methods";
+
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_TRUE(strcmp(fh.fileName, TESTPF) == 0, "filename correct");
+    ASSERT_TRUE((fh.totalNumPages == 1), "expect 1 page in new file");
+    ASSERT_TRUE((fh.curPagePos == 0), "freshly opened file's page position should be 0");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    ASSERT_TRUE((openPageFile(TESTPF, &fh) != RC_OK), "opening non-existing file should return an error.");
+
+    TEST_DONE();
+}
+
+// Write pages through one backend and read them back through every backend
+void testPageContentAllModes(void) {
+    SM_IOMode modes[] = { SM_IO_STDIO, SM_IO_POSITIONAL, SM_IO_MMAP, SM_IO_DIRECT };
+    int numModes = (int) (sizeof(modes) / sizeof(modes[0]));
+    SM_FileHandle fh;
+    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+    int i, m, p;
+
+    testName = "test page content across I/O modes";
+
+    for (m = 0; m < numModes; m++) {
+        TEST_CHECK(createPageFile(TESTPF));
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        TEST_CHECK(ensureCapacity(4, &fh));
+        ASSERT_EQUALS_INT(4, (int) fh.totalNumPages, "ensureCapacity grows the file");
+        for (p = 0; p < 4; p++) {
+            for (i = 0; i < PAGE_SIZE; i++)
+                ph[i] = (char) ((i + p) % 10 + '0');
+            TEST_CHECK(writeBlock(p, &fh, ph));
+        }
+        TEST_CHECK(appendEmptyBlock(&fh));
+        TEST_CHECK(closePageFile(&fh));
+
+        for (int r = 0; r < numModes; r++) {
+            TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[r]));
+            ASSERT_EQUALS_INT(5, (int) fh.totalNumPages, "page count survives reopen");
+            for (p = 0; p < 4; p++) {
+                TEST_CHECK(readBlock(p, &fh, ph));
+                for (i = 0; i < PAGE_SIZE; i++) {
+                    if (ph[i] != (char) ((i + p) % 10 + '0'))
+                        break;
+                }
+                ASSERT_EQUALS_INT(PAGE_SIZE, i, "page read back with the bytes written");
+            }
+            TEST_CHECK(readLastBlock(&fh, ph));
+            for (i = 0; i < PAGE_SIZE && ph[i] == 0; i++)
+                ;
+            ASSERT_EQUALS_INT(PAGE_SIZE, i, "appended page is empty");
+            TEST_CHECK(closePageFile(&fh));
+        }
+        TEST_CHECK(destroyPageFile(TESTPF));
+    }
+
+    // a page cut short under a stdio handle reads its missing tail as zeros, as pread does
+    struct stat st;
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_STDIO));
+    TEST_CHECK(ensureCapacity(2, &fh));
+    memset(ph, 'y', PAGE_SIZE);
+    TEST_CHECK(writeBlock(1, &fh, ph));
+    TEST_CHECK(flushBlocks(1, 1, &fh));
+    ASSERT_TRUE(stat(TESTPF, &st) == 0, "stat the page file");
+    ASSERT_TRUE(truncate(TESTPF, st.st_size - PAGE_SIZE / 2) == 0, "cut the last page in half");
+    memset(ph, 'x', PAGE_SIZE);
+    TEST_CHECK(readBlock(1, &fh, ph));
+    ASSERT_TRUE(ph[0] == 'y' && ph[PAGE_SIZE / 2 - 1] == 'y', "bytes before the cut are read");
+    for (i = PAGE_SIZE / 2; i < PAGE_SIZE && ph[i] == 0; i++)
+        ;
+    ASSERT_EQUALS_INT(PAGE_SIZE, i, "bytes past the cut read as zeros");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Page pointers from a mapping see writes and stay valid as the file grows
+void testMmapZeroCopy(void) {
+    SM_FileHandle fh;
+    SM_PageHandle first, far;
+    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+    int farPage = 20000;  // beyond the first 64 MB mapping segment
+
+    testName = "test zero-copy page pointers";
+
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_MMAP));
+    ASSERT_TRUE(getFileIOMode(&fh) == SM_IO_MMAP, "handle reports mmap mode");
+
+    TEST_CHECK(getPagePointer(0, &fh, &first));
+    strcpy(first, "written in place");
+
+    TEST_CHECK(ensureCapacity(farPage + 1, &fh));
+    TEST_CHECK(getPagePointer(farPage, &fh, &far));
+    strcpy(far, "far page");
+    ASSERT_EQUALS_STRING("written in place", first, "pointer still valid after growth");
+    ASSERT_ERROR(getPagePointer(farPage + 1, &fh, &far), "pointer past end of file is rejected");
+
+    TEST_CHECK(flushBlocks(0, fh.totalNumPages, &fh));
+    TEST_CHECK(closePageFile(&fh));
+
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_POSITIONAL));
+    ASSERT_EQUALS_INT(farPage + 1, (int) fh.totalNumPages, "grown size persisted");
+    ASSERT_ERROR(getPagePointer(0, &fh, &first), "no page pointers without a mapping");
+    TEST_CHECK(readBlock(0, &fh, ph));
+    ASSERT_EQUALS_STRING("written in place", ph, "in-place write reached the file");
+    TEST_CHECK(readBlock(farPage, &fh, ph));
+    ASSERT_EQUALS_STRING("far page", ph, "write to new segment reached the file");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Buffer pools over mapped and direct-I/O files round-trip page edits
+void testBufferPoolModes(void) {
+    SM_IOMode modes[] = { SM_IO_MMAP, SM_IO_DIRECT };
+    SM_FileHandle fh;
+    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+    testName = "test buffer pool over mmap and direct I/O";
+
+    for (int m = 0; m < 2; m++) {
+        BM_BufferPool *bm = MAKE_POOL();
+        BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+        TEST_CHECK(createPageFile(TESTPF));
+        setStorageIOMode(modes[m]);
+        TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+        for (int i = 0; i < 5; i++) {
+            TEST_CHECK(pinPage(bm, h, i));
+            ASSERT_TRUE(((size_t) h->data % SM_IO_ALIGNMENT) == 0, "frame data is aligned");
+            sprintf(h->data, "Page-%i", i);
+            TEST_CHECK(markDirty(bm, h));
+            TEST_CHECK(unpinPage(bm, h));
+        }
+        TEST_CHECK(shutdownBufferPool(bm));
+        setStorageIOMode(SM_IO_POSITIONAL);
+
+        TEST_CHECK(openPageFile(TESTPF, &fh));
+        for (int i = 0; i < 5; i++) {
+            char expected[16];
+            sprintf(expected, "Page-%i", i);
+            TEST_CHECK(readBlock(i, &fh, ph));
+            ASSERT_EQUALS_STRING(expected, ph, "page edited through the pool reached the file");
+        }
+        TEST_CHECK(closePageFile(&fh));
+        TEST_CHECK(destroyPageFile(TESTPF));
+        free(h);
+    }
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Requests beyond the queue depth complete, in any order, with the right data
+void testAsyncQueue(void) {
+    SM_IOMode modes[] = { SM_IO_POSITIONAL, SM_IO_DIRECT, SM_IO_STDIO };
+    SM_AsyncBackend backends[] = { SM_ASYNC_AUTO, SM_ASYNC_THREADS };
+    SM_FileHandle fh;
+    SM_AsyncQueue *queue;
+    SM_AsyncRequest requests[16];
+    SM_AsyncRequest *done[16];
+    SM_PageHandle bufs[64];
+    char *arena;
+    int numDone;
+
+    testName = "test asynchronous page I/O queue";
+
+    ASSERT_TRUE(posix_memalign((void **) &arena, SM_IO_ALIGNMENT, 64 * PAGE_SIZE) == 0, "arena allocated");
+    for (int i = 0; i < 64; i++)
+        bufs[i] = arena + (size_t) i * PAGE_SIZE;
+
+    for (int m = 0; m < 3; m++) {
+        for (int b = 0; b < 2; b++) {
+            TEST_CHECK(createPageFile(TESTPF));
+            TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+            TEST_CHECK(ensureCapacity(64, &fh));
+            TEST_CHECK(createAsyncQueue(&fh, 4, backends[b], &queue));
+            if (backends[b] == SM_ASYNC_THREADS || modes[m] == SM_IO_STDIO)
+                ASSERT_EQUALS_INT(SM_ASYNC_THREADS, getAsyncBackend(queue), "thread pool backend in use");
+
+            TEST_CHECK(pollAsync(queue, done, 16, &numDone));
+            ASSERT_EQUALS_INT(0, numDone, "nothing completes before a submit");
+
+            // 16 writes of 4 pages each through a queue that holds 4
+            for (int i = 0; i < 64; i++) {
+                memset(bufs[i], 0, PAGE_SIZE);
+                sprintf(bufs[i], "Async-%i", i);
+            }
+            for (int r = 0; r < 16; r++) {
+                memset(&requests[r], 0, sizeof(SM_AsyncRequest));
+                requests[r].op = SM_ASYNC_WRITE;
+                requests[r].pageNum = r * 4;
+                requests[r].numPages = 4;
+                requests[r].bufs = &bufs[r * 4];
+                TEST_CHECK(submitAsync(queue, &requests[r]));
+                ASSERT_TRUE(getAsyncInFlight(queue) <= 4, "in-flight requests bounded by depth");
+            }
+            TEST_CHECK(waitAsync(queue, done, 16, 16, &numDone));
+            ASSERT_TRUE(numDone > 0 && getAsyncInFlight(queue) == 0, "all writes finished");
+            for (int r = 0; r < 16; r++)
+                ASSERT_EQUALS_INT(RC_OK, requests[r].result, "write request succeeded");
+
+            // read everything back as 8 runs of 8 pages
+            memset(arena, 0, 64 * PAGE_SIZE);
+            for (int r = 0; r < 8; r++) {
+                memset(&requests[r], 0, sizeof(SM_AsyncRequest));
+                requests[r].op = SM_ASYNC_READ;
+                requests[r].pageNum = r * 8;
+                requests[r].numPages = 8;
+                requests[r].bufs = &bufs[r * 8];
+                TEST_CHECK(submitAsync(queue, &requests[r]));
+            }
+            int collected = 0;
+            while (collected < 8) {
+                TEST_CHECK(waitAsync(queue, done, 1, 16, &numDone));
+                for (int i = 0; i < numDone; i++)
+                    ASSERT_EQUALS_INT(RC_OK, done[i]->result, "read request succeeded");
+                collected += numDone;
+            }
+            for (int i = 0; i < 64; i++) {
+                char expected[16];
+                sprintf(expected, "Async-%i", i);
+                ASSERT_EQUALS_STRING(expected, bufs[i], "asynchronous read returned the page");
+            }
+
+            requests[0].pageNum = 62;
+            ASSERT_ERROR(submitAsync(queue, &requests[0]), "request past end of file rejected");
+
+            TEST_CHECK(destroyAsyncQueue(queue));
+            TEST_CHECK(closePageFile(&fh));
+            TEST_CHECK(destroyPageFile(TESTPF));
+        }
+    }
+
+    // io_uring needs a descriptor-based file
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_STDIO));
+    ASSERT_ERROR(createAsyncQueue(&fh, 4, SM_ASYNC_IO_URING, &queue), "io_uring refused for stdio files");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(arena);
+    TEST_DONE();
+}
+
+// Growth reserves space ahead per policy while the file size stays exact
+void testGrowthPolicy(void) {
+    SM_IOMode modes[] = { SM_IO_POSITIONAL, SM_IO_STDIO, SM_IO_MMAP };
+    SM_FileHandle fh, other;
+    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+    struct stat st;
+
+    testName = "test file growth policies";
+
+    for (int m = 0; m < 3; m++) {
+        TEST_CHECK(createPageFile(TESTPF));
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        ASSERT_EQUALS_INT(1, (int) getReservedPages(&fh), "nothing reserved beyond the file");
+
+        TEST_CHECK(setFileGrowthPolicy(&fh, SM_GROW_CHUNK, 64));
+        TEST_CHECK(appendEmptyBlock(&fh));
+        ASSERT_EQUALS_INT(2, (int) fh.totalNumPages, "append adds exactly one page");
+        ASSERT_EQUALS_INT(64, (int) getReservedPages(&fh), "chunk policy reserves 64 pages");
+        for (int i = 0; i < 70; i++)
+            TEST_CHECK(appendEmptyBlock(&fh));
+        ASSERT_EQUALS_INT(72, (int) fh.totalNumPages, "appends within and past the chunk");
+        ASSERT_EQUALS_INT(128, (int) getReservedPages(&fh), "second chunk reserved");
+
+        TEST_CHECK(setFileGrowthPolicy(&fh, SM_GROW_PERCENT, 50));
+        TEST_CHECK(ensureCapacity(200, &fh));
+        ASSERT_EQUALS_INT(300, (int) getReservedPages(&fh), "percent policy reserves half again");
+
+        TEST_CHECK(setFileGrowthPolicy(&fh, SM_GROW_EXACT, 0));
+        TEST_CHECK(ensureCapacity(301, &fh));
+        ASSERT_EQUALS_INT(301, (int) getReservedPages(&fh), "exact policy reserves only what is asked");
+
+        // the new pages exist, read as zeros, and hold writes
+        memset(ph, 'x', PAGE_SIZE);
+        TEST_CHECK(readBlock(250, &fh, ph));
+        for (int i = 0; i < PAGE_SIZE; i++)
+            if (ph[i] != 0) {
+                ASSERT_TRUE(false, "grown page is zero-filled");
+                break;
+            }
+        sprintf(ph, "Page-300");
+        TEST_CHECK(writeBlock(300, &fh, ph));
+        TEST_CHECK(closePageFile(&fh));
+
+        ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == (1 + 301L) * PAGE_SIZE, "file size is the header plus the page count");
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        ASSERT_EQUALS_INT(301, (int) fh.totalNumPages, "page count survives reopen");
+        TEST_CHECK(readBlock(300, &fh, ph));
+        ASSERT_EQUALS_STRING("Page-300", ph, "last page content survives reopen");
+        TEST_CHECK(closePageFile(&fh));
+        TEST_CHECK(destroyPageFile(TESTPF));
+    }
+
+    // the reservation is the file's, not a handle's: a handle that reserved
+    // space and closes never releases pages another handle has grown into
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(openPageFile(TESTPF, &other));
+    TEST_CHECK(setFileGrowthPolicy(&fh, SM_GROW_CHUNK, 64));
+    TEST_CHECK(appendEmptyBlock(&fh));
+    TEST_CHECK(ensureCapacity(40, &other));
+    ASSERT_EQUALS_INT(64, (int) getReservedPages(&other), "handles share the reservation");
+    sprintf(ph, "Page-39");
+    TEST_CHECK(writeBlock(39, &other, ph));
+    TEST_CHECK(ensureCapacity(10, &fh));
+    ASSERT_EQUALS_INT(40, (int) fh.totalNumPages, "a lagging handle catches up instead of truncating");
+    TEST_CHECK(closePageFile(&fh));
+    memset(ph, 0, PAGE_SIZE);
+    TEST_CHECK(readBlock(39, &other, ph));
+    ASSERT_EQUALS_STRING("Page-39", ph, "page survives the close of the handle that reserved it");
+    TEST_CHECK(closePageFile(&other));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(40, (int) getReservedPages(&fh), "reservation released on the last close");
+    TEST_CHECK(readBlock(39, &fh, ph));
+    ASSERT_EQUALS_STRING("Page-39", ph, "page survives the last close");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Pages past the 2 GB and 4 GB offsets of a sparse file are addressable
+void testLargeFile(void) {
+    SM_IOMode modes[] = { SM_IO_POSITIONAL, SM_IO_STDIO, SM_IO_MMAP, SM_IO_DIRECT };
+    const PageNumber numPages = (PageNumber) 5 * 1024 * 1024 * 1024 / PAGE_SIZE;  // 5 GB
+    const PageNumber far[] = { 524287, 524288, 600000, 1048576, numPages - 1 };
+    SM_FileHandle fh;
+    SM_PageHandle bufs[2];
+    char *arena;
+    struct stat st;
+
+    testName = "test sparse page file larger than 2 GB";
+
+    ASSERT_TRUE(posix_memalign((void **) &arena, SM_IO_ALIGNMENT, 2 * PAGE_SIZE) == 0, "arena allocated");
+    bufs[0] = arena;
+    bufs[1] = arena + PAGE_SIZE;
+
+    for (int m = 0; m < 4; m++) {
+        TEST_CHECK(createPageFile(TESTPF));
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        TEST_CHECK(setFileGrowthPolicy(&fh, SM_GROW_EXACT, 0));
+        TEST_CHECK(ensureCapacity(numPages, &fh));
+        ASSERT_TRUE(fh.totalNumPages == numPages, "file grew to 5 GB of pages");
+
+        for (int i = 0; i < 5; i++) {
+            memset(bufs[0], 0, PAGE_SIZE);
+            sprintf(bufs[0], "Page-%lld", (long long) far[i]);
+            TEST_CHECK(writeBlock(far[i], &fh, bufs[0]));
+        }
+        TEST_CHECK(closePageFile(&fh));
+
+        ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == (off_t) (numPages + 1) * PAGE_SIZE,
+                    "file size past 4 GB");
+        ASSERT_TRUE((long long) st.st_blocks * 512 < 64LL * 1024 * 1024, "file stays sparse");
+
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        ASSERT_TRUE(fh.totalNumPages == numPages, "page count past 2^31 bytes survives reopen");
+        for (int i = 0; i < 5; i++) {
+            char expected[32];
+            sprintf(expected, "Page-%lld", (long long) far[i]);
+            TEST_CHECK(readBlock(far[i], &fh, bufs[0]));
+            ASSERT_EQUALS_STRING(expected, bufs[0], "page past 2 GB reads back");
+        }
+        // one vectored read straddling the 2 GB offset
+        TEST_CHECK(readBlocks(524287, 2, &fh, bufs));
+        ASSERT_EQUALS_STRING("Page-524287", bufs[0], "page before 2 GB in straddling read");
+        ASSERT_EQUALS_STRING("Page-524288", bufs[1], "page after 2 GB in straddling read");
+        TEST_CHECK(readLastBlock(&fh, bufs[0]));
+        ASSERT_TRUE(getBlockPos(&fh) == numPages - 1, "position past 2^31 bytes");
+        sprintf(bufs[0], "Current-last");
+        TEST_CHECK(writeCurrentBlock(&fh, bufs[0]));
+        TEST_CHECK(readBlock(numPages - 1, &fh, bufs[1]));
+        ASSERT_EQUALS_STRING("Current-last", bufs[1], "current block past 2^31 bytes written in place");
+        TEST_CHECK(closePageFile(&fh));
+        TEST_CHECK(destroyPageFile(TESTPF));
+    }
+
+    // the buffer pool addresses the same pages
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+    TEST_CHECK(pinPage(bm, h, numPages - 1));
+    ASSERT_TRUE(h->pageNum == numPages - 1, "pinned page number is 64-bit");
+    sprintf(h->data, "Pool-last");
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_TRUE(fh.totalNumPages == numPages, "pool grew the file to 5 GB");
+    TEST_CHECK(readBlock(numPages - 1, &fh, bufs[0]));
+    ASSERT_EQUALS_STRING("Pool-last", bufs[0], "pool wrote the page past 4 GB");
+    TEST_CHECK(closePageFile(&fh));
+    ASSERT_TRUE(stat(TESTPF, &st) == 0 && (long long) st.st_blocks * 512 < 256LL * 1024 * 1024,
+                "pool growth stays mostly sparse");
+    TEST_CHECK(destroyPageFile(TESTPF));
+    free(h);
+
+    free(arena);
+    TEST_DONE();
+}
+
+// Freed pages are reused lowest first, survive reopen, and trailing ones are truncated
+void testFreePages(void) {
+    SM_IOMode modes[] = { SM_IO_POSITIONAL, SM_IO_STDIO, SM_IO_MMAP };
+    SM_FileHandle fh, other;
+    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+    PageNumber page;
+    struct stat st;
+
+    testName = "test free-page map and page reuse";
+
+    for (int m = 0; m < 3; m++) {
+        TEST_CHECK(createPageFile(TESTPF));
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        TEST_CHECK(ensureCapacity(10, &fh));
+        for (int i = 0; i < 10; i++) {
+            sprintf(ph, "Page-%i", i);
+            TEST_CHECK(writeBlock(i, &fh, ph));
+        }
+
+        TEST_CHECK(freePage(&fh, 7));
+        TEST_CHECK(freePage(&fh, 3));
+        TEST_CHECK(freePage(&fh, 5));
+        ASSERT_EQUALS_INT(RC_PAGE_ALREADY_FREE, freePage(&fh, 5), "double free is rejected");
+        ASSERT_ERROR(freePage(&fh, 10), "page past end of file cannot be freed");
+        ASSERT_EQUALS_INT(3, (int) getFreePageCount(&fh), "three free pages");
+        TEST_CHECK(closePageFile(&fh));
+
+        // the map is persistent
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        ASSERT_EQUALS_INT(3, (int) getFreePageCount(&fh), "free pages survive reopen");
+        TEST_CHECK(allocatePage(&fh, &page));
+        ASSERT_EQUALS_INT(3, (int) page, "lowest hole reused first");
+        TEST_CHECK(readBlock(3, &fh, ph));
+        ASSERT_TRUE(ph[0] == 0 && ph[PAGE_SIZE - 1] == 0, "reused page is zero-filled");
+        TEST_CHECK(allocatePage(&fh, &page));
+        ASSERT_EQUALS_INT(5, (int) page, "next hole reused");
+        TEST_CHECK(allocatePage(&fh, &page));
+        ASSERT_EQUALS_INT(7, (int) page, "last hole reused");
+        ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "no growth while holes exist");
+        TEST_CHECK(allocatePage(&fh, &page));
+        ASSERT_EQUALS_INT(10, (int) page, "file grows once holes are used up");
+        ASSERT_EQUALS_INT(11, (int) fh.totalNumPages, "one page appended");
+        TEST_CHECK(readBlock(9, &fh, ph));
+        ASSERT_EQUALS_STRING("Page-9", ph, "pages in use are untouched");
+
+        // free pages at the end of the file are cut off, except from a
+        // mapping, whose page pointers must stay valid
+        if (modes[m] == SM_IO_MMAP) {
+            SM_PageHandle mapped;
+            TEST_CHECK(getPagePointer(10, &fh, &mapped));
+            TEST_CHECK(freePage(&fh, 10));
+            ASSERT_EQUALS_INT(11, (int) fh.totalNumPages, "mapped file is not truncated");
+            ASSERT_TRUE(mapped[0] == 0, "pointer to a freed page stays readable");
+            ASSERT_EQUALS_INT(1, (int) getFreePageCount(&fh), "trailing page stays in the map");
+            TEST_CHECK(allocatePage(&fh, &page));
+            ASSERT_EQUALS_INT(10, (int) page, "trailing free page reused");
+            TEST_CHECK(closePageFile(&fh));
+            TEST_CHECK(destroyPageFile(TESTPF));
+            continue;
+        }
+        TEST_CHECK(freePage(&fh, 10));
+        ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "last page truncated");
+        TEST_CHECK(freePage(&fh, 7));
+        TEST_CHECK(freePage(&fh, 9));
+        ASSERT_EQUALS_INT(9, (int) fh.totalNumPages, "trailing free page truncated");
+        TEST_CHECK(freePage(&fh, 8));
+        ASSERT_EQUALS_INT(7, (int) fh.totalNumPages, "run of trailing free pages truncated");
+        ASSERT_EQUALS_INT(0, (int) getFreePageCount(&fh), "truncated pages are not free pages");
+        TEST_CHECK(closePageFile(&fh));
+        ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == (1 + 7L) * PAGE_SIZE, "file is compact");
+
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        ASSERT_EQUALS_INT(7, (int) fh.totalNumPages, "compacted size survives reopen");
+        ASSERT_EQUALS_INT(0, (int) getFreePageCount(&fh), "no stale free pages after reopen");
+        TEST_CHECK(closePageFile(&fh));
+
+        TEST_CHECK(destroyPageFile(TESTPF));
+        ASSERT_TRUE(stat(TESTPF ".fsm", &st) != 0, "destroy removes the free-page map");
+    }
+
+    // handles on one file share its map, even one that has not seen the file grow
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(openPageFile(TESTPF, &other));
+    TEST_CHECK(ensureCapacity(6, &fh));
+    TEST_CHECK(freePage(&fh, 2));
+    ASSERT_EQUALS_INT(1, (int) getFreePageCount(&other), "other handle sees the free page");
+    TEST_CHECK(allocatePage(&other, &page));
+    ASSERT_EQUALS_INT(2, (int) page, "page freed through one handle reused through the other");
+    TEST_CHECK(allocatePage(&fh, &page));
+    ASSERT_EQUALS_INT(6, (int) page, "a reused page is not handed out twice");
+    TEST_CHECK(freePage(&other, 4));
+
+    // a file open through two handles is not truncated under either
+    TEST_CHECK(freePage(&fh, 6));
+    ASSERT_EQUALS_INT(7, (int) fh.totalNumPages, "shared file keeps its size");
+    ASSERT_EQUALS_INT(2, (int) getFreePageCount(&fh), "trailing page stays in the map");
+    TEST_CHECK(allocatePage(&fh, &page));
+    ASSERT_EQUALS_INT(4, (int) page, "lowest free page reused first");
+    TEST_CHECK(allocatePage(&fh, &page));
+    ASSERT_EQUALS_INT(6, (int) page, "trailing free page reused");
+    TEST_CHECK(freePage(&other, 4));
+    TEST_CHECK(closePageFile(&other));
+    TEST_CHECK(closePageFile(&fh));
+    flushFileCache();
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(7, (int) fh.totalNumPages, "pages of both handles survive reopen");
+    ASSERT_EQUALS_INT(1, (int) getFreePageCount(&fh), "frees of both handles survive reopen");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Fills ph with the content expected on page p of the compressed test file
+static void fillCompressedPage(SM_PageHandle ph, int p) {
+    memset(ph, 0, PAGE_SIZE);
+    if (p % 8 == 7)
+        return;                     // zero page
+    if (p % 8 == 5) {
+        unsigned int x = 2463534242u + (unsigned int) p;
+        for (int i = 0; i < PAGE_SIZE; i++) {   // incompressible noise
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            ph[i] = (char) x;
+        }
+        return;
+    }
+    for (int r = 0; r < PAGE_SIZE / 64; r++)    // fixed-width records
+        sprintf(ph + r * 64, "customer-%05d|city-%03d|", p * 64 + r, r % 7);
+}
+
+// Compressed files round-trip every kind of page, take less space, and work under a pool
+void testCompressedPages(void) {
+    SM_FileHandle fh, other;
+    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+    SM_PageHandle expected = (SM_PageHandle) malloc(PAGE_SIZE);
+    SM_PageHandle bufs[64];
+    struct stat st;
+    int p;
+
+    testName = "test compressed page files";
+
+    setStorageIOMode(SM_IO_COMPRESSED);
+    TEST_CHECK(createPageFile(TESTPF));
+    setStorageIOMode(SM_IO_POSITIONAL);
+
+    // the header decides the mode, whatever the caller asks for
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_STDIO));
+    ASSERT_EQUALS_INT(SM_IO_COMPRESSED, getFileIOMode(&fh), "compressed file recognised");
+    ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "expect 1 page in new file");
+    TEST_CHECK(readBlock(0, &fh, ph));
+    ASSERT_TRUE(ph[0] == 0 && ph[PAGE_SIZE - 1] == 0, "first page is empty");
+
+    TEST_CHECK(ensureCapacity(64, &fh));
+    for (p = 0; p < 64; p++) {
+        fillCompressedPage(ph, p);
+        TEST_CHECK(writeBlock(p, &fh, ph));
+    }
+    // a page that stops compressing moves to a new extent, one that shrinks stays put
+    fillCompressedPage(ph, 5);
+    TEST_CHECK(writeBlock(2, &fh, ph));
+    fillCompressedPage(ph, 2);
+    TEST_CHECK(writeBlock(5, &fh, ph));
+    TEST_CHECK(closePageFile(&fh));
+    ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size < 32L * PAGE_SIZE, "compressed file is smaller");
+
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(64, (int) fh.totalNumPages, "page count survives reopen");
+    for (p = 0; p < 64; p++)
+        bufs[p] = (SM_PageHandle) malloc(PAGE_SIZE);
+    TEST_CHECK(readBlocks(0, 64, &fh, bufs));
+    for (p = 0; p < 64; p++) {
+        fillCompressedPage(expected, p == 2 ? 5 : p == 5 ? 2 : p);
+        ASSERT_TRUE(memcmp(expected, bufs[p], PAGE_SIZE) == 0, "page read back with the bytes written");
+        TEST_CHECK(readBlock(p, &fh, ph));
+        ASSERT_TRUE(memcmp(expected, ph, PAGE_SIZE) == 0, "single page read matches");
+    }
+    TEST_CHECK(freePage(&fh, 63));
+    ASSERT_EQUALS_INT(63, (int) fh.totalNumPages, "trailing free page dropped");
+    TEST_CHECK(closePageFile(&fh));
+
+    // the buffer manager works on top of the compressed layer
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU, NULL));
+    for (p = 60; p < 70; p++) {
+        TEST_CHECK(pinPage(bm, h, p));
+        sprintf(h->data, "Page-%i", p);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+    free(h);
+
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(70, (int) fh.totalNumPages, "pool grew the file");
+    for (p = 60; p < 70; p++) {
+        char name[16];
+        sprintf(name, "Page-%i", p);
+        TEST_CHECK(readBlock(p, &fh, ph));
+        ASSERT_EQUALS_STRING(name, ph, "page edited through the pool reached the file");
+    }
+    TEST_CHECK(closePageFile(&fh));
+
+    // handles share the extent table: extents never overlap and no close drops pages
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(openPageFile(TESTPF, &other));
+    fillCompressedPage(ph, 1);
+    TEST_CHECK(writeBlock(60, &fh, ph));
+    TEST_CHECK(appendEmptyBlock(&other));
+    fillCompressedPage(ph, 3);
+    TEST_CHECK(writeBlock(70, &other, ph));
+    TEST_CHECK(closePageFile(&other));
+    TEST_CHECK(closePageFile(&fh));
+    flushFileCache();
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(71, (int) fh.totalNumPages, "page appended through the other handle kept");
+    fillCompressedPage(expected, 1);
+    TEST_CHECK(readBlock(60, &fh, ph));
+    ASSERT_TRUE(memcmp(expected, ph, PAGE_SIZE) == 0, "page written through one handle intact");
+    fillCompressedPage(expected, 3);
+    TEST_CHECK(readBlock(70, &fh, ph));
+    ASSERT_TRUE(memcmp(expected, ph, PAGE_SIZE) == 0, "page written through the other handle intact");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    // uncompressed files cannot be opened compressed
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_COMPRESSED));
+    ASSERT_EQUALS_INT(SM_IO_POSITIONAL, getFileIOMode(&fh), "plain file opened positionally");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    for (p = 0; p < 64; p++)
+        free(bufs[p]);
+    free(expected);
+    free(ph);
+    TEST_DONE();
+}
+
+// Files keep the page size they were created with, in every mode and through a pool
+void testPageSizes(void) {
+    SM_IOMode modes[] = { SM_IO_STDIO, SM_IO_POSITIONAL, SM_IO_MMAP, SM_IO_DIRECT };
+    int sizes[] = { 16384, 65536 };
+    SM_FileHandle fh;
+    SM_AsyncQueue *queue;
+    SM_AsyncRequest request, *done;
+    SM_PageHandle bufs[4];
+    struct stat st;
+    char *arena;
+    int numDone;
+
+    testName = "test per-file page sizes";
+
+    ASSERT_EQUALS_INT(RC_PARAMS_ERROR, setStoragePageSize(3000), "page size must be a power of two");
+    ASSERT_EQUALS_INT(RC_PARAMS_ERROR, createPageFileWithPageSize(TESTPF, 2 * SM_MAX_PAGE_SIZE),
+                      "page size above the maximum rejected");
+    ASSERT_TRUE(posix_memalign((void **) &arena, SM_IO_ALIGNMENT, 4 * SM_MAX_PAGE_SIZE) == 0, "arena allocated");
+
+    for (int z = 0; z < 2; z++) {
+        int pageSize = sizes[z];
+        for (int i = 0; i < 4; i++)
+            bufs[i] = arena + (size_t) i * pageSize;
+
+        for (int m = 0; m < 4; m++) {
+            TEST_CHECK(createPageFileWithPageSize(TESTPF, pageSize));
+            TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+            ASSERT_EQUALS_INT(pageSize, fh.pageSize, "handle reports the file's page size");
+            ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "expect 1 page in new file");
+            TEST_CHECK(ensureCapacity(4, &fh));
+            for (int p = 0; p < 4; p++) {
+                memset(bufs[p], 'a' + p, pageSize);
+                TEST_CHECK(writeBlock(p, &fh, bufs[p]));
+            }
+            TEST_CHECK(closePageFile(&fh));
+            ASSERT_TRUE(stat(TESTPF, &st) == 0 && st.st_size == 5L * pageSize, "header page plus 4 pages");
+
+            // read back through the next mode
+            memset(arena, 0, 4 * (size_t) pageSize);
+            TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[(m + 1) % 4]));
+            ASSERT_EQUALS_INT(pageSize, fh.pageSize, "page size survives reopen");
+            TEST_CHECK(readBlocks(0, 4, &fh, bufs));
+            for (int p = 0; p < 4; p++)
+                ASSERT_TRUE(bufs[p][0] == 'a' + p && bufs[p][pageSize - 1] == 'a' + p, "whole page read back");
+            TEST_CHECK(closePageFile(&fh));
+            TEST_CHECK(destroyPageFile(TESTPF));
+        }
+    }
+
+    // the async queue addresses pages past the header
+    TEST_CHECK(createPageFileWithPageSize(TESTPF, 16384));
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_DIRECT));
+    TEST_CHECK(ensureCapacity(4, &fh));
+    for (int p = 0; p < 4; p++) {
+        bufs[p] = arena + (size_t) p * 16384;
+        memset(bufs[p], '0' + p, 16384);
+    }
+    TEST_CHECK(writeBlocks(0, 4, &fh, bufs));
+    memset(arena, 0, 4 * 16384);
+    TEST_CHECK(createAsyncQueue(&fh, 2, SM_ASYNC_AUTO, &queue));
+    memset(&request, 0, sizeof(request));
+    request.op = SM_ASYNC_READ;
+    request.pageNum = 2;
+    request.numPages = 2;
+    request.bufs = bufs;
+    TEST_CHECK(submitAsync(queue, &request));
+    TEST_CHECK(waitAsync(queue, &done, 1, 1, &numDone));
+    TEST_CHECK(request.result);
+    ASSERT_TRUE(bufs[0][0] == '2' && bufs[1][16383] == '3', "asynchronous read of large pages");
+    TEST_CHECK(destroyAsyncQueue(queue));
+    TEST_CHECK(closePageFile(&fh));
+
+    // a pool over the file sizes its frames from it
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 2, RS_FIFO, NULL));
+    ASSERT_EQUALS_INT(16384, getPoolPageSize(bm), "frames are as large as the file's pages");
+    for (int p = 3; p < 6; p++) {
+        TEST_CHECK(pinPage(bm, h, p));
+        h->data[16383] = (char) ('A' + p);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    // the page dump covers the whole large page, ending with its last byte
+    TEST_CHECK(pinPage(bm, h, 5));
+    char *dump = sprintPageContent(bm, h);
+    ASSERT_TRUE(dump != NULL, "dump a large page");
+    size_t dumpLen = strlen(dump);
+    ASSERT_EQUALS_INT(9 + 2 * 16384 + 16384 / 8 + 16384 / 64, (int) dumpLen, "dump covers every byte of the page");
+    ASSERT_TRUE(strcmp(dump + dumpLen - 4, "46 \n") == 0, "dump ends with the page's last byte");
+    free(dump);
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownBufferPool(bm));
+    free(h);
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    for (int p = 3; p < 6; p++) {
+        TEST_CHECK(readBlock(p, &fh, bufs[0]));
+        ASSERT_TRUE(bufs[0][16383] == 'A' + p, "last byte of a large page written through the pool");
+    }
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    // compressed files record their page size too
+    TEST_CHECK(setStoragePageSize(16384));
+    setStorageIOMode(SM_IO_COMPRESSED);
+    TEST_CHECK(createPageFile(TESTPF));
+    setStorageIOMode(SM_IO_POSITIONAL);
+    TEST_CHECK(setStoragePageSize(PAGE_SIZE));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(16384, fh.pageSize, "compressed file page size");
+    TEST_CHECK(ensureCapacity(2, &fh));
+    memset(bufs[0], 'z', 16384);
+    TEST_CHECK(writeBlock(1, &fh, bufs[0]));
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    memset(bufs[0], 0, 16384);
+    TEST_CHECK(readBlock(1, &fh, bufs[0]));
+    ASSERT_TRUE(bufs[0][0] == 'z' && bufs[0][16383] == 'z', "compressed large page read back");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    // files without a header still open, as PAGE_SIZE pages from offset 0
+    FILE *fp = fopen(TESTPF, "w");
+    memset(arena, 0, 2 * PAGE_SIZE);
+    strcpy(arena + PAGE_SIZE, "Headerless-1");
+    ASSERT_TRUE(fp != NULL && fwrite(arena, 1, 2 * PAGE_SIZE, fp) == 2 * PAGE_SIZE, "raw file written");
+    fclose(fp);
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "headerless file uses the default page size");
+    ASSERT_EQUALS_INT(2, (int) fh.totalNumPages, "every page of a headerless file is data");
+    TEST_CHECK(readBlock(1, &fh, bufs[0]));
+    ASSERT_EQUALS_STRING("Headerless-1", bufs[0], "headerless page read at its old offset");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(arena);
+    TEST_DONE();
+}
+
+// In-memory page files never reach disk and keep their pages until destroyed
+void testMemoryBackend(void) {
+    SM_FileHandle fh, other, gone;
+    SM_PageHandle bufs[4];
+    SM_PageHandle ptr;
+    PageNumber page;
+    struct stat st;
+    char *arena = (char *) malloc(4 * PAGE_SIZE);
+    int i;
+
+    testName = "test in-memory page files";
+
+    setStorageIOMode(SM_IO_MEMORY);
+    TEST_CHECK(createPageFile(TESTPF));
+    setStorageIOMode(SM_IO_POSITIONAL);
+    ASSERT_TRUE(stat(TESTPF, &st) != 0, "no file is created on disk");
+    ASSERT_TRUE(pageFileExists(TESTPF), "in-memory file exists by name");
+
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_TRUE(getFileIOMode(&fh) == SM_IO_MEMORY, "in-memory file opens in memory mode");
+    ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "new in-memory file has one page");
+    ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "default page size");
+    ASSERT_EQUALS_INT(-1, getFileDescriptor(&fh), "no descriptor behind an in-memory file");
+    ASSERT_TRUE(getPageOffset(&fh, 0) == -1, "no file offsets either");
+
+    // grow across several allocation chunks and write runs of pages
+    TEST_CHECK(ensureCapacity(200, &fh));
+    for (i = 0; i < 4; i++)
+        bufs[i] = arena + (size_t) i * PAGE_SIZE;
+    for (page = 0; page < 200; page += 4) {
+        for (i = 0; i < 4; i++)
+            sprintf(bufs[i], "mem-%d", (int) page + i);
+        TEST_CHECK(writeBlocks(page, 4, &fh, bufs));
+    }
+    TEST_CHECK(getPagePointer(150, &fh, &ptr));
+    ASSERT_EQUALS_STRING("mem-150", ptr, "page pointer sees written data");
+    strcpy(ptr, "edited in place");
+    TEST_CHECK(ensureCapacity(1000, &fh));
+    ASSERT_EQUALS_STRING("edited in place", ptr, "page pointer survives growth");
+    TEST_CHECK(freePage(&fh, 999));
+    ASSERT_EQUALS_INT(999, (int) fh.totalNumPages, "trailing free page is dropped");
+    TEST_CHECK(freePage(&fh, 42));
+    TEST_CHECK(closePageFile(&fh));
+
+    // pages and the free-page map survive close and reopen
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_STDIO));
+    ASSERT_TRUE(getFileIOMode(&fh) == SM_IO_MEMORY, "requested mode is ignored for memory files");
+    ASSERT_EQUALS_INT(999, (int) fh.totalNumPages, "size survives reopen");
+    ASSERT_EQUALS_INT(1, (int) getFreePageCount(&fh), "free-page map survives reopen");
+    TEST_CHECK(readBlocks(148, 3, &fh, bufs));
+    ASSERT_EQUALS_STRING("mem-148", bufs[0], "run read back");
+    ASSERT_EQUALS_STRING("edited in place", bufs[2], "in-place edit persisted");
+    TEST_CHECK(allocatePage(&fh, &page));
+    ASSERT_EQUALS_INT(42, (int) page, "freed page is reused");
+    TEST_CHECK(readBlock(42, &fh, bufs[0]));
+    for (i = 0; i < PAGE_SIZE && bufs[0][i] == 0; i++)
+        ;
+    ASSERT_EQUALS_INT(PAGE_SIZE, i, "reused page is zeroed");
+    TEST_CHECK(closePageFile(&fh));
+
+    // a buffer pool over an in-memory file hands out its pages directly
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+    for (i = 0; i < 5; i++) {
+        TEST_CHECK(pinPage(bm, h, 300 + i));
+        sprintf(h->data, "pool-%d", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+    free(h);
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(readBlock(304, &fh, bufs[0]));
+    ASSERT_EQUALS_STRING("pool-4", bufs[0], "pool writes reached the in-memory file");
+
+    // destroying an open file unlinks it; open handles keep their pages
+    TEST_CHECK(openPageFile(TESTPF, &other));
+    TEST_CHECK(destroyPageFile(TESTPF));
+    ASSERT_TRUE(!pageFileExists(TESTPF), "destroyed file is gone");
+    ASSERT_TRUE(openPageFile(TESTPF, &gone) != RC_OK, "destroyed file cannot be reopened");
+    TEST_CHECK(readBlock(304, &other, bufs[0]));
+    ASSERT_EQUALS_STRING("pool-4", bufs[0], "open handle still reads its pages");
+    TEST_CHECK(closePageFile(&other));
+    TEST_CHECK(closePageFile(&fh));
+
+    // other page sizes work in memory too
+    setStorageIOMode(SM_IO_MEMORY);
+    TEST_CHECK(createPageFileWithPageSize(TESTPF, 16384));
+    setStorageIOMode(SM_IO_POSITIONAL);
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_EQUALS_INT(16384, fh.pageSize, "page size of an in-memory file");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+    ASSERT_TRUE(destroyPageFile(TESTPF) != RC_OK, "second destroy fails");
+
+    free(arena);
+    TEST_DONE();
+}
+
+// One thread of the group-commit test: write its own page, then force it
+typedef struct CommitWorker {
+    SM_FileHandle *fh;
+    int pageNum;
+    int numCommits;
+    int failures;
+} CommitWorker;
+
+static void *commitWorker(void *arg) {
+    CommitWorker *w = (CommitWorker *) arg;
+    char *page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    for (int i = 0; i < w->numCommits; i++) {
+        sprintf(page, "commit-%d-%d", w->pageNum, i);
+        if (writeBlock(w->pageNum, w->fh, page) != RC_OK ||
+            flushBlocks(w->pageNum, 1, w->fh) != RC_OK)
+            w->failures++;
+    }
+    free(page);
+    return NULL;
+}
+
+// Forces sync as the durability mode asks; group commit shares syncs
+void testDurability(void) {
+    SM_FileHandle fh;
+    SM_PageHandle ph = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
+    pthread_t threads[8];
+    CommitWorker workers[8];
+    int t;
+
+    testName = "test durability modes";
+
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    ASSERT_TRUE(getFileDurability(&fh) == SM_DURABILITY_NONE, "no syncs by default");
+    TEST_CHECK(ensureCapacity(8, &fh));
+    TEST_CHECK(writeBlock(0, &fh, ph));
+    TEST_CHECK(flushBlocks(0, 1, &fh));
+    ASSERT_EQUALS_INT(0, (int) getFileSyncCount(&fh), "a force without durability does not sync");
+
+    TEST_CHECK(setFileDurability(&fh, SM_DURABILITY_SYNC_ON_FORCE, 0));
+    for (int i = 0; i < 3; i++)
+        TEST_CHECK(flushBlocks(0, 1, &fh));
+    ASSERT_EQUALS_INT(3, (int) getFileSyncCount(&fh), "one sync per force");
+    ASSERT_ERROR(setFileDurability(&fh, (SM_Durability) 7, 0), "unknown mode is rejected");
+    ASSERT_ERROR(setFileDurability(&fh, SM_DURABILITY_GROUP_COMMIT, -1), "negative interval is rejected");
+
+    // many threads forcing at once share far fewer syncs than forces
+    TEST_CHECK(setFileDurability(&fh, SM_DURABILITY_GROUP_COMMIT, 5000));
+    for (t = 0; t < 8; t++) {
+        workers[t].fh = &fh;
+        workers[t].pageNum = t;
+        workers[t].numCommits = 10;
+        workers[t].failures = 0;
+        pthread_create(&threads[t], NULL, commitWorker, &workers[t]);
+    }
+    int failures = 0;
+    for (t = 0; t < 8; t++) {
+        pthread_join(threads[t], NULL);
+        failures += workers[t].failures;
+    }
+    ASSERT_EQUALS_INT(0, failures, "every group-committed force succeeds");
+    int groupSyncs = (int) getFileSyncCount(&fh) - 3;
+    ASSERT_TRUE(groupSyncs > 0 && groupSyncs < 80, "group commit batches forces into fewer syncs");
+    for (t = 0; t < 8; t++) {
+        char expected[32];
+        sprintf(expected, "commit-%d-9", t);
+        TEST_CHECK(readBlock(t, &fh, ph));
+        ASSERT_EQUALS_STRING(expected, ph, "last commit of each thread is in the file");
+    }
+
+    // forces through different handles on the file share a sync too
+    SM_FileHandle fh2;
+    TEST_CHECK(openPageFile(TESTPF, &fh2));
+    TEST_CHECK(setFileDurability(&fh, SM_DURABILITY_GROUP_COMMIT, 200000));
+    TEST_CHECK(setFileDurability(&fh2, SM_DURABILITY_GROUP_COMMIT, 200000));
+    TEST_CHECK(flushBlocks(0, 1, &fh));
+    int64_t syncsBefore = getFileSyncCount(&fh) + getFileSyncCount(&fh2);
+    for (t = 0; t < 2; t++) {
+        workers[t].fh = (t == 0) ? &fh : &fh2;
+        workers[t].pageNum = t;
+        workers[t].numCommits = 1;
+        workers[t].failures = 0;
+        pthread_create(&threads[t], NULL, commitWorker, &workers[t]);
+    }
+    failures = 0;
+    for (t = 0; t < 2; t++) {
+        pthread_join(threads[t], NULL);
+        failures += workers[t].failures;
+    }
+    ASSERT_EQUALS_INT(0, failures, "forces through both handles succeed");
+    ASSERT_EQUALS_INT(1, (int) (getFileSyncCount(&fh) + getFileSyncCount(&fh2) - syncsBefore),
+                      "one sync covers the forces of both handles");
+    TEST_CHECK(closePageFile(&fh2));
+    TEST_CHECK(closePageFile(&fh));
+
+    // the default applies to newly opened files; in-memory files never sync
+    setStorageDurability(SM_DURABILITY_SYNC_ON_FORCE, SM_DEFAULT_GROUP_INTERVAL_US);
+    TEST_CHECK(openPageFileWithMode(TESTPF, &fh, SM_IO_STDIO));
+    ASSERT_TRUE(getFileDurability(&fh) == SM_DURABILITY_SYNC_ON_FORCE, "default durability applies");
+    TEST_CHECK(flushBlocks(0, 1, &fh));
+    ASSERT_EQUALS_INT(1, (int) getFileSyncCount(&fh), "stdio files sync too");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    setStorageIOMode(SM_IO_MEMORY);
+    TEST_CHECK(createPageFile(TESTPF));
+    setStorageIOMode(SM_IO_POSITIONAL);
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(flushBlocks(0, 1, &fh));
+    ASSERT_EQUALS_INT(0, (int) getFileSyncCount(&fh), "in-memory files have nothing to sync");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TESTPF));
+    setStorageDurability(SM_DURABILITY_NONE, SM_DEFAULT_GROUP_INTERVAL_US);
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Hints are accepted by every backend and never change what reads return
+void testAccessHints(void) {
+    SM_IOMode modes[] = { SM_IO_STDIO, SM_IO_POSITIONAL, SM_IO_MMAP, SM_IO_DIRECT,
+                          SM_IO_COMPRESSED, SM_IO_MEMORY };
+    SM_Advice advice[] = { SM_ADVICE_SEQUENTIAL, SM_ADVICE_RANDOM, SM_ADVICE_WILLNEED,
+                           SM_ADVICE_DONTNEED, SM_ADVICE_NORMAL };
+    SM_FileHandle fh;
+    SM_PageHandle ph = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
+    int p;
+
+    testName = "test access-pattern hints";
+
+    for (int m = 0; m < 6; m++) {
+        setStorageIOMode(modes[m]);
+        TEST_CHECK(createPageFile(TESTPF));
+        setStorageIOMode(SM_IO_POSITIONAL);
+        TEST_CHECK(openPageFileWithMode(TESTPF, &fh, modes[m]));
+        TEST_CHECK(ensureCapacity(32, &fh));
+        for (p = 0; p < 32; p++) {
+            sprintf(ph, "hinted-%d", p);
+            TEST_CHECK(writeBlock(p, &fh, ph));
+        }
+        TEST_CHECK(flushBlocks(0, 32, &fh));
+
+        for (int a = 0; a < 5; a++) {
+            TEST_CHECK(adviseBlocks(0, 0, &fh, advice[a]));
+            TEST_CHECK(adviseBlocks(4, 8, &fh, advice[a]));
+        }
+        ASSERT_ERROR(adviseBlocks(30, 3, &fh, SM_ADVICE_WILLNEED), "range past end of file is rejected");
+        ASSERT_ERROR(adviseBlocks(0, 1, &fh, (SM_Advice) 9), "unknown hint is rejected");
+
+        for (p = 0; p < 32; p++) {
+            char expected[32];
+            sprintf(expected, "hinted-%d", p);
+            TEST_CHECK(readBlock(p, &fh, ph));
+            if (strcmp(expected, ph) != 0)
+                break;
+        }
+        ASSERT_EQUALS_INT(32, p, "pages read back unchanged after hints");
+        TEST_CHECK(closePageFile(&fh));
+        TEST_CHECK(destroyPageFile(TESTPF));
+    }
+
+    // buffer pools clip the hinted range to the file
+    BM_BufferPool *bm = MAKE_POOL();
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+    TEST_CHECK(adviseAccess(bm, 0, 100, SM_ADVICE_WILLNEED));
+    TEST_CHECK(adviseAccess(bm, 50, 0, SM_ADVICE_SEQUENTIAL));
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TESTPF));
+
+    free(ph);
+    TEST_DONE();
+}
+
+// Reopening a cached file skips the probe, and idle descriptors are closed LRU under the budget
+void testFileCache(void) {
+    char *names[] = { "test_cache_a.bin", "test_cache_b.bin", "test_cache_c.bin" };
+    SM_FileHandle fh, other, handles[3];
+    SM_FileCacheStats before, after;
+    SM_PageHandle ph = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
+    int i;
+
+    testName = "test open-file cache";
+
+    flushFileCache();
+    setFileCacheBudget(2);
+    ASSERT_EQUALS_INT(2, getFileCacheBudget(), "budget set");
+
+    // a new file is cached by createPageFile, and its size is kept current
+    TEST_CHECK(createPageFile(names[0]));
+    getFileCacheStats(&before);
+    ASSERT_EQUALS_INT(1, before.openFiles, "created file is cached");
+    TEST_CHECK(openPageFile(names[0], &fh));
+    TEST_CHECK(ensureCapacity(5, &fh));
+    strcpy(ph, "Cached-4");
+    TEST_CHECK(writeBlock(4, &fh, ph));
+    TEST_CHECK(openPageFile(names[0], &other));
+    ASSERT_EQUALS_INT(5, (int) other.totalNumPages, "second handle sees the grown size");
+    ASSERT_TRUE(getFileDescriptor(&fh) == getFileDescriptor(&other), "handles share one descriptor");
+    TEST_CHECK(closePageFile(&other));
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(openPageFileWithMode(names[0], &fh, SM_IO_STDIO));
+    ASSERT_EQUALS_INT(5, (int) fh.totalNumPages, "page count cached across close");
+    TEST_CHECK(readBlock(4, &fh, ph));
+    ASSERT_EQUALS_STRING("Cached-4", ph, "page read through another backend");
+    TEST_CHECK(closePageFile(&fh));
+    getFileCacheStats(&after);
+    ASSERT_EQUALS_INT(3, (int) (after.hits - before.hits), "every reopen is a hit");
+    ASSERT_EQUALS_INT(0, (int) (after.misses - before.misses), "no reopen probes the file");
+
+    // a third file evicts the least recently released one
+    TEST_CHECK(createPageFile(names[1]));
+    TEST_CHECK(createPageFile(names[2]));
+    getFileCacheStats(&before);
+    ASSERT_EQUALS_INT(2, before.openFiles, "cache stays within its budget");
+    ASSERT_EQUALS_INT(1, (int) (before.evictions - after.evictions), "one idle descriptor evicted");
+    TEST_CHECK(openPageFile(names[0], &fh));
+    ASSERT_EQUALS_INT(5, (int) fh.totalNumPages, "evicted file reopens with its size");
+    TEST_CHECK(closePageFile(&fh));
+    getFileCacheStats(&after);
+    ASSERT_EQUALS_INT(1, (int) (after.misses - before.misses), "evicted file is probed again");
+
+    // files in use are never closed, even past the budget
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(openPageFile(names[i], &handles[i]));
+    getFileCacheStats(&after);
+    ASSERT_EQUALS_INT(3, after.openFiles, "open files stay cached past the budget");
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(closePageFile(&handles[i]));
+    getFileCacheStats(&after);
+    ASSERT_EQUALS_INT(2, after.openFiles, "idle files trimmed to the budget on close");
+
+    // destroying a file drops it from the cache; open handles keep working
+    TEST_CHECK(openPageFile(names[0], &fh));
+    TEST_CHECK(destroyPageFile(names[0]));
+    ASSERT_TRUE(!pageFileExists(names[0]), "destroyed file no longer exists");
+    ASSERT_TRUE(openPageFile(names[0], &other) != RC_OK, "destroyed file does not reopen");
+    TEST_CHECK(readBlock(4, &fh, ph));
+    ASSERT_EQUALS_STRING("Cached-4", ph, "open handle still reads a destroyed file");
+    TEST_CHECK(closePageFile(&fh));
+
+    // with no budget every descriptor is closed on the last close
+    setFileCacheBudget(0);
+    TEST_CHECK(openPageFile(names[1], &fh));
+    TEST_CHECK(closePageFile(&fh));
+    getFileCacheStats(&after);
+    ASSERT_EQUALS_INT(0, after.openFiles, "no descriptors cached without a budget");
+
+    setFileCacheBudget(SM_DEFAULT_FILE_CACHE_BUDGET);
+    TEST_CHECK(destroyPageFile(names[1]));
+    TEST_CHECK(destroyPageFile(names[2]));
+    free(ph);
+    TEST_DONE();
+}
+
+// Sums the calls counted in a latency histogram
+static int64_t histogramCalls(const int64_t histogram[]) {
+    int64_t calls = 0;
+    for (int b = 0; b < SM_LATENCY_BUCKETS; b++)
+        calls += histogram[b];
+    return calls;
+}
+
+// Every read, write, extension and sync is counted per handle, with one latency sample per call
+void testStorageStats(void) {
+    SM_FileHandle fh;
+    SM_IOStats stats;
+    SM_PageHandle bufs[8];
+    SM_AsyncQueue *queue;
+    SM_AsyncRequest request, *done;
+    char *arena = (char *) calloc(8, PAGE_SIZE);
+    int numDone;
+    int p;
+
+    testName = "test storage I/O statistics";
+
+    for (p = 0; p < 8; p++)
+        bufs[p] = arena + (size_t) p * PAGE_SIZE;
+
+    TEST_CHECK(createPageFile(TESTPF));
+    TEST_CHECK(openPageFile(TESTPF, &fh));
+    TEST_CHECK(getStorageStats(&fh, &stats));
+    ASSERT_EQUALS_INT(0, (int) (stats.reads + stats.writes + stats.extensions), "new handle starts at zero");
+
+    TEST_CHECK(ensureCapacity(8, &fh));
+    for (p = 0; p < 8; p++)
+        TEST_CHECK(writeBlock(p, &fh, bufs[p]));
+    TEST_CHECK(readBlocks(0, 8, &fh, bufs));
+    TEST_CHECK(readBlock(3, &fh, bufs[0]));
+    TEST_CHECK(setFileDurability(&fh, SM_DURABILITY_SYNC_ON_FORCE, 0));
+    TEST_CHECK(flushBlocks(0, 8, &fh));
+    TEST_CHECK(getStorageStats(&fh, &stats));
+    ASSERT_EQUALS_INT(1, (int) stats.extensions, "one extension");
+    ASSERT_EQUALS_INT(8, (int) stats.writes, "pages written");
+    ASSERT_EQUALS_INT(8 * PAGE_SIZE, (int) stats.bytesWritten, "bytes written");
+    ASSERT_EQUALS_INT(9, (int) stats.reads, "pages read, vectored and single");
+    ASSERT_EQUALS_INT(9 * PAGE_SIZE, (int) stats.bytesRead, "bytes read");
+    ASSERT_EQUALS_INT(1, (int) stats.syncs, "one sync");
+    ASSERT_EQUALS_INT(8, (int) histogramCalls(stats.writeLatency), "one write latency sample per call");
+    ASSERT_EQUALS_INT(2, (int) histogramCalls(stats.readLatency), "one read latency sample per call");
+    printStorageStats(&fh);
+
+    // reads issued by the async queue are counted too
+    TEST_CHECK(createAsyncQueue(&fh, 2, SM_ASYNC_AUTO, &queue));
+    memset(&request, 0, sizeof(request));
+    request.op = SM_ASYNC_READ;
+    request.pageNum = 4;
+    request.numPages = 4;
+    request.bufs = bufs;
+    TEST_CHECK(submitAsync(queue, &request));
+    TEST_CHECK(waitAsync(queue, &done, 1, 1, &numDone));
+    TEST_CHECK(request.result);
+    TEST_CHECK(destroyAsyncQueue(queue));
+    TEST_CHECK(getStorageStats(&fh, &stats));
+    ASSERT_EQUALS_INT(13, (int) stats.reads, "asynchronous reads counted");
+
+    TEST_CHECK(resetStorageStats(&fh));
+    TEST_CHECK(getStorageStats(&fh, &stats));
+    ASSERT_EQUALS_INT(0, (int) (stats.reads + stats.writes + stats.syncs + histogramCalls(stats.readLatency)),
+                      "reset clears counters and histograms");
+
+    // without timing, calls are still counted but not sampled
+    setStorageIOTiming(0);
+    TEST_CHECK(readBlock(1, &fh, bufs[0]));
+    setStorageIOTiming(1);
+    TEST_CHECK(getStorageStats(&fh, &stats));
+    ASSERT_EQUALS_INT(1, (int) stats.reads, "untimed read counted");
+    ASSERT_EQUALS_INT(0, (int) histogramCalls(stats.readLatency), "untimed read not sampled");
+    TEST_CHECK(closePageFile(&fh));
+
+    // a buffer pool's misses are the physical reads beneath it
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+    for (p = 0; p < 6; p++) {
+        TEST_CHECK(pinPage(bm, h, p % 4));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(getPoolStorageStats(bm, &stats));
+    ASSERT_EQUALS_INT(getNumReadIO(bm), (int) stats.reads, "pool misses match physical reads");
+    TEST_CHECK(shutdownBufferPool(bm));
+    free(h);
+
+    TEST_CHECK(destroyPageFile(TESTPF));
+    free(arena);
+    TEST_DONE();
+}